@@ -21,6 +21,7 @@
 #include "app/main.h"
 
 #include "world_builder/assert.h"
+#include "world_builder/thread_pool.h"
 #include "world_builder/utilities.h"
 #include "world_builder/world.h"
 
@@ -29,253 +30,693 @@
 #endif
 
 #include <algorithm>
+#include <cstdio>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <sstream>
 
 using namespace WorldBuilder::Utilities;
 
+using WorldBuilder::App::DataFormat;
+
+namespace
+{
+  /**
+   * The number of points of the data file which are read, evaluated and
+   * written together.
+   */
+  const size_t lines_per_block = 10000;
+
+  /**
+   * A block of points of the data file together with the results of their
+   * evaluation. Points of a text file are given by their lines, points of
+   * a binary file by their range in the file.
+   */
+  struct PointBlock
+  {
+    size_t n_points = 0;
+    size_t first_point = 0;
+    size_t first_line_number = 1;
+    std::vector<std::string> lines;
+    std::vector<double> inputs;
+    std::vector<double> values;
+    std::vector<char> valid;
+    std::vector<std::string> text;
+  };
+}
+
+std::vector<std::string> get_command_line_options_vector(int argc, char **argv)
+{
+  std::vector<std::string> vector;
+  for (int i=1; i < argc; ++i)
+    vector.emplace_back(argv[i]);
+
+  return vector;
+}
+
 bool find_command_line_option(char **begin, char **end, const std::string &option)
 {
   return std::find(begin, end, option) != end;
 }
 
-int main(int argc, char **argv)
+
+bool take_command_line_option(std::vector<std::string> &options_vector, const std::string &option, std::string &value)
 {
-  /**
-   * First parse the command line options
-   */
-  std::string wb_file;
-  std::string data_file;
+  const auto position = std::find(options_vector.begin(), options_vector.end(), option);
+  if (position == options_vector.end())
+    return false;
+
+  WBAssertThrow(position + 1 != options_vector.end(), "The option " << option << " requires a value.");
+  value = *(position + 1);
+  options_vector.erase(position, position + 2);
+  return true;
+}
 
-  unsigned int dim = 3;
-  unsigned int compositions = 0;
-  unsigned int grain_compositions = 0;
-  size_t number_of_grains = 0;
 
-  if (find_command_line_option(argv, argv+argc, "-h") || find_command_line_option(argv, argv+argc, "--help"))
+bool read_configuration_line(const std::vector<std::string> &line, DataConfiguration &configuration)
+{
+  if (line.empty() || line[0] != "#")
+    return false;
+
+  if (line.size() > 3 && line[1] == "dim" && line[2] == "=")
+    configuration.dim = string_to_unsigned_int(line[3]);
+
+  if (line.size() > 3 && line[1] == "compositions" && line[2] == "=")
+    configuration.compositions = string_to_unsigned_int(line[3]);
+
+  if (line.size() > 4 && line[1] == "grain" && line[2] == "compositions" && line[3] == "=")
+    configuration.grain_compositions = string_to_unsigned_int(line[4]);
+
+  if (line.size() > 5 && line[1] == "number" && line[2] == "of" && line[3] == "grains" && line[4] == "=")
+    configuration.number_of_grains = string_to_unsigned_int(line[5]);
+
+  return true;
+}
+
+
+void write_header(std::ostream &output, const DataConfiguration &configuration)
+{
+  output << (configuration.dim == 2 ? "# x z d g T " : "# x y z d g T ");
+
+  for (unsigned int c = 0; c < configuration.compositions; ++c)
+    output << "c" << c << " ";
+
+  for (unsigned int gc = 0; gc < configuration.grain_compositions; ++gc)
+    for (size_t g = 0; g < configuration.number_of_grains; g++)
+      output << "gs" << gc << "-" << g << " " // gs = grain size, gm = grain rotation matrix
+             << "gm" << gc << "-" << g << "[0:0] " << "gm" << gc << "-" << g << "[0:1] " << "gm" << gc << "-" << g << "[0:2] "
+             << "gm" << gc << "-" << g << "[1:0] " << "gm" << gc << "-" << g << "[1:1] " << "gm" << gc << "-" << g << "[1:2] "
+             << "gm" << gc << "-" << g << "[2:0] " << "gm" << gc << "-" << g << "[2:1] " << "gm" << gc << "-" << g << "[2:2] ";
+
+  output << "\n";
+}
+
+
+size_t n_output_values(const DataConfiguration &configuration)
+{
+  return 1 + configuration.compositions + configuration.grain_compositions * configuration.number_of_grains * 10;
+}
+
+
+void evaluate_point(const WorldBuilder::World &world,
+                    const DataConfiguration &configuration,
+                    const double *input,
+                    double *output)
+{
+  const double depth = input[configuration.dim];
+  const double gravity = input[configuration.dim + 1];
+
+  auto evaluate = [&](const auto &coords)
+  {
+    *output++ = world.temperature(coords, depth, gravity);
+
+    for (unsigned int c = 0; c < configuration.compositions; ++c)
+      *output++ = world.composition(coords, depth, c);
+
+    // The grains are computed into buffers which are reused for all the
+    // points evaluated by a thread, so that no memory is allocated per point.
+    static thread_local std::vector<double> sizes;
+    static thread_local std::vector<std::array<std::array<double,3>,3> > rotation_matrices;
+    sizes.resize(configuration.number_of_grains);
+    rotation_matrices.resize(configuration.number_of_grains);
+
+    for (unsigned int gc = 0; gc < configuration.grain_compositions; ++gc)
+      {
+        world.grains(coords, depth, gc, configuration.number_of_grains, sizes.data(), rotation_matrices.data());
+        for (unsigned int g = 0; g < configuration.number_of_grains; ++g)
+          {
+            *output++ = sizes[g];
+            for (size_t i = 0; i < 3; ++i)
+              for (size_t j = 0; j < 3; ++j)
+                *output++ = rotation_matrices[g][i][j];
+          }
+      }
+  };
+
+  if (configuration.dim == 2)
+    evaluate(std::array<double,2> {{input[0], input[1]}});
+  else
+    evaluate(std::array<double,3> {{input[0], input[1], input[2]}});
+}
+
+
+size_t read_lines(std::istream &input, const size_t n_lines, size_t &position, const size_t end, std::vector<std::string> &lines)
+{
+  size_t n_read = 0;
+  std::string line;
+  while (n_read < n_lines && position < end && std::getline(input, line))
     {
-      std::cout << "This program allows to use the world builder library directly with a world builder file and a data file. "
-                "The data file will be filled with intitial conditions from the world as set by the world builder file." << std::endl
-                << "Besides providing two files, where the first is the world builder file and the second is the data file, the available options are: " << std::endl
-                << "-h or --help to get this help screen." << std::endl;
-      return 0;
+      position += line.size() + 1;
+      lines.emplace_back(std::move(line));
+      ++n_read;
     }
+  return n_read;
+}
+
+
+size_t next_line_start(std::istream &input, const size_t position)
+{
+  if (position == 0)
+    return 0;
+
+  // The line which contains the byte before the position ends at or after
+  // the position.
+  input.clear();
+  input.seekg(static_cast<std::streamoff>(position - 1));
+  std::string line;
+  std::getline(input, line);
+  return position + line.size();
+}
 
-  if (argc == 1)
+
+void evaluate_data_file(const WorldBuilder::World &world,
+                        DataConfiguration configuration,
+                        const std::string &data_file,
+                        const DataFormat input_format,
+                        const std::string &output_file,
+                        const DataFormat output_format,
+                        const unsigned int precision,
+                        WorldBuilder::ThreadPool &pool,
+                        const int mpi_rank,
+                        const int mpi_size)
+{
+  PointBlock block;
+  PointBlock next_block;
+
+  // Every process evaluates its own part of the points, which is a range of
+  // points of a binary file or a range of bytes of a text file. The ranges
+  // are split at the starts of lines.
+  std::ifstream text_input;
+  std::unique_ptr<WorldBuilder::App::BinaryPointReader> binary_input;
+  size_t begin = 0;
+  size_t end = 0;
+  if (input_format == DataFormat::text)
     {
-      std::cout << "Error: There where no files passed to the World Builder, use --help for more " << std::endl
-                << "information on how  to use the World Builder app." << std::endl;
-      return 0;
-    }
+      text_input.open(data_file, std::ios::binary);
+      WBAssertThrow(text_input.is_open(), "Could not open the data file " << data_file << ".");
+
+      // The configuration is given in the comment lines at the start of the
+      // file, before the first point.
+      size_t data_start = 0;
+      std::string line;
+      while (std::getline(text_input, line))
+        {
+          const std::vector<std::string> words = split_data_line(line);
+          if (!words.empty() && !read_configuration_line(words, configuration))
+            break;
+          data_start += line.size() + 1;
+          ++block.first_line_number;
+        }
 
+      text_input.clear();
+      text_input.seekg(0, std::ios::end);
+      const size_t file_size = static_cast<size_t>(text_input.tellg());
+      data_start = std::min(data_start, file_size);
+      const size_t data_size = file_size - data_start;
+      begin = next_line_start(text_input, data_start + data_size * static_cast<size_t>(mpi_rank) / static_cast<size_t>(mpi_size));
+      end = next_line_start(text_input, data_start + data_size * static_cast<size_t>(mpi_rank + 1) / static_cast<size_t>(mpi_size));
+      begin = std::max(begin, data_start);
+      end = std::max(end, begin);
+
+#ifdef WB_WITH_MPI
+      if (mpi_size > 1)
+        {
+          // The line numbers are only used for the error messages, but they
+          // have to be known before the evaluation, so every process counts
+          // the lines of its range first.
+          text_input.clear();
+          text_input.seekg(static_cast<std::streamoff>(begin));
+          std::vector<char> buffer(1 << 20);
+          unsigned long long n_lines = 0;
+          for (size_t position = begin; position < end;)
+            {
+              const size_t n_bytes = std::min(buffer.size(), end - position);
+              text_input.read(buffer.data(), static_cast<std::streamsize>(n_bytes));
+              n_lines += static_cast<unsigned long long>(std::count(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(n_bytes), '\n'));
+              position += n_bytes;
+            }
+          unsigned long long n_lines_before = 0;
+          MPI_Exscan(&n_lines, &n_lines_before, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+          if (mpi_rank > 0)
+            block.first_line_number += n_lines_before;
+        }
+#endif
 
-  if (argc == 2)
+      text_input.clear();
+      text_input.seekg(static_cast<std::streamoff>(begin));
+    }
+  else
     {
-      std::cout << "Error:  The World Builder app requires at least two files, a World Builder file " << std::endl
-                << "and a data file to convert." << std::endl;
-      return 0;
+      // A npy file knows its number of columns, and therefore the dimension.
+      binary_input = std::make_unique<WorldBuilder::App::BinaryPointReader>(data_file, input_format,
+                     input_format == DataFormat::raw ? configuration.dim + 2 : 0);
+      WBAssertThrow(binary_input->n_columns() >= 2, "The data file " << data_file << " needs to contain dim + 2 columns.");
+      configuration.dim = static_cast<unsigned int>(binary_input->n_columns() - 2);
+
+      const size_t n_points = binary_input->n_points();
+      begin = n_points * static_cast<size_t>(mpi_rank) / static_cast<size_t>(mpi_size);
+      end = n_points * static_cast<size_t>(mpi_rank + 1) / static_cast<size_t>(mpi_size);
     }
 
-  if (argc != 3)
+  WBAssertThrow(output_format == DataFormat::text || !output_file.empty(),
+                "Binary output can only be written to a file, which is given with -o.");
+
+  if (configuration.dim != 2 && configuration.dim != 3)
     {
-      std::cout << "Only two command line arguments may be given, which should be the world builder file location and the data file location (in that order). " << std::endl;
-      return 0;
+      if (mpi_rank == 0)
+        {
+          std::ofstream text_file;
+          if (!output_file.empty())
+            text_file.open(output_file);
+          (output_file.empty() ? std::cout : text_file)
+              << "The World Builder can only be run in 2d and 3d but a different space dimension " << std::endl
+              << "is given: dim = " << configuration.dim << ".";
+        }
+      return;
     }
 
-  int MPI_RANK = 0;
-  int MPI_SIZE = 1;
-#ifdef WB_WITH_MPI
-  MPI_Init(&argc,&argv);
-  MPI_Comm_rank(MPI_COMM_WORLD, &MPI_RANK);
-  MPI_Comm_size(MPI_COMM_WORLD, &MPI_SIZE);
-#endif
+  const size_t n_inputs = configuration.dim + 2;
+  const size_t n_values = n_output_values(configuration);
 
-  if (MPI_RANK == 0)
+  // The header of the output, which is written once before all the points.
+  std::string header;
+  if (output_format == DataFormat::text)
     {
-      wb_file = argv[1];
-      data_file = argv[2];
-
-      /**
-       * Try to start the world builder
-       */
-      std::unique_ptr<WorldBuilder::World> world;
-      //try
-      {
-        std::string output_dir = wb_file.substr(0,wb_file.find_last_of("/\\") + 1);
-        world = std::make_unique<WorldBuilder::World>(wb_file, true, output_dir);
-      }
-      /*catch (std::exception &e)
+      std::ostringstream header_stream;
+      write_header(header_stream, configuration);
+      header = header_stream.str();
+    }
+  else if (output_format == DataFormat::npy)
+    header = WorldBuilder::App::npy_header(0, n_inputs + n_values);
+
+  // A single process writes directly to the output. With several processes,
+  // every process first writes its points to a temporary file, and the
+  // parts are put together in the order of the input at the end.
+  std::ofstream file_output;
+  std::ostream *output = &std::cout;
+  std::unique_ptr<std::FILE, int(*)(std::FILE *)> part(nullptr, &std::fclose);
+  if (mpi_size == 1)
+    {
+      if (!output_file.empty())
         {
-          std::cerr << "Could not start the World builder, error: " << e.what() << "\n";
-          return 1;
+          file_output.open(output_file, std::ios::binary | std::ios::trunc);
+          WBAssertThrow(file_output.is_open(), "Could not create the output file " << output_file << ".");
+          output = &file_output;
         }
-      catch (...)
-        {
-          std::cerr << "Exception of unknown type!\n";
-          return 1;
-        }*/
+      *output << header;
+    }
+  else
+    {
+      part.reset(std::tmpfile());
+      WBAssertThrow(part != nullptr, "Could not create a temporary file for the output of process " << mpi_rank << ".");
+    }
 
+  auto write_bytes = [&](const char *bytes, const size_t n_bytes)
+  {
+    if (part != nullptr)
+      WBAssertThrow(std::fwrite(bytes, 1, n_bytes, part.get()) == n_bytes, "Could not write the results.");
+    else
+      output->write(bytes, static_cast<std::streamsize>(n_bytes));
+  };
+
+  // Reads the next points of the range into the block.
+  size_t position = begin;
+  auto read_block = [&](PointBlock &new_block)
+  {
+    if (input_format == DataFormat::text)
+      {
+        read_lines(text_input, lines_per_block, position, end, new_block.lines);
+        new_block.n_points = new_block.lines.size();
+      }
+    else
+      {
+        new_block.first_point = position;
+        new_block.n_points = std::min(lines_per_block, end - position);
+        position += new_block.n_points;
+      }
+  };
+
+  // Parses, evaluates and, for text output, formats one point of a block.
+  auto evaluate = [&](PointBlock &current_block, const size_t i)
+  {
+    double *input = &current_block.inputs[i * n_inputs];
+    double *values = &current_block.values[i * n_values];
 
-      /**
-       * Read the data from the data files
-       */
-      std::ifstream data_stream(data_file);
+    std::vector<std::string> words;
+    if (input_format == DataFormat::text)
+      {
+        words = split_data_line(current_block.lines[i]);
+        if (words.empty() || words[0] == "#")
+          {
+            current_block.valid[i] = 0;
+            return;
+          }
+
+        WBAssertThrow(words.size() == n_inputs, "The file needs to contain dim + 2 entries, but contains " << words.size() << " entries "
+                      " on line " << current_block.first_line_number + i << " of the data file. Dim is " << configuration.dim << ".");
+
+        for (size_t j = 0; j < n_inputs; ++j)
+          input[j] = string_to_double(words[j]);
+      }
+    else
+      std::copy(binary_input->point(current_block.first_point + i), binary_input->point(current_block.first_point + i) + n_inputs, input);
 
-      // move the data into a vector of strings
-      std::vector<std::vector<std::string> > data;
-      std::string temp;
+    evaluate_point(world, configuration, input, values);
+    current_block.valid[i] = 1;
 
-      while (std::getline(data_stream, temp))
+    if (output_format == DataFormat::text)
+      {
+        // The numbers are formatted without a stream, which is much faster
+        // and does not depend on the locale. The input of a text file is
+        // written as it was given.
+        std::string &line = current_block.text[i];
+        line.clear();
+        char number[32];
+        auto write_number = [&](const double number_value)
         {
-          std::istringstream buffer(temp);
-          std::vector<std::string> line((std::istream_iterator<std::string>(buffer)),
-                                        std::istream_iterator<std::string>());
-
-          // remove the comma's in case it is a comma separated file.
-          // TODO: make it split for comma's and/or spaces
-          for (auto &line_i : line)
-            line_i.erase(std::remove(line_i.begin(), line_i.end(), ','), line_i.end());
+          line.append(number, format_double(number_value, precision, number));
+          line += ' ';
+        };
 
-          data.push_back(line);
-        }
+        if (input_format == DataFormat::text)
+          for (const std::string &word : words)
+            {
+              line += word;
+              line += ' ';
+            }
+        else
+          for (size_t j = 0; j < n_inputs; ++j)
+            write_number(input[j]);
+        for (size_t j = 0; j < n_values; ++j)
+          write_number(values[j]);
+        line += '\n';
+      }
+  };
 
-      // Read config from data if pressent
-      for (auto &line_i : data)
+  size_t n_rows = 0;
+  auto write_block = [&](const PointBlock &current_block)
+  {
+    for (size_t i = 0; i < current_block.n_points; ++i)
+      if (current_block.valid[i] == 1)
         {
-          if (!line_i.empty() && line_i[0] == "#" && line_i[1] == "dim" && line_i[2] == "=")
+          if (output_format == DataFormat::text)
+            write_bytes(current_block.text[i].data(), current_block.text[i].size());
+          else
             {
-              dim = string_to_unsigned_int(line_i[3]);
+              write_bytes(reinterpret_cast<const char *>(&current_block.inputs[i * n_inputs]), n_inputs * sizeof(double));
+              write_bytes(reinterpret_cast<const char *>(&current_block.values[i * n_values]), n_values * sizeof(double));
             }
+          ++n_rows;
+        }
+    WBAssertThrow(part != nullptr || output->good(), "Could not write the results.");
+  };
+
+  // The points are processed in blocks. While the threads of the pool
+  // evaluate one block, the next block is read and the previous block is
+  // written, each by its own thread, so the file never has to be in memory
+  // as a whole.
+  read_block(block);
+  PointBlock written_block;
+  std::future<void> writer;
+
+  while (block.n_points > 0)
+    {
+      next_block.lines.clear();
+      next_block.first_line_number = block.first_line_number + block.n_points;
+      std::future<void> reader = std::async(std::launch::async, [&]()
+      {
+        read_block(next_block);
+      });
+
+      block.inputs.resize(block.n_points * n_inputs);
+      block.values.resize(block.n_points * n_values);
+      block.valid.resize(block.n_points);
+      block.text.resize(output_format == DataFormat::text ? block.n_points : 0);
+      try
+        {
+          pool.parallel_for(0, block.n_points, [&](size_t i)
+          {
+            evaluate(block, i);
+          });
+        }
+      catch (...)
+        {
+          reader.wait();
+          if (writer.valid())
+            writer.wait();
+          throw;
+        }
 
-          if (!line_i.empty() && line_i[0] == "#" && line_i[1] == "compositions" && line_i[2] == "=")
-            compositions = string_to_unsigned_int(line_i[3]);
+      if (writer.valid())
+        writer.get();
+      std::swap(written_block, block);
+      writer = std::async(std::launch::async, [&]()
+      {
+        write_block(written_block);
+      });
 
-          if (!line_i.empty() && line_i[0] == "#" && line_i[1] == "grain" && line_i[2] == "compositions" && line_i[3] == "=")
-            grain_compositions = string_to_unsigned_int(line_i[4]);
+      reader.get();
+      std::swap(block, next_block);
+    }
 
-          if (!line_i.empty() && line_i[0] == "#" && line_i[1] == "number" && line_i[2] == "of" && line_i[3] == "grains" && line_i[4] == "=")
-            number_of_grains = string_to_unsigned_int(line_i[5]);
+  if (writer.valid())
+    writer.get();
 
+  if (mpi_size == 1)
+    {
+      if (output_format == DataFormat::npy)
+        {
+          output->seekp(0);
+          *output << WorldBuilder::App::npy_header(n_rows, n_inputs + n_values);
         }
+      output->flush();
+      WBAssertThrow(output->good(), "Could not write the results.");
+      return;
+    }
 
-      switch (dim)
+#ifdef WB_WITH_MPI
+  // Put the parts of all the processes together in the order of the input.
+  // Every process knows where its part starts from the sizes of the parts
+  // of the processes before it.
+  unsigned long long part_size = static_cast<unsigned long long>(std::ftell(part.get()));
+  unsigned long long part_start = 0;
+  unsigned long long total_size = 0;
+  unsigned long long local_rows = n_rows;
+  unsigned long long total_rows = 0;
+  MPI_Exscan(&part_size, &part_start, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+  MPI_Allreduce(&part_size, &total_size, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+  MPI_Allreduce(&local_rows, &total_rows, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+  if (mpi_rank == 0)
+    part_start = 0;
+
+  if (output_format == DataFormat::npy)
+    header = WorldBuilder::App::npy_header(total_rows, n_inputs + n_values);
+
+  std::rewind(part.get());
+  std::vector<char> buffer(1 << 20);
+  const int buffer_size = static_cast<int>(buffer.size());
+
+  if (output_file.empty())
+    {
+      // Only the first process writes to the screen. It receives the parts
+      // of the other processes one after another.
+      if (mpi_rank == 0)
         {
-          case 2:
-            // set the header
-            std::cout << "# x z d g T ";
+          std::cout << header;
+          size_t n_bytes = 0;
+          while ((n_bytes = std::fread(buffer.data(), 1, buffer.size(), part.get())) > 0)
+            std::cout.write(buffer.data(), static_cast<std::streamsize>(n_bytes));
 
-            for (unsigned int c = 0; c < compositions; ++c)
-              std::cout << "c" << c << " ";
+          for (int rank = 1; rank < mpi_size; ++rank)
+            {
+              unsigned long long remaining = 0;
+              MPI_Recv(&remaining, 1, MPI_UNSIGNED_LONG_LONG, rank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+              while (remaining > 0)
+                {
+                  const int count = static_cast<int>(std::min<unsigned long long>(remaining, buffer.size()));
+                  MPI_Recv(buffer.data(), count, MPI_CHAR, rank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                  std::cout.write(buffer.data(), count);
+                  remaining -= static_cast<unsigned long long>(count);
+                }
+            }
+          std::cout.flush();
+        }
+      else
+        {
+          MPI_Send(&part_size, 1, MPI_UNSIGNED_LONG_LONG, 0, 0, MPI_COMM_WORLD);
+          size_t n_bytes = 0;
+          while ((n_bytes = std::fread(buffer.data(), 1, buffer.size(), part.get())) > 0)
+            MPI_Send(buffer.data(), static_cast<int>(n_bytes), MPI_CHAR, 0, 0, MPI_COMM_WORLD);
+        }
+    }
+  else
+    {
+      // All processes write their part at its place in the output file.
+      MPI_File file;
+      const int error = MPI_File_open(MPI_COMM_WORLD, output_file.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+      WBAssertThrow(error == MPI_SUCCESS, "Could not create the output file " << output_file << ".");
+      MPI_File_set_size(file, static_cast<MPI_Offset>(header.size() + total_size));
+
+      if (mpi_rank == 0)
+        MPI_File_write_at(file, 0, header.data(), static_cast<int>(header.size()), MPI_CHAR, MPI_STATUS_IGNORE);
+
+      MPI_Offset offset = static_cast<MPI_Offset>(header.size() + part_start);
+      size_t n_bytes = 0;
+      while ((n_bytes = std::fread(buffer.data(), 1, static_cast<size_t>(buffer_size), part.get())) > 0)
+        {
+          MPI_File_write_at(file, offset, buffer.data(), static_cast<int>(n_bytes), MPI_CHAR, MPI_STATUS_IGNORE);
+          offset += static_cast<MPI_Offset>(n_bytes);
+        }
+      MPI_File_close(&file);
+    }
+#endif
+}
 
-            for (unsigned int gc = 0; gc < grain_compositions; ++gc)
-              for (size_t g = 0; g < number_of_grains; g++)
-                std::cout << "gs" << gc << "-" << g << " " // gs = grain size, gm = grain rotation matrix
-                          << "gm" << gc << "-" << g << "[0:0] " << "gm" << gc << "-" << g << "[0:1] " << "gm" << gc << "-" << g << "[0:2] "
-                          << "gm" << gc << "-" << g << "[1:0] " << "gm" << gc << "-" << g << "[1:1] " << "gm" << gc << "-" << g << "[1:2] "
-                          << "gm" << gc << "-" << g << "[2:0] " << "gm" << gc << "-" << g << "[2:1] " << "gm" << gc << "-" << g << "[2:2] ";
 
-            std::cout <<std::endl;
+int main(int argc, char **argv)
+{
+  /**
+   * First parse the command line options
+   */
+  std::string wb_file;
+  std::string data_file;
+  std::string output_file;
 
-            // set the values
-            for (unsigned int i = 0; i < data.size(); ++i)
-              if (data[i][0] != "#")
-                {
+  size_t number_of_threads = 1;
+  unsigned int precision = 6;
+  DataConfiguration configuration;
+  std::string input_format_name;
+  std::string output_format_name;
 
-                  WBAssertThrow(data[i].size() == dim + 2, "The file needs to contain dim + 2 entries, but contains " << data[i].size() << " entries "
-                                " on line " << i+1 << " of the data file.  Dim is " << dim << ".");
-
-                  std::array<double,2> coords = {{
-                      string_to_double(data[i][0]),
-                      string_to_double(data[i][1])
-                    }
-                  };
-                  std::cout << data[i][0] << " " << data[i][1] << " " << data[i][2] << " " << data[i][3] << " ";
-                  std::cout << world->temperature(coords, string_to_double(data[i][2]), string_to_double(data[i][3]))  << " ";
-
-                  for (unsigned int c = 0; c < compositions; ++c)
-                    {
-                      std::cout << world->composition(coords, string_to_double(data[i][2]), c)  << " ";
-                    }
-
-                  for (unsigned int gc = 0; gc < grain_compositions; ++gc)
-                    {
-                      WorldBuilder::grains grains = world->grains(coords, string_to_double(data[i][2]), gc, number_of_grains);
-                      for (unsigned int g = 0; g < number_of_grains; ++g)
-                        {
-                          std::cout << grains.sizes[g]  << " "
-                                    << grains.rotation_matrices[g][0][0] << " " << grains.rotation_matrices[g][0][1] << " " << grains.rotation_matrices[g][0][2] << " "
-                                    << grains.rotation_matrices[g][1][0] << " " << grains.rotation_matrices[g][1][1] << " " << grains.rotation_matrices[g][1][2] << " "
-                                    << grains.rotation_matrices[g][2][0] << " " << grains.rotation_matrices[g][2][1] << " " << grains.rotation_matrices[g][2][2] << " ";
-                        }
-                    }
-                  std::cout << std::endl;
+  if (find_command_line_option(argv, argv+argc, "-h") || find_command_line_option(argv, argv+argc, "--help"))
+    {
+      std::cout << "This program allows to use the world builder library directly with a world builder file and a data file. "
+                "The data file will be filled with intitial conditions from the world as set by the world builder file." << std::endl
+                << "Besides providing two files, where the first is the world builder file and the second is the data file, the available options are: " << std::endl
+                << "-h or --help to get this help screen," << std::endl
+                << "-j the number of threads the app is allowed to use," << std::endl
+                << "-o the file to write the output to instead of the screen," << std::endl
+                << "--input-format and --output-format the format of the data file and the output file (text, raw or npy)," << std::endl
+                << "  which is taken from the file extension (.npy for npy, .bin or .raw for raw) if not given," << std::endl
+                << "--dim, --compositions, --grain-compositions and --number-of-grains to set the configuration of a binary data file," << std::endl
+                << "--precision the number of significant digits of the numbers in a text output (default 6)," << std::endl
+                << "  or 0 for the fewest digits which read back as exactly the same numbers." << std::endl;
+      return 0;
+    }
 
-                }
-            break;
-          case 3:
-            // set the header
-            std::cout << "# x y z d g T ";
+  std::vector<std::string> options_vector = get_command_line_options_vector(argc, argv);
+
+  std::string value;
+  if (take_command_line_option(options_vector, "-j", value))
+    number_of_threads = string_to_unsigned_int(value);
+  if (take_command_line_option(options_vector, "-o", value))
+    output_file = value;
+  if (take_command_line_option(options_vector, "--input-format", value))
+    input_format_name = value;
+  if (take_command_line_option(options_vector, "--output-format", value))
+    output_format_name = value;
+  if (take_command_line_option(options_vector, "--dim", value))
+    configuration.dim = string_to_unsigned_int(value);
+  if (take_command_line_option(options_vector, "--compositions", value))
+    configuration.compositions = string_to_unsigned_int(value);
+  if (take_command_line_option(options_vector, "--grain-compositions", value))
+    configuration.grain_compositions = string_to_unsigned_int(value);
+  if (take_command_line_option(options_vector, "--number-of-grains", value))
+    configuration.number_of_grains = string_to_unsigned_int(value);
+  if (take_command_line_option(options_vector, "--precision", value))
+    {
+      precision = string_to_unsigned_int(value);
+      WBAssertThrow(precision <= 17, "The precision can be at most 17 digits, but is " << precision << ".");
+    }
 
-            for (unsigned int c = 0; c < compositions; ++c)
-              std::cout << "c" << c << " ";
+  if (options_vector.empty())
+    {
+      std::cout << "Error: There where no files passed to the World Builder, use --help for more " << std::endl
+                << "information on how  to use the World Builder app." << std::endl;
+      return 0;
+    }
 
-            for (unsigned int gc = 0; gc < grain_compositions; ++gc)
-              for (size_t g = 0; g < number_of_grains; g++)
-                std::cout << "gs" << gc << "-" << g << " " // gs = grain size, gm = grain rotation matrix
-                          << "gm" << gc << "-" << g << "[0:0] " << "gm" << gc << "-" << g << "[0:1] " << "gm" << gc << "-" << g << "[0:2] "
-                          << "gm" << gc << "-" << g << "[1:0] " << "gm" << gc << "-" << g << "[1:1] " << "gm" << gc << "-" << g << "[1:2] "
-                          << "gm" << gc << "-" << g << "[2:0] " << "gm" << gc << "-" << g << "[2:1] " << "gm" << gc << "-" << g << "[2:2] ";
 
-            std::cout <<std::endl;
+  if (options_vector.size() == 1)
+    {
+      std::cout << "Error:  The World Builder app requires at least two files, a World Builder file " << std::endl
+                << "and a data file to convert." << std::endl;
+      return 0;
+    }
 
-            // set the values
-            for (unsigned int i = 0; i < data.size(); ++i)
-              if (data[i][0] != "#")
-                {
-                  WBAssertThrow(data[i].size() == dim + 2, "The file needs to contain dim + 2 entries, but contains " << data[i].size() << " entries "
-                                " on line " << i+1 << " of the data file. Dim is " << dim << ".");
-                  std::array<double,3> coords = {{
-                      string_to_double(data[i][0]),
-                      string_to_double(data[i][1]),
-                      string_to_double(data[i][2])
-                    }
-                  };
-
-
-                  std::cout << data[i][0] << " " << data[i][1] << " " << data[i][2] << " " << data[i][3] << " " << data[i][4] << " ";
-                  std::cout << world->temperature(coords, string_to_double(data[i][3]), string_to_double(data[i][4]))  << " ";
-
-                  for (unsigned int c = 0; c < compositions; ++c)
-                    {
-                      std::cout << world->composition(coords, string_to_double(data[i][3]), c)  << " ";
-                    }
-
-                  for (unsigned int gc = 0; gc < grain_compositions; ++gc)
-                    {
-                      WorldBuilder::grains grains = world->grains(coords, string_to_double(data[i][3]), gc, number_of_grains);
-                      for (unsigned int g = 0; g < number_of_grains; ++g)
-                        {
-                          std::cout << grains.sizes[g]  << " "
-                                    << grains.rotation_matrices[g][0][0] << " " << grains.rotation_matrices[g][0][1] << " " << grains.rotation_matrices[g][0][2] << " "
-                                    << grains.rotation_matrices[g][1][0] << " " << grains.rotation_matrices[g][1][1] << " " << grains.rotation_matrices[g][1][2] << " "
-                                    << grains.rotation_matrices[g][2][0] << " " << grains.rotation_matrices[g][2][1] << " " << grains.rotation_matrices[g][2][2] << " ";
-                        }
-                    }
-                  std::cout << std::endl;
+  if (options_vector.size() != 2)
+    {
+      std::cout << "Only two command line arguments may be given, which should be the world builder file location and the data file location (in that order). " << std::endl;
+      return 0;
+    }
 
-                }
-            break;
-          default:
-            std::cout << "The World Builder can only be run in 2d and 3d but a different space dimension " << std::endl
-                      << "is given: dim = " << dim << ".";
+  int MPI_RANK = 0;
+  int MPI_SIZE = 1;
+#ifdef WB_WITH_MPI
+  MPI_Init(&argc,&argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &MPI_RANK);
+  MPI_Comm_size(MPI_COMM_WORLD, &MPI_SIZE);
+#endif
+
+  wb_file = options_vector[0];
+  data_file = options_vector[1];
 
+  const DataFormat input_format = input_format_name.empty()
+                                  ? WorldBuilder::App::data_format_from_filename(data_file)
+                                  : WorldBuilder::App::data_format_from_name(input_format_name);
+  const DataFormat output_format = !output_format_name.empty()
+                                   ? WorldBuilder::App::data_format_from_name(output_format_name)
+                                   : (output_file.empty() ? DataFormat::text : WorldBuilder::App::data_format_from_filename(output_file));
+
+  /**
+   * Try to start the world builder
+   */
+  std::unique_ptr<WorldBuilder::World> world;
+  {
+    // Only the first process writes the declarations to the output
+    // directory, so the processes do not write to the same files. All
+    // processes create the world together, so only the first process reads
+    // the world builder file.
+    std::string output_dir = wb_file.substr(0,wb_file.find_last_of("/\\") + 1);
+    int mpi_communicator = WorldBuilder::Utilities::no_mpi_communicator;
 #ifdef WB_WITH_MPI
-            MPI_Finalize();
+    if (MPI_SIZE > 1)
+      mpi_communicator = MPI_Comm_c2f(MPI_COMM_WORLD);
 #endif
-            return 0;
-        }
-    }
+    world = std::make_unique<WorldBuilder::World>(wb_file, MPI_RANK == 0, output_dir, 1, mpi_communicator, number_of_threads);
+  }
+
+  /**
+   * Read the points from the data file and write the results to the
+   * screen or the output file, block by block. With MPI, every process
+   * evaluates its own part of the data file.
+   */
+  WorldBuilder::ThreadPool pool(number_of_threads);
+  evaluate_data_file(*world, configuration, data_file, input_format, output_file, output_format, precision, pool, MPI_RANK, MPI_SIZE);
+
 #ifdef WB_WITH_MPI
   MPI_Finalize();
 #endif
@@ -0,0 +1,288 @@
+/*
+  Copyright (C) 2020 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "app/point_file.h"
+
+#include "world_builder/assert.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace WorldBuilder
+{
+  namespace App
+  {
+    namespace
+    {
+      /**
+       * The total length of the npy header which is written, including the
+       * magic string and the length of the header dictionary. It is large
+       * enough for the shape of any array.
+       */
+      const size_t npy_header_length = 128;
+
+      /**
+       * Returns the type description of a 64 bit floating point number in
+       * the byte order of this machine in the notation of numpy.
+       */
+      std::string native_double_description()
+      {
+        const std::uint16_t value = 1;
+        return *reinterpret_cast<const unsigned char *>(&value) == 1 ? "<f8" : ">f8";
+      }
+
+
+      /**
+       * Returns the value of the key in the header dictionary of a npy file,
+       * without the surrounding whitespace.
+       */
+      std::string npy_header_value(const std::string &header, const std::string &key, const std::string &filename)
+      {
+        const size_t key_position = header.find("'" + key + "'");
+        WBAssertThrow(key_position != std::string::npos, "The npy file " << filename << " has no " << key << " in its header.");
+
+        size_t begin = header.find(':', key_position) + 1;
+        while (begin < header.size() && header[begin] == ' ')
+          ++begin;
+
+        // The shape is a tuple which contains commas, all other values end
+        // at the next comma.
+        const size_t end = header[begin] == '(' ? header.find(')', begin) + 1 : header.find_first_of(",}", begin);
+        WBAssertThrow(end != std::string::npos && end > begin, "Could not read the " << key << " from the header of the npy file " << filename << ".");
+        return header.substr(begin, end - begin);
+      }
+    }
+
+
+    DataFormat
+    data_format_from_filename(const std::string &filename)
+    {
+      const size_t dot = filename.find_last_of('.');
+      const std::string extension = dot == std::string::npos ? "" : filename.substr(dot);
+      if (extension == ".npy")
+        return DataFormat::npy;
+      if (extension == ".bin" || extension == ".raw")
+        return DataFormat::raw;
+      return DataFormat::text;
+    }
+
+
+    DataFormat
+    data_format_from_name(const std::string &name)
+    {
+      if (name == "text")
+        return DataFormat::text;
+      if (name == "raw")
+        return DataFormat::raw;
+      WBAssertThrow(name == "npy", "The data format " << name << " is not known. Valid formats are text, raw and npy.");
+      return DataFormat::npy;
+    }
+
+
+    MappedFile::MappedFile(const std::string &filename)
+      :
+      mapped_data(nullptr),
+      mapped_size(0)
+    {
+#ifndef _WIN32
+      const int descriptor = open(filename.c_str(), O_RDONLY);
+      WBAssertThrow(descriptor >= 0, "Could not open the file " << filename << ".");
+
+      struct stat file_status;
+      if (fstat(descriptor, &file_status) != 0)
+        {
+          close(descriptor);
+          WBAssertThrow(false, "Could not determine the size of the file " << filename << ".");
+        }
+
+      mapped_size = static_cast<size_t>(file_status.st_size);
+      if (mapped_size > 0)
+        {
+          void *mapping = mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+          close(descriptor);
+          WBAssertThrow(mapping != MAP_FAILED, "Could not map the file " << filename << " into memory.");
+          mapped_data = static_cast<const char *>(mapping);
+
+          // The points are read from the start to the end of the file.
+          madvise(mapping, mapped_size, MADV_SEQUENTIAL);
+        }
+      else
+        close(descriptor);
+#else
+      std::ifstream file(filename, std::ios::binary | std::ios::ate);
+      WBAssertThrow(file.is_open(), "Could not open the file " << filename << ".");
+      buffer.resize(static_cast<size_t>(file.tellg()));
+      file.seekg(0);
+      file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+      WBAssertThrow(file.good(), "Could not read the file " << filename << ".");
+      mapped_data = buffer.data();
+      mapped_size = buffer.size();
+#endif
+    }
+
+
+    MappedFile::~MappedFile()
+    {
+#ifndef _WIN32
+      if (mapped_data != nullptr)
+        munmap(const_cast<char *>(mapped_data), mapped_size);
+#endif
+    }
+
+
+    const char *
+    MappedFile::data() const
+    {
+      return mapped_data;
+    }
+
+
+    size_t
+    MappedFile::size() const
+    {
+      return mapped_size;
+    }
+
+
+    BinaryPointReader::BinaryPointReader(const std::string &filename, const DataFormat format, const size_t n_columns)
+      :
+      file(filename),
+      data_offset(0),
+      number_of_points(0),
+      number_of_columns(n_columns)
+    {
+      WBAssertThrow(format == DataFormat::raw || format == DataFormat::npy,
+                    "The binary point reader can only read raw and npy files.");
+
+      if (format == DataFormat::npy)
+        {
+          const char magic[] = "\x93NUMPY";
+          WBAssertThrow(file.size() >= 10 && std::memcmp(file.data(), magic, 6) == 0,
+                        "The file " << filename << " is not a npy file.");
+
+          const unsigned char *bytes = reinterpret_cast<const unsigned char *>(file.data());
+          const unsigned int major_version = bytes[6];
+          WBAssertThrow(major_version >= 1 && major_version <= 3, "The version " << major_version << " of the npy file " << filename << " is not supported.");
+
+          // Version 1 stores the length of the header in two bytes, later
+          // versions in four bytes, always as little endian.
+          size_t header_length = 0;
+          size_t header_start = 0;
+          if (major_version == 1)
+            {
+              header_length = static_cast<size_t>(bytes[8]) | (static_cast<size_t>(bytes[9]) << 8);
+              header_start = 10;
+            }
+          else
+            {
+              WBAssertThrow(file.size() >= 12, "The file " << filename << " is not a npy file.");
+              header_length = static_cast<size_t>(bytes[8]) | (static_cast<size_t>(bytes[9]) << 8)
+                              | (static_cast<size_t>(bytes[10]) << 16) | (static_cast<size_t>(bytes[11]) << 24);
+              header_start = 12;
+            }
+          WBAssertThrow(header_start + header_length <= file.size(), "The header of the npy file " << filename << " is incomplete.");
+
+          const std::string header(file.data() + header_start, header_length);
+          const std::string description = npy_header_value(header, "descr", filename);
+          WBAssertThrow(description == "'" + native_double_description() + "'",
+                        "The npy file " << filename << " has to contain 64 bit floating point numbers in the byte order of this machine ("
+                        << native_double_description() << "), but contains " << description << ".");
+          WBAssertThrow(npy_header_value(header, "fortran_order", filename) == "False",
+                        "The array in the npy file " << filename << " has to be stored in C order.");
+
+          // The shape has the form (rows, columns).
+          const std::string shape = npy_header_value(header, "shape", filename);
+          const size_t comma = shape.find(',');
+          WBAssertThrow(comma != std::string::npos && shape.find_first_of("0123456789", comma) != std::string::npos,
+                        "The array in the npy file " << filename << " has to be two dimensional, but has the shape " << shape << ".");
+          number_of_points = std::stoul(shape.substr(1, comma - 1));
+          const size_t columns = std::stoul(shape.substr(comma + 1));
+          WBAssertThrow(number_of_columns == 0 || number_of_columns == columns,
+                        "The array in the npy file " << filename << " has " << columns << " columns, but "
+                        << number_of_columns << " columns are required.");
+          number_of_columns = columns;
+
+          data_offset = header_start + header_length;
+          WBAssertThrow(data_offset + number_of_points * number_of_columns * sizeof(double) <= file.size(),
+                        "The npy file " << filename << " is smaller than its header says.");
+        }
+      else
+        {
+          WBAssertThrow(number_of_columns > 0, "The number of columns of the raw file " << filename << " has to be given.");
+          WBAssertThrow(file.size() % (number_of_columns * sizeof(double)) == 0,
+                        "The size of the raw file " << filename << " is not a multiple of the size of a row of "
+                        << number_of_columns << " 64 bit floating point numbers.");
+          number_of_points = file.size() / (number_of_columns * sizeof(double));
+        }
+
+      WBAssertThrow(number_of_points == 0 || reinterpret_cast<std::uintptr_t>(file.data() + data_offset) % alignof(double) == 0,
+                    "The points in the file " << filename << " are not aligned in memory.");
+    }
+
+
+    size_t
+    BinaryPointReader::n_points() const
+    {
+      return number_of_points;
+    }
+
+
+    size_t
+    BinaryPointReader::n_columns() const
+    {
+      return number_of_columns;
+    }
+
+
+    const double *
+    BinaryPointReader::point(const size_t index) const
+    {
+      return reinterpret_cast<const double *>(file.data() + data_offset) + index * number_of_columns;
+    }
+
+
+    std::string
+    npy_header(const size_t n_rows, const size_t n_columns)
+    {
+      std::string dictionary = "{'descr': '" + native_double_description() + "', 'fortran_order': False, 'shape': ("
+                               + std::to_string(n_rows) + ", " + std::to_string(n_columns) + "), }";
+
+      // The header is padded with spaces and ends with a newline, so that
+      // the data starts at a multiple of 64 bytes.
+      const size_t dictionary_length = npy_header_length - 10;
+      WBAssertThrow(dictionary.size() < dictionary_length, "The npy header is too long.");
+      dictionary.resize(dictionary_length - 1, ' ');
+      dictionary += '\n';
+
+      std::string header("\x93NUMPY\x01\x00", 8);
+      header += static_cast<char>(dictionary_length & 0xff);
+      header += static_cast<char>(dictionary_length >> 8);
+      return header + dictionary;
+    }
+  }
+}
@@ -0,0 +1,170 @@
+/*
+  Copyright (C) 2020 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/**
+ * Measures how fast the lines of a data file of the app are parsed and how
+ * fast the lines of the output are formatted, once with streams, as the app
+ * used to do, and once with the locale independent functions of the
+ * utilities which the app uses now. The lines are read from the data file
+ * given on the command line, or are generated if no file is given, and are
+ * processed a number of times.
+ */
+
+#include "world_builder/utilities.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace WorldBuilder::Utilities;
+
+namespace
+{
+  /**
+   * Returns the number of seconds the function takes to process all lines.
+   */
+  template<class Function>
+  double time_lines(const std::vector<std::string> &lines, const Function &function)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    for (const std::string &line : lines)
+      function(line);
+    const auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(stop - start).count();
+  }
+
+  void report(const std::string &name, const size_t n_lines, const double seconds_old, const double seconds_new)
+  {
+    std::cout << name << ": " << static_cast<double>(n_lines) / seconds_old << " lines/s with streams, "
+              << static_cast<double>(n_lines) / seconds_new << " lines/s with the utilities, a speedup of "
+              << seconds_old / seconds_new << "." << std::endl;
+  }
+}
+
+
+int main(int argc, char **argv)
+{
+  const size_t n_repetitions = argc > 2 ? string_to_unsigned_int(argv[2]) : 100000;
+
+  // The lines with points of the data file, or random points in 3d.
+  std::vector<std::string> points;
+  if (argc > 1)
+    {
+      std::ifstream data_file(argv[1]);
+      WBAssertThrow(data_file.good(), "Could not open the data file " << argv[1] << ".");
+      std::string line;
+      while (std::getline(data_file, line))
+        if (!line.empty() && line[0] != '#')
+          points.push_back(line);
+      WBAssertThrow(!points.empty(), "The data file " << argv[1] << " does not contain any points.");
+    }
+  else
+    {
+      std::mt19937 random_number_generator(0);
+      std::uniform_real_distribution<double> coordinate(0, 2e6);
+      std::uniform_real_distribution<double> depth(0, 6e5);
+      std::ostringstream line;
+      line.precision(17);
+      for (size_t i = 0; i < 1000; ++i)
+        {
+          line.str("");
+          line << coordinate(random_number_generator) << " " << coordinate(random_number_generator) << " "
+               << coordinate(random_number_generator) << " " << depth(random_number_generator) << " 9.81";
+          points.push_back(line.str());
+        }
+    }
+
+  std::vector<std::string> lines;
+  lines.reserve(n_repetitions);
+  for (size_t i = 0; i < n_repetitions; ++i)
+    lines.push_back(points[i % points.size()]);
+
+  // The result of every test is summed, so that the work can not be
+  // optimized away.
+  double sum = 0;
+  std::vector<double> numbers;
+
+  const double parse_old = time_lines(lines, [&](const std::string &line)
+  {
+    std::istringstream buffer(line);
+    std::vector<std::string> words((std::istream_iterator<std::string>(buffer)),
+                                   std::istream_iterator<std::string>());
+    for (auto &word : words)
+      {
+        word.erase(std::remove(word.begin(), word.end(), ','), word.end());
+        std::istringstream word_stream(word);
+        double value = 0;
+        word_stream >> value;
+        sum += value;
+      }
+  });
+
+  const double parse_new = time_lines(lines, [&](const std::string &line)
+  {
+    for (const std::string &word : split_data_line(line))
+      sum += string_to_double(word);
+  });
+
+  report("parsing", lines.size(), parse_old, parse_new);
+
+  // Format the numbers of the line and eight more values like a line of
+  // the output of the app.
+  for (const std::string &word : split_data_line(points[0]))
+    numbers.push_back(string_to_double(word));
+  for (size_t i = 0; i < 8; ++i)
+    numbers.push_back(1600.0 + 0.123456789 * static_cast<double>(i));
+
+  size_t n_characters = 0;
+  const double format_old = time_lines(lines, [&](const std::string &)
+  {
+    static std::ostringstream line;
+    line.str("");
+    line.clear();
+    for (const double number : numbers)
+      line << number << " ";
+    line << "\n";
+    n_characters += line.str().size();
+  });
+
+  std::string formatted_line;
+  const double format_new = time_lines(lines, [&](const std::string &)
+  {
+    formatted_line.clear();
+    char buffer[32];
+    for (const double number : numbers)
+      {
+        formatted_line.append(buffer, format_double(number, 6, buffer));
+        formatted_line += ' ';
+      }
+    formatted_line += '\n';
+    n_characters += formatted_line.size();
+  });
+
+  report("formatting", lines.size(), format_old, format_new);
+
+  std::cout << "(checksum " << sum << ", " << n_characters << " characters)" << std::endl;
+  return 0;
+}
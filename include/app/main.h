@@ -20,8 +20,113 @@
 #ifndef WORLD_BUILDER_APP_MAIN_H_
 #define WORLD_BUILDER_APP_MAIN_H_
 
+#include "app/point_file.h"
+
+#include <cstddef>
+#include <iosfwd>
 #include <string>
+#include <vector>
+
+namespace WorldBuilder
+{
+  class ThreadPool;
+  class World;
+}
+
+/**
+ * The settings of a data file, which are given in the comment lines at the
+ * start of the file, e.g. "# dim = 2".
+ */
+struct DataConfiguration
+{
+  unsigned int dim = 3;
+  unsigned int compositions = 0;
+  unsigned int grain_compositions = 0;
+  size_t number_of_grains = 0;
+};
+
+std::vector<std::string> get_command_line_options_vector(int argc, char **argv);
 
 bool find_command_line_option(char **begin, char **end, const std::string &option);
 
+/**
+ * Removes the option and the value after it from the options if it is
+ * present, and returns whether it was present.
+ */
+bool take_command_line_option(std::vector<std::string> &options_vector, const std::string &option, std::string &value);
+
+/**
+ * Reads the configuration from a line of the data file if it sets one of
+ * the settings. Returns whether the line is a comment line.
+ */
+bool read_configuration_line(const std::vector<std::string> &line, DataConfiguration &configuration);
+
+/**
+ * Writes the line with the names of the columns of the output.
+ */
+void write_header(std::ostream &output, const DataConfiguration &configuration);
+
+/**
+ * Returns the number of values which are computed for every point: the
+ * temperature, the compositions and for every grain composition and grain
+ * the size and the nine entries of the rotation matrix.
+ */
+size_t n_output_values(const DataConfiguration &configuration);
+
+/**
+ * Evaluates the world at one point. The input contains the dim coordinates,
+ * the depth and the gravity of the point, the output is filled with the
+ * n_output_values(configuration) values of the point.
+ */
+void evaluate_point(const WorldBuilder::World &world,
+                    const DataConfiguration &configuration,
+                    const double *input,
+                    double *output);
+
+/**
+ * Appends lines of the input to the vector, up to n_lines lines and as long
+ * as the lines start before the end position. The position is the position
+ * of the input in bytes and is advanced over the lines which are read.
+ * Returns the number of lines which were read.
+ */
+size_t read_lines(std::istream &input, size_t n_lines, size_t &position, size_t end, std::vector<std::string> &lines);
+
+/**
+ * Returns the position in bytes of the first line which starts at or after
+ * the given position in the input.
+ */
+size_t next_line_start(std::istream &input, size_t position);
+
+/**
+ * Evaluates all the points of the data file and writes them together with
+ * the results to the output file, or to the screen if no output file is
+ * given. The configuration is used for binary data files, a text data file
+ * can change it in its header. The file is read, evaluated and written in
+ * blocks of points, so that it does not need to fit into memory. The points
+ * of a block are evaluated in parallel with the thread pool, and the results
+ * are written in the order of the input.
+ *
+ * With more than one MPI process, every process evaluates its own range of
+ * the data file: a range of bytes of a text file, split at the starts of
+ * lines, or a range of points of a binary file. The results of every
+ * process are written to a temporary file first, and are then written to
+ * their place in the output file with MPI-IO, or sent to the first process
+ * which writes them to the screen, so that the output is the same as with
+ * a single process.
+ *
+ * The numbers of a text output are written with the given number of
+ * significant digits, or with the fewest digits which read back as exactly
+ * the same numbers if the precision is zero.
+ */
+void evaluate_data_file(const WorldBuilder::World &world,
+                        DataConfiguration configuration,
+                        const std::string &data_file,
+                        WorldBuilder::App::DataFormat input_format,
+                        const std::string &output_file,
+                        WorldBuilder::App::DataFormat output_format,
+                        unsigned int precision,
+                        WorldBuilder::ThreadPool &pool,
+                        int mpi_rank,
+                        int mpi_size);
+
 #endif
@@ -0,0 +1,136 @@
+/*
+  Copyright (C) 2020 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef WORLD_BUILDER_APP_POINT_FILE_H_
+#define WORLD_BUILDER_APP_POINT_FILE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace WorldBuilder
+{
+  namespace App
+  {
+    /**
+     * The formats of the data files the app can read and write. The text
+     * format has the points in columns separated by spaces, with the
+     * settings in comment lines at the start. The raw format contains the
+     * points as 64 bit floating point numbers in the byte order of the
+     * machine, one row after another, without any header. The npy format is
+     * the format of numpy, with a two dimensional array of 64 bit floating
+     * point numbers.
+     */
+    enum class DataFormat
+    {
+      text,
+      raw,
+      npy
+    };
+
+    /**
+     * Returns the format of a data file from the extension of its name:
+     * .npy files are in the npy format, .bin and .raw files in the raw
+     * format and all other files in the text format.
+     */
+    DataFormat data_format_from_filename(const std::string &filename);
+
+    /**
+     * Returns the format with the given name, which is text, raw or npy.
+     */
+    DataFormat data_format_from_name(const std::string &name);
+
+    /**
+     * A file which is mapped into memory for reading. On systems without
+     * mmap the file is read into memory instead.
+     */
+    class MappedFile
+    {
+      public:
+        explicit MappedFile(const std::string &filename);
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        /**
+         * Returns a pointer to the contents of the file.
+         */
+        const char *data() const;
+
+        /**
+         * Returns the size of the file in bytes.
+         */
+        size_t size() const;
+
+      private:
+        const char *mapped_data;
+        size_t mapped_size;
+        std::vector<char> buffer;
+    };
+
+    /**
+     * Reads the points from a data file in the raw or npy format. The file
+     * is memory mapped, so only the parts of the file which are used are
+     * read from the disk.
+     */
+    class BinaryPointReader
+    {
+      public:
+        /**
+         * Opens the file. For the raw format, the number of columns has to
+         * be given. For the npy format it is taken from the shape of the
+         * array, and if n_columns is not zero it has to be the same.
+         */
+        BinaryPointReader(const std::string &filename, DataFormat format, size_t n_columns);
+
+        /**
+         * Returns the number of points, which are the rows of the array.
+         */
+        size_t n_points() const;
+
+        /**
+         * Returns the number of columns of the array.
+         */
+        size_t n_columns() const;
+
+        /**
+         * Returns a pointer to the first column of the given point.
+         */
+        const double *point(size_t index) const;
+
+      private:
+        MappedFile file;
+        size_t data_offset;
+        size_t number_of_points;
+        size_t number_of_columns;
+    };
+
+    /**
+     * Returns the header of a npy file with a two dimensional array of 64 bit
+     * floating point numbers with the given shape. The header always has the
+     * same length, so that it can be written before the number of rows is
+     * known and be overwritten afterwards.
+     */
+    std::string npy_header(size_t n_rows, size_t n_columns);
+  }
+}
+
+#endif
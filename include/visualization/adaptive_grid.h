@@ -0,0 +1,162 @@
+/*
+  Copyright (C) 2018 - 2021 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef WORLD_BUILDER_VISUALIZATION_ADAPTIVE_GRID_H_
+#define WORLD_BUILDER_VISUALIZATION_ADAPTIVE_GRID_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace WorldBuilder
+{
+  class ThreadPool;
+  class World;
+
+  namespace Visualization
+  {
+    /**
+     * A grid which is adaptively refined where the world has structure. It
+     * starts from the uniform grid with n_cell_x, n_cell_y and n_cell_z cells
+     * and splits every cell into 2^dim children when the temperature at its
+     * center differs from the average temperature of its corners, or one of
+     * the compositions at its corners and its center differs, by more than
+     * the given differences, until the maximum refinement level is reached.
+     * Cells in a part of the world without features, like most of the
+     * mantle, are therefore not refined at all.
+     *
+     * The resulting mesh is not conforming: a coarse cell next to refined
+     * cells does not have the points in the middle of its faces, which is
+     * fine for visualization in paraview. Every point of the mesh is only
+     * evaluated once, and the evaluations of every refinement level are
+     * done in parallel with the thread pool.
+     *
+     * Only the cartesian and chunk grid types are supported. For the chunk,
+     * the cells are refined in longitude, latitude and radius, which have to
+     * be given in radians and meters.
+     *
+     * Every coarse cell is refined independently of the others, so the grid
+     * can be split into pieces by only refining the coarse cells
+     * [first_coarse_cell, last_coarse_cell). The coarse cells are numbered
+     * with the z (or radius) index varying fastest and the x (or longitude)
+     * index varying slowest, so a range of coarse cells is a slab of the
+     * grid.
+     */
+    class AdaptiveGrid
+    {
+      public:
+        /**
+         * Creates and refines the coarse cells [first_coarse_cell,
+         * last_coarse_cell) of the grid.
+         */
+        AdaptiveGrid(const WorldBuilder::World &world,
+                     const std::string &grid_type,
+                     size_t dim,
+                     double gravity,
+                     size_t compositions,
+                     double x_min, double x_max,
+                     double y_min, double y_max,
+                     double z_min, double z_max,
+                     size_t n_cell_x, size_t n_cell_y, size_t n_cell_z,
+                     size_t max_refinement_level,
+                     double temperature_difference,
+                     double composition_difference,
+                     size_t first_coarse_cell,
+                     size_t last_coarse_cell,
+                     WorldBuilder::ThreadPool &pool);
+
+        /**
+         * The coordinates of the points, three per point. In 2d, the
+         * position is (x,z,0).
+         */
+        std::vector<double> points;
+
+        /**
+         * The vertices of the cells one after another, four per cell in 2d
+         * and eight per cell in 3d, in the vtk ordering.
+         */
+        std::vector<std::int64_t> connectivity;
+
+        /**
+         * The values at the points: the depth, the temperature and then all
+         * the compositions.
+         */
+        std::vector<std::vector<double> > values;
+
+        /**
+         * The number of cells of the grid on every refinement level from
+         * zero to the maximum refinement level, which shows how much the
+         * grid has been refined.
+         */
+        std::vector<size_t> n_cells_per_level;
+
+      private:
+        /**
+         * A cell of the grid, given by its lower corner and its size on an
+         * integer lattice which has 2^max_refinement_level lattice points in
+         * every coarse cell in every direction.
+         */
+        struct Cell
+        {
+          std::uint64_t corner[3];
+          std::uint64_t size;
+        };
+
+        /**
+         * Returns the key of a lattice point in the map of evaluated points.
+         */
+        static std::uint64_t key(std::uint64_t i, std::uint64_t j, std::uint64_t k);
+
+        /**
+         * Evaluates all the lattice points in the list which have not been
+         * evaluated before, in parallel, and stores their values.
+         */
+        void evaluate(const std::vector<std::uint64_t> &keys);
+
+        /**
+         * Returns the lattice points of a cell: its 2^dim corners in the vtk
+         * ordering, followed by its center if with_center is true.
+         */
+        std::vector<std::uint64_t> cell_points(const Cell &cell, bool with_center) const;
+
+        const WorldBuilder::World &world;
+        std::string grid_type;
+        size_t dim;
+        double gravity;
+        size_t compositions;
+        double min[3];
+        double lattice_spacing[3];
+        double surface;
+        WorldBuilder::ThreadPool &pool;
+
+        /**
+         * The index of every lattice point which has been evaluated in the
+         * vectors below.
+         */
+        std::unordered_map<std::uint64_t, size_t> evaluated_index;
+        std::vector<std::array<double,3> > evaluated_positions;
+        std::vector<std::vector<double> > evaluated_values;
+    };
+  }
+}
+
+#endif
@@ -20,11 +20,56 @@
 #ifndef WORLD_BUILDER_VISUALIZATION_MAIN_H_
 #define WORLD_BUILDER_VISUALIZATION_MAIN_H_
 
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <vector>
 #include <string>
 
+namespace WorldBuilder
+{
+  class ThreadPool;
+  class World;
+
+  namespace Visualization
+  {
+    class RawBinaryXdmfWriter;
+  }
+}
+
+/**
+ * A grid which can compute each of its points and cells from their index,
+ * so that the grid can be generated in chunks without ever storing all of
+ * it. The points and cells are numbered in the same way as in the grids
+ * which are built in main(). In 2d, the position of a point is (x,z,0).
+ * The slices and isosurfaces are surfaces in a 3d world, whose cells are
+ * quadrilaterals or triangles.
+ */
+struct GridGenerator
+{
+  size_t n_points;
+  size_t n_cells;
+  size_t n_vertices_per_cell;
+  std::int8_t cell_type;
+
+  /**
+   * Computes the position and depth of the point with the given index.
+   */
+  std::function<void(size_t, std::array<double,3> &, double &)> point;
+
+  /**
+   * Computes the vertices of the cell with the given index and writes them
+   * to the array, which has room for n_vertices_per_cell vertices.
+   */
+  std::function<void(size_t, std::int64_t *)> cell;
+};
+
 void project_on_sphere(double, double &, double &, double &);
 
+std::vector<std::array<double,4> > compute_shell_directions(const std::vector<double> &shell_grid_x,
+                                                             const std::vector<double> &shell_grid_y,
+                                                             const std::vector<double> &shell_grid_z);
+
 void lay_points(double x1, double y1, double z1,
                 double x2, double y2, double z2,
                 double x3, double y3, double z3,
@@ -32,6 +77,69 @@ void lay_points(double x1, double y1, double z1,
                 std::vector<double> &x, std::vector<double> &y, std::vector<double> &z,
                 std::vector<bool> &hull, size_t level);
 
+void create_sphere_shell(size_t n_cell_x,
+                         std::vector<double> &shell_grid_x,
+                         std::vector<double> &shell_grid_y,
+                         std::vector<double> &shell_grid_z,
+                         std::vector<size_t> &shell_grid_connectivity,
+                         WorldBuilder::ThreadPool &pool);
+
+GridGenerator create_grid_generator(const std::string &grid_type, size_t dim,
+                                    double x_min, double x_max,
+                                    double y_min, double y_max,
+                                    double z_min, double z_max,
+                                    size_t n_cell_x, size_t n_cell_y, size_t n_cell_z,
+                                    WorldBuilder::ThreadPool &pool);
+
+GridGenerator create_plane_generator(const std::array<double,3> &origin,
+                                     const std::array<double,3> &direction_1,
+                                     const std::array<double,3> &direction_2,
+                                     double surface,
+                                     size_t n_cell_1, size_t n_cell_2);
+
+GridGenerator create_great_circle_generator(double start_longitude, double start_latitude,
+                                            double end_longitude, double end_latitude,
+                                            double inner_radius, double outer_radius,
+                                            size_t n_cell_x, size_t n_cell_z);
+
+GridGenerator create_depth_shell_generator(double x_min, double x_max,
+                                           double y_min, double y_max,
+                                           double outer_radius, double depth,
+                                           size_t n_cell_x, size_t n_cell_y);
+
+GridGenerator create_isosurface_generator(const GridGenerator &volume,
+                                          const WorldBuilder::World &world,
+                                          double gravity,
+                                          double temperature,
+                                          WorldBuilder::ThreadPool &pool);
+
+void write_vtu_piece(const GridGenerator &grid,
+                     const WorldBuilder::World &world,
+                     size_t dim,
+                     double gravity,
+                     size_t compositions,
+                     size_t first_cell,
+                     size_t last_cell,
+                     const std::string &filename,
+                     const std::string &vtu_output_format,
+                     size_t chunk_size,
+                     WorldBuilder::ThreadPool *pool);
+
+void write_raw_binary_range(const GridGenerator &grid,
+                            const WorldBuilder::World &world,
+                            size_t dim,
+                            double gravity,
+                            size_t compositions,
+                            const WorldBuilder::Visualization::RawBinaryXdmfWriter &writer,
+                            size_t first_point,
+                            size_t last_point,
+                            size_t first_cell,
+                            size_t last_cell,
+                            size_t chunk_size,
+                            WorldBuilder::ThreadPool &pool);
+
+void run_on_first_process(const std::function<void()> &function, int mpi_rank);
+
 std::vector<std::string> get_command_line_options_vector(int argc, char **argv);
 
 bool find_command_line_option(char **begin, char **end, const std::string &option);
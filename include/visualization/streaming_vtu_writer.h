@@ -0,0 +1,243 @@
+/*
+  Copyright (C) 2018 - 2021 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef WORLD_BUILDER_VISUALIZATION_STREAMING_VTU_WRITER_H_
+#define WORLD_BUILDER_VISUALIZATION_STREAMING_VTU_WRITER_H_
+
+#include "world_builder/assert.h"
+
+#include "vtu11/vtu11.hpp"
+#undef max
+#undef min
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace WorldBuilder
+{
+  namespace Visualization
+  {
+    /**
+     * Writes a vtu file for an unstructured grid without holding the data of
+     * the grid in memory. The data arrays are passed to the writer in chunks
+     * of arbitrary size. Each chunk is encoded (and compressed for the
+     * RawBinaryCompressed format) right away and stored in a temporary file
+     * next to the output file. When finish() is called, the xml header with
+     * the offsets of all arrays is written, followed by the encoded data from
+     * the temporary file. The memory use of the writer is therefore bounded
+     * by the size of one compression block, independent of the grid size.
+     *
+     * The files are byte for byte the same as the files which vtu11 writes
+     * for the same data in the ascii, rawbinary and rawbinarycompressed
+     * formats.
+     */
+    class StreamingVtuWriter
+    {
+      public:
+        /**
+         * The part of the vtu file an array belongs to.
+         */
+        enum class Section
+        {
+          point_data,
+          cell_data,
+          points,
+          cells
+        };
+
+        /**
+         * Constructor. The output format is one of the vtu11 formats ascii,
+         * rawbinary and rawbinarycompressed (case insensitive).
+         */
+        StreamingVtuWriter(const std::string &filename,
+                           const std::string &output_format,
+                           size_t n_points,
+                           size_t n_cells);
+
+        /**
+         * Destructor. Removes the temporary file.
+         */
+        ~StreamingVtuWriter();
+
+        StreamingVtuWriter(const StreamingVtuWriter &) = delete;
+        StreamingVtuWriter &operator=(const StreamingVtuWriter &) = delete;
+
+        /**
+         * Starts a new data array. The arrays within a section are written in
+         * the order in which they are started. An empty name is used for the
+         * points, which have no name in the vtu format.
+         */
+        template<typename T>
+        void begin_array(Section section, const std::string &name, size_t n_components);
+
+        /**
+         * Appends n values to the current array.
+         */
+        template<typename T>
+        void append(const T *data, size_t n);
+
+        /**
+         * Appends all values of the vector to the current array.
+         */
+        template<typename T>
+        void append(const std::vector<T> &data);
+
+        /**
+         * Ends the current array.
+         */
+        void end_array();
+
+        /**
+         * Writes the vtu file from the arrays which have been ended.
+         */
+        void finish();
+
+      private:
+        /**
+         * The information needed to write an array into the vtu file. The
+         * encoded data of the array is stored in the temporary file from
+         * data_begin to data_end.
+         */
+        struct ArrayInfo
+        {
+          Section section;
+          std::string name;
+          std::string type;
+          size_t n_components;
+          size_t type_size;
+          std::streamoff data_begin;
+          std::streamoff data_end;
+          std::vector<vtu11::HeaderType> header;
+        };
+
+        /**
+         * Writes the ascii representation of the values to the temporary file.
+         */
+        template<typename T>
+        void write_ascii(const T *data, size_t n);
+
+        /**
+         * Adds bytes to the current array for the binary formats. Complete
+         * compression blocks are compressed and written to the temporary
+         * file.
+         */
+        void write_binary(const char *data, size_t n_bytes);
+
+        /**
+         * Compresses the bytes in the block buffer and writes them to the
+         * temporary file.
+         */
+        void compress_block();
+
+        /**
+         * Copies the encoded data of an array from the temporary file to the
+         * output file.
+         */
+        void copy_data(const ArrayInfo &array, std::ostream &output);
+
+        std::string filename;
+        std::string temporary_filename;
+        std::string format;
+        size_t n_points;
+        size_t n_cells;
+
+        std::fstream temporary_file;
+        std::streamoff temporary_file_size;
+
+        std::vector<ArrayInfo> arrays;
+        bool array_open;
+        size_t n_bytes_in_array;
+
+        /**
+         * The block size vtu11 uses for compressing data.
+         */
+        static const size_t block_size = 32768;
+        std::vector<char> block;
+        std::vector<unsigned char> compressed_block;
+    };
+
+
+    template<typename T>
+    void
+    StreamingVtuWriter::begin_array(const Section section, const std::string &name, const size_t n_components)
+    {
+      WBAssertThrow(!array_open, "The array " << arrays.back().name << " has not been ended before starting the array " << name << ".");
+      ArrayInfo array;
+      array.section = section;
+      array.name = name;
+      array.type = vtu11::dataTypeString<T>();
+      array.n_components = n_components;
+      array.type_size = sizeof(T);
+      array.data_begin = temporary_file_size;
+      array.data_end = temporary_file_size;
+      arrays.emplace_back(array);
+      array_open = true;
+      n_bytes_in_array = 0;
+      block.clear();
+    }
+
+
+    template<typename T>
+    void
+    StreamingVtuWriter::append(const T *data, const size_t n)
+    {
+      WBAssertThrow(array_open, "No array has been started to append data to.");
+      WBAssertThrow(sizeof(T) == arrays.back().type_size && vtu11::dataTypeString<T>() == arrays.back().type,
+                    "The type of the data does not match the type of the array " << arrays.back().name << ".");
+      if (format == "ascii")
+        write_ascii(data, n);
+      else
+        write_binary(reinterpret_cast<const char *>(data), n * sizeof(T));
+    }
+
+
+    template<typename T>
+    void
+    StreamingVtuWriter::append(const std::vector<T> &data)
+    {
+      append(data.data(), data.size());
+    }
+
+
+    template<typename T>
+    void
+    StreamingVtuWriter::write_ascii(const T *data, const size_t n)
+    {
+      char buffer[64];
+      for (size_t i = 0; i < n; ++i)
+        {
+          vtu11::detail::writeNumber(buffer, data[i]);
+          temporary_file << buffer << " ";
+        }
+    }
+
+
+    template<>
+    inline void
+    StreamingVtuWriter::write_ascii(const vtu11::VtkCellType *data, const size_t n)
+    {
+      for (size_t i = 0; i < n; ++i)
+        temporary_file << static_cast<int>(data[i]) << " ";
+    }
+  }
+}
+
+#endif
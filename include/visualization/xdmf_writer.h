@@ -0,0 +1,107 @@
+/*
+  Copyright (C) 2018 - 2021 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef WORLD_BUILDER_VISUALIZATION_XDMF_WRITER_H_
+#define WORLD_BUILDER_VISUALIZATION_XDMF_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace WorldBuilder
+{
+  namespace Visualization
+  {
+    /**
+     * Writes an unstructured grid as a set of raw binary files, one for the
+     * points, one for the connectivity and one for every field, together
+     * with a small XDMF file which describes them, so that the grid can be
+     * opened in Paraview. The raw files contain the values without any
+     * header or encoding in the byte order of the machine, which is also
+     * stated in the XDMF file. They can therefore be memory mapped by other
+     * programs, for example with numpy.memmap.
+     *
+     * The files are created with their final size by create(). After that,
+     * every range of points or cells can be written independently at its
+     * own offset in the files, so different threads or processes can write
+     * different parts of the grid at the same time.
+     */
+    class RawBinaryXdmfWriter
+    {
+      public:
+        /**
+         * Constructor. The files are named after the base filename, which
+         * is the name of the XDMF file without the .xdmf extension. The
+         * points are always stored with three coordinates.
+         */
+        RawBinaryXdmfWriter(const std::string &base_filename,
+                            size_t n_points,
+                            size_t n_cells,
+                            size_t n_vertices_per_cell,
+                            const std::vector<std::string> &field_names);
+
+        /**
+         * Writes the XDMF file and creates all the raw binary files with
+         * their final size. This has to be done once, before any data is
+         * written.
+         */
+        void create() const;
+
+        /**
+         * Writes the coordinates of the points starting at first_point. The
+         * size of the vector is three times the number of points.
+         */
+        void write_points(size_t first_point, const std::vector<double> &coordinates) const;
+
+        /**
+         * Writes the vertices of the cells starting at first_cell. The size of
+         * the vector is n_vertices_per_cell times the number of cells.
+         */
+        void write_cells(size_t first_cell, const std::vector<std::int64_t> &vertices) const;
+
+        /**
+         * Writes the values of a field at the points starting at first_point.
+         */
+        void write_field(size_t field, size_t first_point, const std::vector<double> &values) const;
+
+        /**
+         * Returns the name of the raw binary file which contains the field
+         * with the given index.
+         */
+        std::string field_filename(size_t field) const;
+
+      private:
+        /**
+         * Writes n_bytes bytes to the file at the given offset. The file is
+         * opened for every write, so that concurrent writes to different
+         * parts of the same file do not share a stream.
+         */
+        void write_at(const std::string &filename, size_t offset, const char *data, size_t n_bytes) const;
+
+        std::string base_filename;
+        size_t n_points;
+        size_t n_cells;
+        size_t n_vertices_per_cell;
+        std::vector<std::string> field_names;
+    };
+  }
+}
+
+#endif
@@ -6264,6 +6264,7 @@ inline StringStringMap RawBinaryAppendedWriter::appendedAttributes( )
 #endif // VTU11_WRITER_IMPL_HPP
 
 #ifndef VTU11_ZLIBWRITER_IMPL_HPP
+#define VTU11_ZLIBWRITER_IMPL_HPP
 
 #ifdef VTU11_ENABLE_ZLIB
 #include "zlib.h"
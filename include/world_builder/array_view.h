@@ -0,0 +1,101 @@
+/*
+  Copyright (C) 2021 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef WORLD_BUILDER_ARRAY_VIEW_H
+#define WORLD_BUILDER_ARRAY_VIEW_H
+
+#include <cstddef>
+#include <vector>
+
+namespace WorldBuilder
+{
+  namespace Utilities
+  {
+    /**
+     * A read-only view of values which are stored contiguously in memory
+     * owned by someone else, like a std::vector or a NodeSharedArray. It
+     * allows functions to read the values in place, independent of where
+     * they are stored. The values have to outlive the view.
+     */
+    template <class T>
+    class ArrayView
+    {
+      public:
+        /**
+         * Constructor for an empty view.
+         */
+        ArrayView()
+          :
+          first(nullptr),
+          n_values(0)
+        {}
+
+        /**
+         * Constructor for a view of n_values_ values starting at first_.
+         */
+        ArrayView(const T *first_, const size_t n_values_)
+          :
+          first(first_),
+          n_values(n_values_)
+        {}
+
+        /**
+         * Constructor for a view of the values of a vector. It is implicit,
+         * so that vectors can be passed directly to functions which take a
+         * view.
+         */
+        ArrayView(const std::vector<T> &vector)
+          :
+          first(vector.data()),
+          n_values(vector.size())
+        {}
+
+        const T *begin() const
+        {
+          return first;
+        }
+
+        const T *end() const
+        {
+          return first + n_values;
+        }
+
+        size_t size() const
+        {
+          return n_values;
+        }
+
+        bool empty() const
+        {
+          return n_values == 0;
+        }
+
+        const T &operator[](const size_t i) const
+        {
+          return first[i];
+        }
+
+      private:
+        const T *first;
+        size_t n_values;
+    };
+  } // namespace Utilities
+} // namespace WorldBuilder
+
+#endif
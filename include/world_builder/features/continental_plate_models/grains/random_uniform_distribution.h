@@ -23,6 +23,8 @@
 
 #include "world_builder/features/continental_plate_models/grains/interface.h"
 
+#include <cstdint>
+
 namespace WorldBuilder
 {
   class Parameters;
@@ -82,13 +84,13 @@ namespace WorldBuilder
             void parse_entries(Parameters &prm) override final;
 
             /**
-             * Returns a grains based on the given position, composition (e.g.
+             * Fills in the grains based on the given position, composition (e.g.
              * olivine and/or enstatite)depth in the model, gravity and current grains.
              */
-            WorldBuilder::grains
+            void
             get_grains(const Point<3> &position, const double depth,
                        const unsigned int composition_number,
-                       WorldBuilder::grains grains,
+                       WorldBuilder::grains_view grains,
                        const double feature_min_depth,
                        const double feature_max_depth) const override final;
 
@@ -101,6 +103,13 @@ namespace WorldBuilder
             std::string operation;
             std::vector<double> grain_sizes;
             std::vector<bool> normalize_grain_sizes;
+
+            /**
+             * The key of the random numbers of this model, which is computed from
+             * the seed of the world and the location of the model in the world
+             * builder file.
+             */
+            std::uint64_t random_number_key;
         };
       } // namespace Grains
     }   // namespace ContinentalPlateModels
@@ -80,13 +80,13 @@ namespace WorldBuilder
             void parse_entries(Parameters &prm) override final;
 
             /**
-             * Returns a grains based on the given position, composition (e.g.
+             * Fills in the grains based on the given position, composition (e.g.
              * olivine and/or enstatite)depth in the model, gravity and current grains.
              */
-            WorldBuilder::grains
+            void
             get_grains(const Point<3> &position, const double depth,
                        const unsigned int composition_number,
-                       WorldBuilder::grains grains,
+                       WorldBuilder::grains_view grains,
                        const double feature_min_depth,
                        const double feature_max_depth) const override final;
 
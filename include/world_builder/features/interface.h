@@ -22,6 +22,7 @@
 
 
 #include "world_builder/grains.h"
+#include "world_builder/node_shared_array.h"
 #include "world_builder/utilities.h"
 
 namespace WorldBuilder
@@ -60,7 +61,8 @@ namespace WorldBuilder
         declare_interface_entries(Parameters &prm,
                                   const CoordinateSystem coordinate_system);
         /**
-         * helper function to parse coordinates.
+         * helper function to parse coordinates. The interpolation of the
+         * coordinates is done later in prepare().
          */
         void
         get_coordinates(const std::string &name,
@@ -81,6 +83,16 @@ namespace WorldBuilder
         virtual
         void parse_entries(Parameters &prm) = 0;
 
+        /**
+         * Compute the data which can be derived from the entries read in
+         * parse_entries, like the interpolated coordinates. This function
+         * does not access the parameters, so the world calls it in parallel
+         * for all features after all features have been parsed. Features
+         * which override this function need to call this base version first.
+         */
+        virtual
+        void prepare();
+
 
         /**
          * takes temperature and position and returns a temperature.
@@ -107,11 +119,11 @@ namespace WorldBuilder
          * given position and composition number
          */
         virtual
-        WorldBuilder::grains grains(const Point<3> &position_in_cartesian_coordinates,
-                                    const WorldBuilder::Utilities::NaturalCoordinate &position_in_natural_coordinates,
-                                    const double depth,
-                                    const unsigned int composition_number,
-                                    WorldBuilder::grains value) const = 0;
+        void grains(const Point<3> &position_in_cartesian_coordinates,
+                    const WorldBuilder::Utilities::NaturalCoordinate &position_in_natural_coordinates,
+                    const double depth,
+                    const unsigned int composition_number,
+                    WorldBuilder::grains_view value) const = 0;
 
 
         /**
@@ -157,9 +169,19 @@ namespace WorldBuilder
         std::size_t original_number_of_coordinates;
 
         /**
-         * The coordinates at the surface of the feature
+         * The coordinates at the surface of the feature as given in the
+         * world builder file.
+         */
+        std::vector<Point<2> > original_coordinates;
+
+        /**
+         * The coordinates at the surface of the feature, including the
+         * coordinates which are added by prepare() to enforce the maximum
+         * distance between coordinates. Since this list can become very long,
+         * it is only stored once per compute node when running with more than
+         * one MPI process.
          */
-        std::vector<Point<2> > coordinates;
+        WorldBuilder::Utilities::NodeSharedArray<Point<2> > coordinates;
 
         /**
          * A vector of one dimensional coordinates for this feature.
@@ -170,7 +192,7 @@ namespace WorldBuilder
          * whole numbers may be skiped. So for a list of 4 points, {0,0.5,1,2}
          * is allowed, but {0,2,3,4} is not.
          */
-        std::vector<double> one_dimensional_coordinates;
+        WorldBuilder::Utilities::NodeSharedArray<double> one_dimensional_coordinates;
 
         /**
          * The x and y spline
@@ -112,12 +112,12 @@ namespace WorldBuilder
          * of that composition at this location and depth.
          */
 
-        WorldBuilder::grains
+        void
         grains(const Point<3> &position_in_cartesian_coordinates,
                const WorldBuilder::Utilities::NaturalCoordinate &position_in_natural_coordinates,
                const double depth,
                const unsigned int composition_number,
-               WorldBuilder::grains grains) const override final;
+               WorldBuilder::grains_view grains) const override final;
 
 
 
@@ -83,6 +83,12 @@ namespace WorldBuilder
          */
         void parse_entries(Parameters &prm) override final;
 
+        /**
+         * Compute the interpolated coordinates, the segment tables and the
+         * bounding box of the subducting plate.
+         */
+        void prepare() override final;
+
 
         /**
          * Computes the bounding points for a BoundingBox object using two extreme points in all the surface
@@ -126,12 +132,12 @@ namespace WorldBuilder
          * of that composition at this location and depth.
          */
 
-        WorldBuilder::grains
+        void
         grains(const Point<3> &position_in_cartesian_coordinates,
                const WorldBuilder::Utilities::NaturalCoordinate &position_in_natural_coordinates,
                const double depth,
                const unsigned int composition_number,
-               WorldBuilder::grains grains) const override final;
+               WorldBuilder::grains_view grains) const override final;
 
 
 
@@ -77,14 +77,14 @@ namespace WorldBuilder
 
 
             /**
-             * takes composition and position and returns a composition.
+             * takes composition and position and fills in the grains.
              */
             virtual
-            WorldBuilder::grains
+            void
             get_grains(const Point<3> &position,
                        const double depth,
                        const unsigned int composition_number,
-                       WorldBuilder::grains grains,
+                       WorldBuilder::grains_view grains,
                        const double feature_min_depth,
                        const double feature_max_depth,
                        const WorldBuilder::Utilities::PointDistanceFromCurvedPlanes &distance_from_planes,
@@ -21,6 +21,7 @@
 #define WORLD_BUILDER_GRAINS_H
 
 #include <array>
+#include <cstddef>
 #include <vector>
 
 namespace WorldBuilder
@@ -40,6 +41,75 @@ namespace WorldBuilder
     // todo: convention.
     std::vector<std::array<std::array<double,3>,3> > rotation_matrices;
   };
+
+  /**
+   * The sizes and rotation matrices of a number of grains which are stored
+   * in memory owned by someone else, like buffers provided by the user of
+   * the world builder or a grains structure. The features and the grains
+   * models fill in the grains through this view, so that no memory has to
+   * be allocated or copied for every point. The members can be used in the
+   * same way as the vectors of the grains structure.
+   */
+  struct grains_view
+  {
+    /**
+     * A range of values which are stored contiguously in memory.
+     */
+    template <class T>
+    struct range
+    {
+      T *begin() const
+      {
+        return first;
+      }
+
+      T *end() const
+      {
+        return first + n_values;
+      }
+
+      size_t size() const
+      {
+        return n_values;
+      }
+
+      T &operator[](const size_t i) const
+      {
+        return first[i];
+      }
+
+      T *first;
+      size_t n_values;
+    };
+
+    /**
+     * Constructor for a view of number_of_grains sizes and rotation matrices
+     * which are stored in the given arrays.
+     */
+    grains_view(double *sizes_,
+                std::array<std::array<double,3>,3> *rotation_matrices_,
+                const size_t number_of_grains)
+      :
+      sizes({sizes_, number_of_grains}),
+      rotation_matrices({rotation_matrices_, number_of_grains})
+    {}
+
+    /**
+     * Constructor for a view of the grains stored in a grains structure.
+     * The sizes and rotation matrices of the structure need to have the
+     * same number of grains.
+     */
+    explicit grains_view(grains &grains_)
+      :
+      grains_view(grains_.sizes.data(), grains_.rotation_matrices.data(), grains_.sizes.size())
+    {}
+
+    // The sizes of the grains
+    range<double> sizes;
+
+    // the rotation matrices of the latices of the grains.
+    range<std::array<std::array<double,3>,3> > rotation_matrices;
+  };
 } // namespace WorldBuilder
 
 #endif
@@ -0,0 +1,185 @@
+/*
+  Copyright (C) 2018 - 2021 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef WORLD_BUILDER_NODE_SHARED_ARRAY_H
+#define WORLD_BUILDER_NODE_SHARED_ARRAY_H
+
+#include "world_builder/array_view.h"
+#include "world_builder/utilities.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace WorldBuilder
+{
+  namespace Utilities
+  {
+    namespace Internal
+    {
+      /**
+       * Returns whether memory can be shared between the MPI processes of
+       * the given communicator on a compute node, which requires a
+       * communicator, that the World Builder is compiled with MPI 3 or newer
+       * and that MPI is initialized and not yet finalized.
+       */
+      bool
+      node_shared_memory_is_available(const int mpi_communicator);
+
+      /**
+       * Allocates memory in an MPI shared memory window, which is shared by
+       * the processes of the communicator (given by its Fortran handle) on
+       * the same compute node. Only the first process of every node calls
+       * compute_n_bytes, which returns the number of bytes to allocate, and
+       * fill, which writes the values into the memory. Afterwards, every
+       * process on the node can read the values at the address stored in
+       * memory. The returned pointer owns the window. This function has to
+       * be called by all processes in the communicator, and the windows have
+       * to be released by all processes in the same order.
+       */
+      std::shared_ptr<const void>
+      create_node_shared_memory(const int mpi_communicator,
+                                const std::function<size_t()> &compute_n_bytes,
+                                const std::function<void(void *)> &fill,
+                                const void *&memory,
+                                size_t &n_bytes);
+    } // namespace Internal
+
+    /**
+     * A read-only array of values, like the densified coordinates of a
+     * feature, which is stored only once per compute node when it is created
+     * by the processes of an MPI communicator. The first process of the
+     * communicator on every node computes the values and stores them in an
+     * MPI shared memory window, and all other processes on the node read
+     * them in place, instead of every process computing and storing its own
+     * copy. Without a communicator, without MPI, or when MPI does not
+     * support shared memory, every process computes and stores the values
+     * itself.
+     */
+    template <class T>
+    class NodeSharedArray
+    {
+      public:
+        // The processes which read the values do not construct them, so they
+        // have to be plain values without pointers into the memory of the
+        // process which computed them.
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "The values of a NodeSharedArray need to be trivially destructible.");
+
+        /**
+         * Constructor for an empty array.
+         */
+        NodeSharedArray()
+          :
+          first(nullptr),
+          n_values(0)
+        {}
+
+        /**
+         * Store the values returned by compute_values, which returns a
+         * std::vector<T>. If mpi_communicator is the Fortran handle of an MPI
+         * communicator (see MPI_Comm_c2f) and shared memory is available,
+         * compute_values is only called on the first process of the
+         * communicator on every compute node. This function and the
+         * destruction of the array then have to be done by all processes in
+         * that communicator in the same order, which also means that they
+         * may not be done from more than one thread at the same time. With
+         * no_mpi_communicator, no communication takes place.
+         */
+        template <class ComputeValues>
+        void
+        create(const int mpi_communicator, const ComputeValues &compute_values)
+        {
+          if (!Internal::node_shared_memory_is_available(mpi_communicator))
+            {
+              auto values = std::make_shared<const std::vector<T> >(compute_values());
+              first = values->data();
+              n_values = values->size();
+              storage = values;
+              return;
+            }
+
+          std::vector<T> values;
+          const void *memory = nullptr;
+          size_t n_bytes = 0;
+          storage = Internal::create_node_shared_memory(mpi_communicator, [&]()
+          {
+            values = compute_values();
+            return values.size() * sizeof(T);
+          },
+          [&](void *memory_)
+          {
+            std::uninitialized_copy(values.begin(), values.end(), static_cast<T *>(memory_));
+            std::vector<T>().swap(values);
+          },
+          memory, n_bytes);
+          first = static_cast<const T *>(memory);
+          n_values = n_bytes / sizeof(T);
+        }
+
+        const T *begin() const
+        {
+          return first;
+        }
+
+        const T *end() const
+        {
+          return first + n_values;
+        }
+
+        size_t size() const
+        {
+          return n_values;
+        }
+
+        bool empty() const
+        {
+          return n_values == 0;
+        }
+
+        const T &operator[](const size_t i) const
+        {
+          return first[i];
+        }
+
+        /**
+         * Returns a view of the values, to pass them to functions which
+         * read them in place.
+         */
+        operator ArrayView<T>() const
+        {
+          return ArrayView<T>(first, n_values);
+        }
+
+      private:
+        /**
+         * Owns the memory of the values, which is either a std::vector or an
+         * MPI shared memory window.
+         */
+        std::shared_ptr<const void> storage;
+
+        const T *first;
+        size_t n_values;
+    };
+  } // namespace Utilities
+} // namespace WorldBuilder
+
+#endif
@@ -87,8 +87,11 @@ namespace WorldBuilder
        * \param filename A string with the path to the world builder file
        * \param has_output_dir A bool indicating whether the world builder may write out information.
        * \param output_dir A string with the path to the directory where it can output information if allowed by has_output_dir
+       * \param schema A pointer to a json schema which has already been compiled from the declarations. If it is
+       * a nullptr, the schema is compiled from the declarations stored in this class.
        */
-      void initialize(std::string &filename, bool has_output_dir = false, const std::string &output_dir = "");
+      void initialize(std::string &filename, bool has_output_dir = false, const std::string &output_dir = "",
+                      const rapidjson::SchemaDocument *schema = nullptr);
 
       /**
        * A generic get function to retrieve setting from the parameter file.
@@ -0,0 +1,138 @@
+/*
+  Copyright (C) 2020 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef WORLD_BUILDER_RANDOM_NUMBER_GENERATOR_H
+#define WORLD_BUILDER_RANDOM_NUMBER_GENERATOR_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace WorldBuilder
+{
+  /**
+   * A counter-based random number generator, which implements the
+   * Philox4x32-10 algorithm of Salmon et al. (2011), "Parallel random
+   * numbers: as easy as 1, 2, 3". Every block of four random numbers is
+   * computed directly from a key and a counter, without any state which
+   * depends on numbers drawn before. Two generators with the same key and
+   * stream therefore always produce the same numbers, independent of which
+   * thread or MPI process uses them and of the order in which they are used.
+   * This allows the plugins to create a generator for every point from the
+   * seed of the world, the plugin and the point, instead of sharing a single
+   * generator, which would neither be thread-safe nor reproducible when the
+   * points are evaluated in parallel.
+   *
+   * The generator fulfills the requirements of a uniform random bit
+   * generator of the C++ standard library, but note that the distributions
+   * of the standard library are not guaranteed to produce the same numbers
+   * on different platforms. Use uniform_real() for that.
+   */
+  class CounterBasedRandomNumberGenerator
+  {
+    public:
+      using result_type = std::uint32_t;
+
+      /**
+       * Constructor. The key selects an independent sequence of random
+       * numbers, for example derived from the seed and the plugin, and the
+       * stream selects an independent sequence within it, for example derived
+       * from the position of a point.
+       */
+      CounterBasedRandomNumberGenerator(const std::uint64_t key,
+                                        const std::uint64_t stream);
+
+      /**
+       * Returns the next random number of 32 bits.
+       */
+      result_type operator()();
+
+      /**
+       * Returns the next random number uniformly distributed in [0,1),
+       * which is computed from two random numbers of 32 bits with a
+       * resolution of 53 bits.
+       */
+      double uniform_real();
+
+      /**
+       * The smallest number that can be returned by operator().
+       */
+      static constexpr result_type min()
+      {
+        return 0;
+      }
+
+      /**
+       * The largest number that can be returned by operator().
+       */
+      static constexpr result_type max()
+      {
+        return 0xFFFFFFFF;
+      }
+
+      /**
+       * Computes the ten rounds of Philox4x32 for the given counter and key.
+       */
+      static std::array<std::uint32_t,4> philox(std::array<std::uint32_t,4> counter,
+                                                std::array<std::uint32_t,2> key);
+
+      /**
+       * Combines a hash with a value into a new hash, which can be used to
+       * build keys and streams from several values.
+       */
+      static std::uint64_t hash_combine(const std::uint64_t hash, const std::uint64_t value);
+
+      /**
+       * Combines a hash with a double into a new hash. Values which compare
+       * equal, like 0 and -0, give the same hash.
+       */
+      static std::uint64_t hash_combine(const std::uint64_t hash, const double value);
+
+      /**
+       * Returns a hash of a string which is the same on all platforms,
+       * unlike std::hash.
+       */
+      static std::uint64_t hash(const std::string &string);
+
+    private:
+      /**
+       * The key of the generator.
+       */
+      std::array<std::uint32_t,2> key;
+
+      /**
+       * The counter of the current block. The first two entries contain the
+       * stream and the last two the number of the block within the stream.
+       */
+      std::array<std::uint32_t,4> counter;
+
+      /**
+       * The random numbers of the current block.
+       */
+      std::array<std::uint32_t,4> block;
+
+      /**
+       * The index of the next number of the current block which is returned.
+       */
+      unsigned int index;
+  };
+} // namespace WorldBuilder
+
+#endif
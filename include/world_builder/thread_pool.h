@@ -0,0 +1,174 @@
+/*
+  Copyright (C) 2018 - 2021 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef WORLD_BUILDER_THREAD_POOL_H
+#define WORLD_BUILDER_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace WorldBuilder
+{
+  /**
+   * A pool of persistent worker threads which can execute parallel for
+   * loops. The threads are created once in the constructor and are reused
+   * for every call to parallel_for, so the pool can be used for many
+   * consecutive loops, like the temperature and all the compositions of a
+   * grid.
+   *
+   * The index range of a loop is split into one contiguous range per
+   * thread. Each thread takes small chunks from its own range through an
+   * atomic counter. When its own range is finished, it steals chunks from
+   * the ranges of the other threads in the same way. This keeps all threads
+   * busy when the cost per index is very non-uniform, for example when some
+   * points are inside a slab and others are in the ambient mantle.
+   *
+   * The thread calling parallel_for also works on the loop, so a pool with
+   * one thread does not create any additional threads. Calls to
+   * parallel_for from different threads are executed one after another.
+   * The function passed to parallel_for may not call parallel_for of the
+   * same pool.
+   */
+  class ThreadPool
+  {
+    public:
+      /**
+       * Constructor. Creates a pool which executes loops with the given
+       * number of threads, including the calling thread. If the number
+       * of threads is zero, the number of hardware threads is used.
+       */
+      explicit ThreadPool(size_t number_of_threads);
+
+      /**
+       * Destructor. Stops and joins all worker threads.
+       */
+      ~ThreadPool();
+
+      ThreadPool(const ThreadPool &) = delete;
+      ThreadPool &operator=(const ThreadPool &) = delete;
+
+      /**
+       * Returns a pool with the given number of threads which is shared by
+       * the whole process. It is created by the first call which asks for
+       * this number of threads and kept until the end of the program, so
+       * the threads are not started again for every loop. Loops which are
+       * started from different threads on the same shared pool are executed
+       * one after another. If the number of threads is zero, the number of
+       * hardware threads is used.
+       */
+      static ThreadPool &get_shared_pool(size_t number_of_threads);
+
+      /**
+       * Returns the number of threads which work on a loop, including the
+       * calling thread.
+       */
+      size_t n_threads() const;
+
+      /**
+       * Calls func(i) for all i in [start, end) in parallel. The chunk size
+       * is the number of indices a thread takes at a time. If it is zero, a
+       * chunk size is chosen which gives every thread many chunks. If func
+       * throws an exception, the remaining chunks are skipped and the
+       * exception is rethrown in the calling thread.
+       */
+      template<typename Callable>
+      void parallel_for(size_t start, size_t end, Callable func, size_t chunk_size = 0)
+      {
+        const std::function<void(size_t, size_t)> range_function = [&func](size_t k1, size_t k2)
+        {
+          for (size_t k = k1; k < k2; ++k)
+            {
+              func(k);
+            }
+        };
+        run(range_function, start, end, chunk_size);
+      }
+
+    private:
+      /**
+       * The range of indices of one thread. The next index to be taken from
+       * this range is stored in an atomic counter, so other threads can
+       * steal chunks from it. The padding keeps the counters of different
+       * threads in different cache lines.
+       */
+      struct WorkRange
+      {
+        std::atomic<size_t> next;
+        size_t end;
+        char padding[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+      };
+
+      /**
+       * Executes range_function on chunks of [start, end) with all threads.
+       */
+      void run(const std::function<void(size_t, size_t)> &range_function,
+               size_t start,
+               size_t end,
+               size_t chunk_size);
+
+      /**
+       * Takes chunks from the own range of the thread, and then from the
+       * ranges of the other threads, until all ranges are done.
+       */
+      void work(size_t thread_index);
+
+      /**
+       * The function which is executed by the worker threads. It waits
+       * until there is a new loop and then calls work().
+       */
+      void worker_loop(size_t thread_index);
+
+      std::vector<std::thread> workers;
+      std::unique_ptr<WorkRange[]> ranges;
+      size_t number_of_threads;
+
+      /**
+       * The loop which is currently executed.
+       */
+      const std::function<void(size_t, size_t)> *current_function;
+      size_t current_chunk_size;
+
+      /**
+       * Protects the variables below and is used together with the
+       * condition variables to start the workers and to wait for them.
+       */
+      std::mutex mutex;
+      std::condition_variable start_condition;
+      std::condition_variable done_condition;
+      size_t generation;
+      size_t n_workers_done;
+      bool stop;
+      std::exception_ptr exception;
+      std::atomic<bool> failed;
+
+      /**
+       * Makes sure that only one loop is executed at the same time.
+       */
+      std::mutex run_mutex;
+  };
+} // namespace WorldBuilder
+
+#endif
@@ -21,6 +21,7 @@
 #define WORLD_BUILDER_UTILITIES_H
 
 
+#include "world_builder/array_view.h"
 #include "world_builder/nan.h"
 #include "world_builder/coordinate_systems/interface.h"
 
@@ -47,6 +48,14 @@ namespace WorldBuilder
      * polygon_contains_point_implementation to do the real work.
      */
     bool
+    polygon_contains_point(const ArrayView<Point<2> > point_list,
+                           const Point<2> &point);
+
+    /**
+     * Same as above, for a polygon stored in a std::vector, which also
+     * allows to pass the points as an initializer list.
+     */
+    bool
     polygon_contains_point(const std::vector<Point<2> > &point_list,
                            const Point<2> &point);
 
@@ -55,7 +64,7 @@ namespace WorldBuilder
      * falls within the polygon.
      */
     bool
-    polygon_contains_point_implementation(const std::vector<Point<2> > &point_list,
+    polygon_contains_point_implementation(const ArrayView<Point<2> > point_list,
                                           const Point<2> &point);
 
     /**
@@ -64,7 +73,7 @@ namespace WorldBuilder
      * the polygon and positive for points inside the polygon.
      */
     double
-    signed_distance_to_polygon(const std::vector<Point<2> > &point_list_,
+    signed_distance_to_polygon(const ArrayView<Point<2> > point_list_,
                                const Point<2> &point_);
 
 
@@ -179,6 +188,38 @@ namespace WorldBuilder
     double
     string_to_double(const std::string &string);
 
+    /**
+     * Reads a double from the characters in the range [begin, end), in the
+     * notation of the C locale, independent of the locale of the program.
+     * Returns a pointer to the first character after the number, or begin
+     * if the characters do not start with a decimal number or the number
+     * is out of the range of a double. Uses std::from_chars when the
+     * standard library provides it, and otherwise strtod with the C locale.
+     */
+    const char *
+    parse_double(const char *begin, const char *end, double &value);
+
+    /**
+     * Writes a double to the buffer, independent of the locale of the
+     * program. With a precision larger than zero, the double is written
+     * with that number of significant digits in the same way as with the %g
+     * format of printf, which is also how streams write a double by default
+     * with a precision of 6. With a precision of zero, it is written with
+     * the fewest digits which are read back as exactly the same double. The
+     * precision can be at most 17 and the buffer needs room for 32
+     * characters. Returns a pointer to the character after the last written
+     * character. The result is not null terminated.
+     */
+    char *
+    format_double(const double value, const unsigned int precision, char *buffer);
+
+    /**
+     * Splits a line of a data file or a grid file into its words, which can
+     * be separated by whitespace, commas or both.
+     */
+    std::vector<std::string>
+    split_data_line(const std::string &line);
+
     /**
      * Converts a string to a int
      */
@@ -379,6 +420,24 @@ namespace WorldBuilder
      * of the point from the plane and the distance of the point along the plane,
      * and the average angle of the closest segment/section.
      */
+    PointDistanceFromCurvedPlanes distance_point_from_curved_planes(const Point<3> &check_point,
+                                                                    const NaturalCoordinate &check_point_natural,
+                                                                    const Point<2> &reference_point,
+                                                                    const ArrayView<Point<2> > point_list,
+                                                                    const std::vector<std::vector<double> > &plane_segment_lengths,
+                                                                    const std::vector<std::vector<Point<2> > > &plane_segment_angles,
+                                                                    const double start_radius,
+                                                                    const std::unique_ptr<CoordinateSystems::Interface> &coordinate_system,
+                                                                    const bool only_positive,
+                                                                    const InterpolationType interpolation_type,
+                                                                    const interpolation &x_spline,
+                                                                    const interpolation &y_spline,
+                                                                    ArrayView<double> global_x_list = {});
+
+    /**
+     * Same as above, for coordinates stored in std::vectors, which also
+     * allows to pass them as initializer lists.
+     */
     PointDistanceFromCurvedPlanes distance_point_from_curved_planes(const Point<3> &check_point,
                                                                     const NaturalCoordinate &check_point_natural,
                                                                     const Point<2> &reference_point,
@@ -391,7 +450,7 @@ namespace WorldBuilder
                                                                     const InterpolationType interpolation_type,
                                                                     const interpolation &x_spline,
                                                                     const interpolation &y_spline,
-                                                                    std::vector<double> global_x_list = {});
+                                                                    const std::vector<double> &global_x_list = {});
 
 
 
@@ -412,6 +471,31 @@ namespace WorldBuilder
      */
     std::array<std::array<double,3>,3>
     euler_angles_to_rotation_matrix(double phi1, double theta, double phi2);
+
+    /**
+     * The value of an MPI communicator handle which stands for no
+     * communicator. Functions which get it work on the calling process only
+     * and do not communicate with any other process.
+     */
+    constexpr int no_mpi_communicator = -1;
+
+    /**
+     * Read the content of a file into a string. By default every process
+     * reads the file itself, and no MPI communication takes place. When the
+     * World Builder is compiled with MPI, MPI is initialized and an MPI
+     * communicator is provided, only the process with rank 0 in that
+     * communicator reads the file and broadcasts the content to all other
+     * processes of the communicator. This prevents all processes from
+     * accessing the same file at the same time, but the function then has to
+     * be called by all processes in the communicator.
+     * \param filename The path to the file.
+     * \param mpi_communicator The Fortran handle of the MPI communicator, as
+     * returned by MPI_Comm_c2f, or no_mpi_communicator. A handle is used so
+     * that this header does not depend on MPI.
+     */
+    std::string
+    read_and_distribute_file(const std::string &filename,
+                             const int mpi_communicator = no_mpi_communicator);
   } // namespace Utilities
 } // namespace WorldBuilder
 
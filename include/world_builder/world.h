@@ -22,6 +22,7 @@
 
 #include "world_builder/grains.h"
 #include "world_builder/parameters.h"
+#include "world_builder/utilities.h"
 
 #include <random>
 
@@ -34,6 +35,38 @@ namespace WorldBuilder
     class Interface;
   } // namespace Features
 
+  /**
+   * The world, which is created from a world builder file and which can be
+   * queried for the temperature, the compositions and the grains at any point.
+   *
+   * Thread safety: once the constructor has returned, the const functions
+   * temperature(), composition(), grains(), properties() and
+   * get_random_number_seed() may be called concurrently by any number of
+   * threads on the same world, for example by all the OpenMP threads of a
+   * process. They only read the world, and the random grains are computed
+   * from the seed and the point (see CounterBasedRandomNumberGenerator), so
+   * the results do not depend on the number of threads or on the order of the
+   * calls. properties() only uses the threads of a shared pool when it is
+   * asked for more than one thread, so it can be called from many threads at
+   * once with the default of one thread per call. Calls which ask for the same
+   * number of threads at the same time share the pool one after another. The
+   * functions which change the world, which are the constructor,
+   * parse_entries(), reload() and get_random_number_engine(), may not be
+   * called while any other function of the same world is running. Different worlds can be used by different
+   * threads independently. The test concurrent_queries checks this for all
+   * the cookbooks.
+   *
+   * MPI: by default a world does not communicate with other processes, so
+   * it can be created, reloaded and destroyed on any subset of the
+   * processes, and every process reads the world builder file itself. When
+   * an MPI communicator is given to the constructor, the world builder file
+   * is only read by the first process of that communicator and broadcast to
+   * the others, and the densified coordinates of the features are stored
+   * once per compute node in MPI shared memory (see
+   * Utilities::NodeSharedArray). The constructor, reload() and the destructor
+   * then have to be called by all processes in that communicator in the same
+   * order.
+   */
   class World
   {
     public:
@@ -50,13 +83,22 @@ namespace WorldBuilder
        * The world builder uses a deterministic random number generator for some plugins. This
        * is a deterministic random number generator on prorpose because even though you might
        * want to use random numbers to initialize some fields, the result should be reproducable.
-       * Note that when the world builder is used in for example MPI programs you should supply
-       * the world builder created each MPI process a different seed. You can use the MPI RANK
-       * for this (seed is seed + MPI_RANK). Because the generator is deterministic (known and
-       * documented algorithm), we can test the results and they should be the same even for different
-       * compilers and machines.
+       * The grains models compute their random numbers from this seed, the plugin and the
+       * point with a counter-based generator, so the grains are the same independent of the
+       * number of threads and of the order in which the points are evaluated. To get the same
+       * grains on all MPI processes, supply every process the same seed. Because the generators
+       * are deterministic (known and documented algorithms), we can test the results and they
+       * should be the same even for different compilers and machines.
+       * \param mpi_communicator The Fortran handle (see MPI_Comm_c2f) of an MPI
+       * communicator whose processes create this world together, or
+       * Utilities::no_mpi_communicator to create the world on this process only.
+       * \param n_threads The number of threads, including the calling thread,
+       * which compute the derived data of the features when the world is
+       * created or reloaded. When an MPI communicator is given, the features
+       * are always prepared on the calling thread only.
        */
-      World(std::string filename, bool has_output_dir = false, const std::string &output_dir = "", unsigned long random_number_seed = 1);
+      World(std::string filename, bool has_output_dir = false, const std::string &output_dir = "", unsigned long random_number_seed = 1,
+            int mpi_communicator = Utilities::no_mpi_communicator, size_t n_threads = 1);
 
       /**
        * Destructor
@@ -74,6 +116,21 @@ namespace WorldBuilder
        */
       void parse_entries(Parameters &prm);
 
+      /**
+       * Read in a new version of the world builder file. The new file is
+       * compared feature by feature with the previously read file, and only
+       * the features which have changed are parsed and prepared again. All
+       * other features keep their data. If anything besides the features
+       * has changed, the whole world is parsed again. If the new file can not
+       * be read or is invalid, or if one of its features can not be parsed or
+       * prepared, an exception is thrown and the world is left unchanged, so
+       * it can still be queried and the next reload is compared against the
+       * previously read file.
+       * \param filename A string with the path to the world builder file
+       * \return The number of features which have been parsed again.
+       */
+      unsigned int reload(std::string filename);
+
       /**
        * Returns the temperature based on a 2d Cartesian point, the depth in the
        * model at that point and the gravity norm at that point.
@@ -117,21 +174,109 @@ namespace WorldBuilder
                                   size_t number_of_grains) const;
 
       /**
-       * The MPI rank. Set to zero if MPI is not available.
+       * Computes the grain orientations and sizes based on a 2d Cartesian point
+       * and the depth in the model at that point, like the function above, but
+       * stores them in the arrays sizes and rotation_matrices of length
+       * number_of_grains which are provided by the caller. This allows the
+       * caller to reuse the same memory for many points.
+       */
+      void grains(const std::array<double, 2> &point,
+                  const double depth,
+                  const unsigned int composition_number,
+                  const size_t number_of_grains,
+                  double *sizes,
+                  std::array<std::array<double,3>,3> *rotation_matrices) const;
+
+      /**
+       * Computes the grain orientations and sizes based on a 3d Cartesian point
+       * and the depth in the model at that point, like the function above, but
+       * stores them in the arrays sizes and rotation_matrices of length
+       * number_of_grains which are provided by the caller. This allows the
+       * caller to reuse the same memory for many points.
+       */
+      void grains(const std::array<double, 3> &point,
+                  const double depth,
+                  const unsigned int composition_number,
+                  const size_t number_of_grains,
+                  double *sizes,
+                  std::array<std::array<double,3>,3> *rotation_matrices) const;
+
+      /**
+       * Computes the temperature and the compositions at many 2d Cartesian
+       * points at once, which are given by the arrays x and z of length
+       * n_points together with the depth and the gravity norm at every
+       * point. The temperatures are written to an array of n_points values,
+       * and the compositions with the n_compositions numbers in
+       * composition_numbers are written to an array of n_points times
+       * n_compositions values, with the compositions of a point next to
+       * each other. If temperatures or compositions is a nullptr, it is not
+       * computed, and the gravity norm may be a nullptr when the
+       * temperatures are not computed. The points are evaluated with
+       * n_threads threads, including the calling thread, from a pool which
+       * is shared by the process (see ThreadPool::get_shared_pool), so the
+       * threads are only started by the first call. By default, all points
+       * are evaluated on the calling thread.
+       */
+      void properties(const size_t n_points,
+                      const double *x,
+                      const double *z,
+                      const double *depth,
+                      const double *gravity_norm,
+                      const size_t n_compositions,
+                      const unsigned int *composition_numbers,
+                      double *temperatures,
+                      double *compositions,
+                      size_t n_threads = 1) const;
+
+      /**
+       * Computes the temperature and the compositions at many 3d Cartesian
+       * points at once, which are given by the arrays x, y and z. See the 2d
+       * version of this function for a description of the other arguments.
+       */
+      void properties(const size_t n_points,
+                      const double *x,
+                      const double *y,
+                      const double *z,
+                      const double *depth,
+                      const double *gravity_norm,
+                      const size_t n_compositions,
+                      const unsigned int *composition_numbers,
+                      double *temperatures,
+                      double *compositions,
+                      size_t n_threads = 1) const;
+
+      /**
+       * The MPI rank in the communicator given to the constructor, or in
+       * MPI_COMM_WORLD if no communicator was given. Set to zero if MPI is
+       * not available.
        */
       int MPI_RANK;
 
       /**
-       * The MPI size. Set to one if MPI is not available.
+       * The MPI size of the communicator given to the constructor, or of
+       * MPI_COMM_WORLD if no communicator was given. Set to one if MPI is not
+       * available.
        */
       int MPI_SIZE;
 
+      /**
+       * The Fortran handle of the MPI communicator given to the constructor,
+       * or Utilities::no_mpi_communicator.
+       */
+      int mpi_communicator;
+
       /**
        * Return a reference to the mt19937 random number.
        * The seed is provided to the world builder at construction.
        */
       std::mt19937 &get_random_number_engine();
 
+      /**
+       * Return the seed of the random numbers, which is provided to the
+       * world builder at construction.
+       */
+      unsigned long get_random_number_seed() const;
+
       /**
        * This is the parameter class, which stores all the values loaded in
        * from the parameter file or which are set directly.
@@ -198,12 +343,48 @@ namespace WorldBuilder
        */
       unsigned int dim;
 
+      /**
+       * Computes the temperature, if temperature is not a nullptr, and the
+       * n_compositions compositions with the given numbers, if compositions
+       * is not a nullptr, at a 3d Cartesian point. The natural coordinate of
+       * the point is only computed once, and the temperature and the
+       * compositions are computed in a single loop over the features.
+       */
+      void properties_at_point(const std::array<double,3> &point,
+                               const double depth,
+                               const double gravity_norm,
+                               const size_t n_compositions,
+                               const unsigned int *composition_numbers,
+                               double *temperature,
+                               double *compositions) const;
+
+      /**
+       * Converts a 2d point in the cross section into a 3d Cartesian point.
+       */
+      std::array<double,3> cross_section_to_cartesian(const std::array<double,2> &point) const;
+
+      /**
+       * Compute the derived data of the features with the given indices
+       * in parallel.
+       */
+      void prepare_features(std::vector<std::unique_ptr<Features::Interface> > &features,
+                            const std::vector<size_t> &feature_indices);
+
+      /**
+       * The seed of the random numbers.
+       */
+      unsigned long random_number_seed;
 
       /**
        * random number generator engine
        */
       std::mt19937 random_number_engine;
 
+      /**
+       * The number of threads which prepare the features.
+       */
+      size_t number_of_threads;
+
 
 
   };
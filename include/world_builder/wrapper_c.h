@@ -21,6 +21,7 @@
 #define WORLD_BUILDER_WRAPPER_C_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,6 +31,8 @@ extern "C" {
  * This function creates an object of the world builder and returns a pointer
  * to it. This pointer can then be used to call the temperature and composition
  * functions. When done call the release world function to destroy the object.
+ * All the functions querying the world may be called concurrently by several
+ * threads with the same pointer, but not while the world is created or released.
  */
 void create_world(void **ptr_ptr_world, const char *world_builder_file, const bool *has_output_dir, const char *output_dir, const unsigned long random_number_seed);
 
@@ -57,6 +60,67 @@ void composition_2d(void *ptr_ptr_world, double x, double z, double depth, unsig
  */
 void composition_3d(void *ptr_ptr_world, double x, double y, double z, double depth, unsigned int composition_number, double *composition);
 
+/**
+ * This function computes the temperature at n_points 2d points at once, given
+ * arrays with the x, z, depth and gravity of every point. The temperatures are
+ * written to an array of n_points values, so that for example a whole mesh
+ * partition can be initialized with one call. The points are evaluated with
+ * n_threads threads, including the calling thread. Pass 1 to evaluate them on
+ * the calling thread only, for example when the function is called from
+ * several threads or MPI processes at once. The same holds for all the batch
+ * functions below.
+ */
+void temperature_2d_batch(void *ptr_ptr_world, size_t n_points, const double *x, const double *z, const double *depth, const double *gravity, double *temperatures, size_t n_threads);
+
+/**
+ * This function computes the temperature at n_points 3d points at once, given
+ * arrays with the x, y, z, depth and gravity of every point. The temperatures
+ * are written to an array of n_points values.
+ */
+void temperature_3d_batch(void *ptr_ptr_world, size_t n_points, const double *x, const double *y, const double *z, const double *depth, const double *gravity, double *temperatures, size_t n_threads);
+
+/**
+ * This function computes n_compositions compositions at n_points 2d points at
+ * once, given arrays with the x, z and depth of every point and an array with
+ * the composition numbers. The compositions are written to an array of n_points
+ * times n_compositions values, where the compositions of a point are next to
+ * each other.
+ */
+void composition_2d_batch(void *ptr_ptr_world, size_t n_points, const double *x, const double *z, const double *depth, size_t n_compositions, const unsigned int *composition_numbers, double *compositions, size_t n_threads);
+
+/**
+ * This function computes n_compositions compositions at n_points 3d points at
+ * once, given arrays with the x, y, z and depth of every point and an array
+ * with the composition numbers. The compositions are written in the same order
+ * as by composition_2d_batch.
+ */
+void composition_3d_batch(void *ptr_ptr_world, size_t n_points, const double *x, const double *y, const double *z, const double *depth, size_t n_compositions, const unsigned int *composition_numbers, double *compositions, size_t n_threads);
+
+/**
+ * This function computes the temperature and n_compositions compositions at
+ * n_points 2d points in one pass over the points. The outputs are written in the
+ * same way as by temperature_2d_batch and composition_2d_batch. Either output may
+ * be NULL, in which case it is not computed.
+ */
+void properties_2d_batch(void *ptr_ptr_world, size_t n_points, const double *x, const double *z, const double *depth, const double *gravity, size_t n_compositions, const unsigned int *composition_numbers, double *temperatures, double *compositions, size_t n_threads);
+
+/**
+ * This function computes the temperature and n_compositions compositions at
+ * n_points 3d points in one pass over the points. The outputs are written in the
+ * same way as by temperature_3d_batch and composition_3d_batch. Either output may
+ * be NULL, in which case it is not computed.
+ */
+void properties_3d_batch(void *ptr_ptr_world, size_t n_points, const double *x, const double *y, const double *z, const double *depth, const double *gravity, size_t n_compositions, const unsigned int *composition_numbers, double *temperatures, double *compositions, size_t n_threads);
+
+/**
+ * This function checks that the array with the name array_name has expected_size
+ * values, which is the size of the array or value with the name expected_name,
+ * and throws an error with these names and the name of the calling routine
+ * otherwise. It is used by the array routines of the Fortran wrapper, so that
+ * they do not need the Fortran runtime library to report an error.
+ */
+void check_array_size(const char *routine_name, const char *array_name, size_t array_size, const char *expected_name, size_t expected_size);
+
 /**
  * The destructor for the world builder class. Call this function when done with the
  * world builder.
@@ -20,6 +20,7 @@
 #ifndef WORLD_BUILDER_WRAPPER_CPP_H
 #define WORLD_BUILDER_WRAPPER_CPP_H
 
+#include <cstddef>
 #include <string>
 
 namespace wrapper_cpp
@@ -67,6 +68,39 @@ namespace wrapper_cpp
        */
       double composition_3d(double x, double y, double z, double depth, unsigned int composition_number);
 
+      /**
+       * This function computes the temperature at n_points 2d points at once, given
+       * arrays with the x, z, depth and gravity of every point. The temperatures are
+       * written to an array of n_points values. The points are evaluated with
+       * n_threads threads, including the calling thread, which is also the
+       * case for the other batch functions.
+       */
+      void temperature_2d_batch(size_t n_points, const double *x, const double *z, const double *depth, const double *gravity, double *temperatures, size_t n_threads = 1) const;
+
+      /**
+       * This function computes the temperature at n_points 3d points at once, given
+       * arrays with the x, y, z, depth and gravity of every point. The temperatures
+       * are written to an array of n_points values.
+       */
+      void temperature_3d_batch(size_t n_points, const double *x, const double *y, const double *z, const double *depth, const double *gravity, double *temperatures, size_t n_threads = 1) const;
+
+      /**
+       * This function computes n_compositions compositions at n_points 2d points at
+       * once, given arrays with the x, z and depth of every point. The compositions
+       * are written to an array of n_points times n_compositions values, where the
+       * compositions of a point are next to each other.
+       */
+      void composition_2d_batch(size_t n_points, const double *x, const double *z, const double *depth,
+                                size_t n_compositions, const unsigned int *composition_numbers, double *compositions, size_t n_threads = 1) const;
+
+      /**
+       * This function computes n_compositions compositions at n_points 3d points at
+       * once, given arrays with the x, y, z and depth of every point. The compositions
+       * are written in the same order as by composition_2d_batch.
+       */
+      void composition_3d_batch(size_t n_points, const double *x, const double *y, const double *z, const double *depth,
+                                size_t n_compositions, const unsigned int *composition_numbers, double *compositions, size_t n_threads = 1) const;
+
 
     private:
       void *ptr_ptr_world;
@@ -22,6 +22,7 @@
 #include <algorithm>
 
 #include "world_builder/nan.h"
+#include "world_builder/random_number_generator.h"
 #include "world_builder/types/array.h"
 #include "world_builder/types/bool.h"
 #include "world_builder/types/double.h"
@@ -103,26 +104,38 @@ namespace WorldBuilder
           WBAssertThrow(compositions.size() == normalize_grain_sizes.size(),
                         "There are not the same amount of compositions (" << compositions.size()
                         << ") and normalize_grain_sizes (" << normalize_grain_sizes.size() << ").");
+
+          // The random numbers of this model depend on the seed and on the location of the
+          // model in the world builder file, so that every model draws different numbers.
+          random_number_key = CounterBasedRandomNumberGenerator::hash_combine(static_cast<std::uint64_t>(world->get_random_number_seed()),
+                                                                              CounterBasedRandomNumberGenerator::hash(prm.get_full_json_path()));
         }
 
 
-        WorldBuilder::grains
-        RandomUniformDistribution::get_grains(const Point<3> & /*position_in_cartesian_coordinates*/,
+        void
+        RandomUniformDistribution::get_grains(const Point<3> &position_in_cartesian_coordinates,
                                               const double depth,
                                               const unsigned int composition_number,
-                                              WorldBuilder::grains grains_,
+                                              WorldBuilder::grains_view grains_,
                                               const double  /*feature_min_depth*/,
                                               const double /*feature_max_depth*/) const
         {
-          WorldBuilder::grains  grains_local = grains_;
           if (depth <= max_depth && depth >= min_depth)
             {
               for (unsigned int i =0; i < compositions.size(); ++i)
                 {
                   if (compositions[i] == composition_number)
                     {
-                      std::uniform_real_distribution<> dist(0.0,1.0);
-                      for (auto &&it_rotation_matrices : grains_local.rotation_matrices)
+                      // The random numbers only depend on the seed, this model, the composition and
+                      // the point, so the grains do not depend on the order in which the points are
+                      // evaluated, or on which thread or MPI process evaluates them.
+                      std::uint64_t stream = composition_number;
+                      for (size_t j = 0; j < 3; ++j)
+                        stream = CounterBasedRandomNumberGenerator::hash_combine(stream, position_in_cartesian_coordinates[j]);
+                      stream = CounterBasedRandomNumberGenerator::hash_combine(stream, depth);
+                      CounterBasedRandomNumberGenerator random_number_generator(random_number_key, stream);
+
+                      for (auto &&it_rotation_matrices : grains_.rotation_matrices)
                         {
                           // set a uniform random a_cosine_matrix per grain
                           // This function is based on an article in Graphic Gems III, written by James Arvo, Cornell University (p 116-120).
@@ -139,9 +152,9 @@ namespace WorldBuilder
                           // the public domain, and is yours to study, modify, and use."
 
                           // first generate three random numbers between 0 and 1 and multiply them with 2 PI or 2 for z. Note that these are not the same as phi_1, theta and phi_2.
-                          double one = dist(world->get_random_number_engine());
-                          double two = dist(world->get_random_number_engine());
-                          double three = dist(world->get_random_number_engine());
+                          double one = random_number_generator.uniform_real();
+                          double two = random_number_generator.uniform_real();
+                          double three = random_number_generator.uniform_real();
 
                           double theta = 2.0 * const_pi * one; // Rotation about the pole (Z)
                           double phi = 2.0 * const_pi * two; // For direction of pole deflection.
@@ -184,25 +197,24 @@ namespace WorldBuilder
                         }
 
                       double total_size = 0;
-                      for (auto &&it_sizes : grains_local.sizes)
+                      for (auto &&it_sizes : grains_.sizes)
                         {
-                          it_sizes = grain_sizes[i] < 0 ? dist(world->get_random_number_engine()) : grain_sizes[i];
+                          it_sizes = grain_sizes[i] < 0 ? random_number_generator.uniform_real() : grain_sizes[i];
                           total_size += it_sizes;
                         }
 
                       if (normalize_grain_sizes[i])
                         {
                           const double one_over_total_size = 1/total_size;
-                          std::transform(grains_local.sizes.begin(), grains_local.sizes.end(), grains_local.sizes.begin(),
+                          std::transform(grains_.sizes.begin(), grains_.sizes.end(), grains_.sizes.begin(),
                                          [one_over_total_size](double sizes) -> double { return sizes *one_over_total_size; });
                         }
 
 
-                      return grains_local;
+                      return;
                     }
                 }
             }
-          return grains_local;
         }
         WB_REGISTER_FEATURE_CONTINENTAL_PLATE_GRAINS_MODEL(RandomUniformDistribution, random uniform distribution)
       } // namespace Grains
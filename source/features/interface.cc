@@ -117,7 +117,7 @@ namespace WorldBuilder
     Interface::declare_interface_entries(Parameters &prm,
                                          const CoordinateSystem  /*unused*/)
     {
-      this->coordinates = prm.get_vector<Point<2> >("coordinates");
+      this->original_coordinates = prm.get_vector<Point<2> >("coordinates");
     }
 
     void
@@ -125,9 +125,9 @@ namespace WorldBuilder
                                Parameters &prm,
                                const CoordinateSystem coordinate_system)
     {
-      coordinates = prm.get_vector<Point<2> >("coordinates");
+      original_coordinates = prm.get_vector<Point<2> >("coordinates");
       if (coordinate_system == CoordinateSystem::spherical)
-        std::transform(coordinates.begin(),coordinates.end(), coordinates.begin(),
+        std::transform(original_coordinates.begin(),original_coordinates.end(), original_coordinates.begin(),
                        [](const WorldBuilder::Point<2> &p) -> WorldBuilder::Point<2> { return p *const_pi / 180.0;});
 
 
@@ -135,36 +135,45 @@ namespace WorldBuilder
       const std::string interpolation_type_string = prm.get<std::string>("interpolation") == "global" ? this->world->interpolation : prm.get<std::string>("interpolation");
       interpolation_type = WorldBuilder::Features::Internal::string_to_interpolation_type(interpolation_type_string);
 
-      // the one_dimensional_coordinates is always needed, so fill it.
-      original_number_of_coordinates = coordinates.size();
+      WBAssert(interpolation_type == WorldBuilder::Utilities::InterpolationType::None ||
+               interpolation_type == WorldBuilder::Utilities::InterpolationType::Linear ||
+               interpolation_type == WorldBuilder::Utilities::InterpolationType::MonotoneSpline ||
+               interpolation_type == WorldBuilder::Utilities::InterpolationType::ContinuousMonotoneSpline,
+               "For interpolation, linear and monotone spline are the only allowed values. "
+               << "You provided " << interpolation_type_string << ".");
+
+      original_number_of_coordinates = original_coordinates.size();
+    }
 
+
+    void
+    Interface::prepare()
+    {
+      const CoordinateSystem coordinate_system = this->world->parameters.coordinate_system->natural_coordinate_system();
+
+      // the one_dimensional_coordinates is always needed, so fill it.
       std::vector<double> one_dimensional_coordinates_local(original_number_of_coordinates,0.0);
       for (size_t j=0; j<original_number_of_coordinates; ++j)
         {
           one_dimensional_coordinates_local[j] = static_cast<double>(j);
         }
+      std::vector<Point<2> > coordinates_local = original_coordinates;
 
+      double maximum_distance_between_coordinates = 0;
       if (interpolation_type != WorldBuilder::Utilities::InterpolationType::None)
         {
-          WBAssert(interpolation_type == WorldBuilder::Utilities::InterpolationType::Linear ||
-                   interpolation_type == WorldBuilder::Utilities::InterpolationType::MonotoneSpline ||
-                   interpolation_type == WorldBuilder::Utilities::InterpolationType::ContinuousMonotoneSpline,
-                   "For interpolation, linear and monotone spline are the only allowed values. "
-                   << "You provided " << interpolation_type_string << ".");
-
-          double maximum_distance_between_coordinates = this->world->maximum_distance_between_coordinates *
-                                                        (coordinate_system == CoordinateSystem::spherical ? const_pi / 180.0 : 1.0);
+          maximum_distance_between_coordinates = this->world->maximum_distance_between_coordinates *
+                                                 (coordinate_system == CoordinateSystem::spherical ? const_pi / 180.0 : 1.0);
 
 
           // I don't think this is usefull for continuous monotone spline, although it might
           // help in a spherical case like for the linear case.
           std::vector<double> x_list(original_number_of_coordinates,0.0);
           std::vector<double> y_list(original_number_of_coordinates,0.0);
-          std::vector<Point<2> > coordinate_list_local = coordinates;
           for (size_t j=0; j<original_number_of_coordinates; ++j)
             {
-              x_list[j] = coordinates[j][0];
-              y_list[j] = coordinates[j][1];
+              x_list[j] = original_coordinates[j][0];
+              y_list[j] = original_coordinates[j][1];
             }
 
           x_spline.set_points(one_dimensional_coordinates_local,
@@ -173,35 +182,70 @@ namespace WorldBuilder
           y_spline.set_points(one_dimensional_coordinates_local,
                               y_list,
                               interpolation_type != WorldBuilder::Utilities::InterpolationType::Linear);
-
-          if (maximum_distance_between_coordinates > 0 && interpolation_type != WorldBuilder::Utilities::InterpolationType::ContinuousMonotoneSpline)
-            {
-              size_t additional_parts = 0;
-              for (size_t i_plane=0; i_plane<original_number_of_coordinates-1; ++i_plane)
-                {
-                  const Point<2> P1 (x_spline(one_dimensional_coordinates_local[i_plane + additional_parts]),
-                                     y_spline(one_dimensional_coordinates_local[i_plane + additional_parts]),
-                                     coordinate_system);
-
-                  const Point<2> P2 (x_spline(one_dimensional_coordinates_local[i_plane + additional_parts + 1]),
-                                     y_spline(one_dimensional_coordinates_local[i_plane  + additional_parts+ 1]),
-                                     coordinate_system);
-
-                  const double length = (P1 - P2).norm();
-                  const size_t parts = static_cast<size_t>(std::ceil(length / maximum_distance_between_coordinates));
-                  for (size_t j = 1; j < parts; j++)
-                    {
-                      const double x_position3 = static_cast<double>(i_plane) + static_cast<double>(j)/static_cast<double>(parts);
-                      const Point<2> P3(x_spline(x_position3), y_spline(x_position3), coordinate_system);
-                      one_dimensional_coordinates_local.insert(one_dimensional_coordinates_local.begin() + static_cast<std::vector<double>::difference_type>(additional_parts + i_plane + 1), x_position3);
-                      coordinate_list_local.insert(coordinate_list_local.begin() + static_cast<std::vector<double>::difference_type>(additional_parts + i_plane + 1), P3);
-                      additional_parts++;
-                    }
-                }
-              coordinates = coordinate_list_local;
-            }
         }
-      one_dimensional_coordinates = one_dimensional_coordinates_local;
+
+      // The densified coordinates can be by far the largest data of a
+      // feature. With more than one MPI process, only the first process on
+      // every compute node computes them, and all processes on the node
+      // share them. The world prepares the features in the same order on
+      // all processes and only with one thread in that case.
+      bool densified = false;
+      auto densify = [&]()
+      {
+        if (densified)
+          return;
+        densified = true;
+
+        if (maximum_distance_between_coordinates > 0 && interpolation_type != WorldBuilder::Utilities::InterpolationType::ContinuousMonotoneSpline)
+          {
+            // Build the new lists by appending, inserting the extra points
+            // into the middle of the lists is quadratic in the number of points.
+            std::vector<double> densified_one_dimensional_coordinates;
+            std::vector<Point<2> > densified_coordinates;
+            densified_one_dimensional_coordinates.reserve(original_number_of_coordinates);
+            densified_coordinates.reserve(original_number_of_coordinates);
+            for (size_t i_plane=0; i_plane<original_number_of_coordinates; ++i_plane)
+              {
+                densified_one_dimensional_coordinates.push_back(one_dimensional_coordinates_local[i_plane]);
+                densified_coordinates.push_back(original_coordinates[i_plane]);
+
+                if (i_plane == original_number_of_coordinates-1)
+                  break;
+
+                const Point<2> P1 (x_spline(one_dimensional_coordinates_local[i_plane]),
+                                   y_spline(one_dimensional_coordinates_local[i_plane]),
+                                   coordinate_system);
+
+                const Point<2> P2 (x_spline(one_dimensional_coordinates_local[i_plane + 1]),
+                                   y_spline(one_dimensional_coordinates_local[i_plane + 1]),
+                                   coordinate_system);
+
+                const double length = (P1 - P2).norm();
+                const size_t parts = static_cast<size_t>(std::ceil(length / maximum_distance_between_coordinates));
+                for (size_t j = 1; j < parts; j++)
+                  {
+                    const double x_position3 = static_cast<double>(i_plane) + static_cast<double>(j)/static_cast<double>(parts);
+                    densified_one_dimensional_coordinates.push_back(x_position3);
+                    densified_coordinates.emplace_back(x_spline(x_position3), y_spline(x_position3), coordinate_system);
+                  }
+              }
+            one_dimensional_coordinates_local.swap(densified_one_dimensional_coordinates);
+            coordinates_local.swap(densified_coordinates);
+          }
+      };
+
+      // When the world has an MPI communicator, the coordinates are stored
+      // once per compute node for all its processes.
+      coordinates.create(this->world->mpi_communicator, [&]()
+      {
+        densify();
+        return std::move(coordinates_local);
+      });
+      one_dimensional_coordinates.create(this->world->mpi_communicator, [&]()
+      {
+        densify();
+        return std::move(one_dimensional_coordinates_local);
+      });
     }
 
 
@@ -190,12 +190,12 @@ namespace WorldBuilder
 
 
 
-    WorldBuilder::grains
+    void
     MantleLayer::grains(const Point<3> &position_in_cartesian_coordinates,
                         const NaturalCoordinate &position_in_natural_coordinates,
                         const double depth,
                         const unsigned int composition_number,
-                        WorldBuilder::grains grains) const
+                        WorldBuilder::grains_view grains) const
     {
       if (depth <= max_depth && depth >= min_depth &&
           WorldBuilder::Utilities::polygon_contains_point(coordinates, Point<2>(position_in_natural_coordinates.get_surface_coordinates(),
@@ -203,12 +203,12 @@ namespace WorldBuilder
         {
           for (const auto &grains_model: grains_models)
             {
-              grains = grains_model->get_grains(position_in_cartesian_coordinates,
-                                                depth,
-                                                composition_number,
-                                                grains,
-                                                min_depth,
-                                                max_depth);
+              grains_model->get_grains(position_in_cartesian_coordinates,
+                                       depth,
+                                       composition_number,
+                                       grains,
+                                       min_depth,
+                                       max_depth);
 
               /*WBAssert(!std::isnan(composition), "Composition is not a number: " << composition
                        << ", based on a temperature model with the name " << composition_model->get_name());
@@ -217,8 +217,6 @@ namespace WorldBuilder
 
             }
         }
-
-      return grains;
     }
 
     WB_REGISTER_FEATURE(MantleLayer, mantle layer)
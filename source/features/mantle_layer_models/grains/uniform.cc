@@ -128,31 +128,29 @@ namespace WorldBuilder
         }
 
 
-        WorldBuilder::grains
+        void
         Uniform::get_grains(const Point<3> & /*position_in_cartesian_coordinates*/,
                             const double depth,
                             const unsigned int composition_number,
-                            WorldBuilder::grains grains_,
+                            WorldBuilder::grains_view grains_,
                             const double  /*feature_min_depth*/,
                             const double /*feature_max_depth*/) const
         {
-          WorldBuilder::grains  grains_local = grains_;
           if (depth <= max_depth && depth >= min_depth)
             {
               for (unsigned int i =0; i < compositions.size(); ++i)
                 {
                   if (compositions[i] == composition_number)
                     {
-                      std::fill(grains_local.rotation_matrices.begin(),grains_local.rotation_matrices.end(),rotation_matrices[i]);
+                      std::fill(grains_.rotation_matrices.begin(),grains_.rotation_matrices.end(),rotation_matrices[i]);
 
-                      const double size = grain_sizes[i] < 0 ? 1.0/static_cast<double>(grains_local.sizes.size()) :  grain_sizes[i];
-                      std::fill(grains_local.sizes.begin(),grains_local.sizes.end(),size);
+                      const double size = grain_sizes[i] < 0 ? 1.0/static_cast<double>(grains_.sizes.size()) :  grain_sizes[i];
+                      std::fill(grains_.sizes.begin(),grains_.sizes.end(),size);
 
-                      return grains_local;
+                      return;
                     }
                 }
             }
-          return grains_local;
         }
         WB_REGISTER_FEATURE_MANTLE_LAYER_GRAINS_MODEL(Uniform, uniform)
       } // namespace Grains
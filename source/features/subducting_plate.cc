@@ -299,6 +299,13 @@ namespace WorldBuilder
           }
       }
       prm.leave_subsection();
+    }
+
+
+    void
+    SubductingPlate::prepare()
+    {
+      Interface::prepare();
 
       maximum_slab_thickness = 0;
       maximum_total_slab_length = 0;
@@ -682,12 +689,12 @@ namespace WorldBuilder
     }
 
 
-    WorldBuilder::grains
+    void
     SubductingPlate::grains(const Point<3> &position_in_cartesian_coordinates,
                             const NaturalCoordinate &position_in_natural_coordinates,
                             const double depth,
                             const unsigned int composition_number,
-                            WorldBuilder::grains grains) const
+                            WorldBuilder::grains_view grains) const
     {
       // todo: explain
       const double starting_radius = position_in_natural_coordinates.get_depth_coordinate() + depth - starting_depth;
@@ -749,11 +756,11 @@ namespace WorldBuilder
 
               // if the thickness is zero, we don't need to compute anything, so return.
               if (std::fabs(thickness_local) < 2.0 * std::numeric_limits<double>::epsilon())
-                return grains;
+                return;
 
               // if the thickness is smaller than what is truncated off at the top, we don't need to compute anything, so return.
               if (thickness_local < top_truncation_local)
-                return grains;
+                return;
 
               const double max_slab_length = total_slab_length[current_section] +
                                              section_fraction *
@@ -766,19 +773,26 @@ namespace WorldBuilder
                 {
                   // Inside the slab!
                   const Features::Utilities::AdditionalParameters additional_parameters = {max_slab_length,thickness_local};
-                  WorldBuilder::grains  grains_current_section = grains;
-                  WorldBuilder::grains  grains_next_section = grains;
+                  // The current section is computed directly in the grains. The
+                  // next section starts from the same grains, so they are copied
+                  // into a buffer which is kept between the calls, so that no
+                  // memory has to be allocated for every point.
+                  static thread_local WorldBuilder::grains grains_next_section_buffer;
+                  grains_next_section_buffer.sizes.assign(grains.sizes.begin(), grains.sizes.end());
+                  grains_next_section_buffer.rotation_matrices.assign(grains.rotation_matrices.begin(), grains.rotation_matrices.end());
+                  const WorldBuilder::grains_view grains_current_section = grains;
+                  const WorldBuilder::grains_view grains_next_section(grains_next_section_buffer);
 
                   for (const auto &grains_model: segment_vector[current_section][current_segment].grains_systems)
                     {
-                      grains_current_section = grains_model->get_grains(position_in_cartesian_coordinates,
-                                                                        depth,
-                                                                        composition_number,
-                                                                        grains_current_section,
-                                                                        starting_depth,
-                                                                        maximum_depth,
-                                                                        distance_from_planes,
-                                                                        additional_parameters);
+                      grains_model->get_grains(position_in_cartesian_coordinates,
+                                               depth,
+                                               composition_number,
+                                               grains_current_section,
+                                               starting_depth,
+                                               maximum_depth,
+                                               distance_from_planes,
+                                               additional_parameters);
 
                       /*WBAssert(!std::isnan(composition_current_section), "Composition_current_section is not a number: " << composition_current_section
                                << ", based on a temperature model with the name " << composition_model->get_name());
@@ -789,14 +803,14 @@ namespace WorldBuilder
 
                   for (const auto &grains_model: segment_vector[next_section][current_segment].grains_systems)
                     {
-                      grains_next_section = grains_model->get_grains(position_in_cartesian_coordinates,
-                                                                     depth,
-                                                                     composition_number,
-                                                                     grains_next_section,
-                                                                     starting_depth,
-                                                                     maximum_depth,
-                                                                     distance_from_planes,
-                                                                     additional_parameters);
+                      grains_model->get_grains(position_in_cartesian_coordinates,
+                                               depth,
+                                               composition_number,
+                                               grains_next_section,
+                                               starting_depth,
+                                               maximum_depth,
+                                               distance_from_planes,
+                                               additional_parameters);
 
                       /*WBAssert(!std::isnan(composition_next_section), "Composition_next_section is not a number: " << composition_next_section
                                << ", based on a temperature model with the name " << composition_model->get_name());
@@ -826,8 +840,6 @@ namespace WorldBuilder
                 }
             }
         }
-
-      return grains;
     }
 
     /**
@@ -0,0 +1,123 @@
+/*
+  Copyright (C) 2018 - 2021 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "world_builder/node_shared_array.h"
+
+#include "world_builder/assert.h"
+
+#ifdef WB_WITH_MPI
+#define OMPI_SKIP_MPICXX 1
+#include <mpi.h>
+#endif
+
+namespace WorldBuilder
+{
+  namespace Utilities
+  {
+    namespace Internal
+    {
+      bool
+      node_shared_memory_is_available(const int mpi_communicator)
+      {
+#if defined(WB_WITH_MPI) && MPI_VERSION >= 3
+        if (mpi_communicator == no_mpi_communicator)
+          return false;
+        int mpi_initialized = 0;
+        MPI_Initialized(&mpi_initialized);
+        int mpi_finalized = 0;
+        MPI_Finalized(&mpi_finalized);
+        return mpi_initialized != 0 && mpi_finalized == 0;
+#else
+        (void)mpi_communicator;
+        return false;
+#endif
+      }
+
+
+
+      std::shared_ptr<const void>
+      create_node_shared_memory(const int mpi_communicator,
+                                const std::function<size_t()> &compute_n_bytes,
+                                const std::function<void(void *)> &fill,
+                                const void *&memory,
+                                size_t &n_bytes)
+      {
+#if defined(WB_WITH_MPI) && MPI_VERSION >= 3
+        const MPI_Comm communicator = MPI_Comm_f2c(mpi_communicator);
+        int mpi_rank = 0;
+        MPI_Comm_rank(communicator, &mpi_rank);
+        MPI_Comm node_comm;
+        MPI_Comm_split_type(communicator, MPI_COMM_TYPE_SHARED, mpi_rank, MPI_INFO_NULL, &node_comm);
+        int node_rank = 0;
+        MPI_Comm_rank(node_comm, &node_rank);
+
+        unsigned long long n_bytes_node = node_rank == 0 ? compute_n_bytes() : 0;
+        MPI_Bcast(&n_bytes_node, 1, MPI_UNSIGNED_LONG_LONG, 0, node_comm);
+        n_bytes = static_cast<size_t>(n_bytes_node);
+
+        // Only the first process of the node allocates memory in the window,
+        // and all others get the address of that memory in their own
+        // address space.
+        void *window_memory = nullptr;
+        MPI_Win window;
+        MPI_Win_allocate_shared(node_rank == 0 ? static_cast<MPI_Aint>(n_bytes) : 0, 1,
+                                MPI_INFO_NULL, node_comm, &window_memory, &window);
+        if (node_rank != 0)
+          {
+            MPI_Aint window_size;
+            int displacement_unit;
+            MPI_Win_shared_query(window, 0, &window_size, &displacement_unit, &window_memory);
+            WBAssert(static_cast<size_t>(window_size) == n_bytes,
+                     "Internal error: The shared memory window has " << window_size
+                     << " bytes instead of " << n_bytes << " bytes.");
+          }
+
+        MPI_Win_fence(0, window);
+        if (node_rank == 0)
+          fill(window_memory);
+        MPI_Win_fence(0, window);
+
+        // The window keeps its own copy of the group of the communicator.
+        MPI_Comm_free(&node_comm);
+
+        memory = window_memory;
+
+        // Freeing the window is collective as well. When the window is
+        // released after MPI has been finalized, like for a World which is
+        // destroyed at the end of the main function, MPI has already freed it.
+        return std::shared_ptr<const void>(window_memory, [window](const void *) mutable
+        {
+          int mpi_finalized = 0;
+          MPI_Finalized(&mpi_finalized);
+          if (mpi_finalized == 0)
+            MPI_Win_free(&window);
+        });
+#else
+        (void)mpi_communicator;
+        (void)compute_n_bytes;
+        (void)fill;
+        (void)memory;
+        (void)n_bytes;
+        WBAssertThrow(false, "Internal error: Node shared memory is only available with MPI 3 or newer.");
+        return nullptr;
+#endif
+      }
+    } // namespace Internal
+  } // namespace Utilities
+} // namespace WorldBuilder
@@ -30,9 +30,10 @@
 #include "world_builder/features/oceanic_plate_models/temperature/interface.h"
 #include "world_builder/features/subducting_plate.h"
 #include "world_builder/types/object.h"
+#include "world_builder/utilities.h"
+#include "world_builder/world.h"
 
 #include "rapidjson/error/en.h"
-#include "rapidjson/istreamwrapper.h"
 #include "rapidjson/latexwriter.h"
 #include "rapidjson/prettywriter.h"
 
@@ -52,7 +53,8 @@ namespace WorldBuilder
   Parameters::~Parameters()
     = default;
 
-  void Parameters::initialize(std::string &filename, bool has_output_dir, const std::string &output_dir)
+  void Parameters::initialize(std::string &filename, bool has_output_dir, const std::string &output_dir,
+                              const SchemaDocument *schema)
   {
 
     if (has_output_dir)
@@ -80,51 +82,43 @@ namespace WorldBuilder
       }
 
     path_level =0;
-    // Now read in the world builder file into a file stream and
-    // put it into a the rapidjason document
-    std::ifstream json_input_stream(filename.c_str());
-
-    // Get world builder file and check whether it exists
-    WBAssertThrow(json_input_stream.good(),
-                  "Could not find the world builder file at the specified location: " + filename);
-
-    WBAssert(json_input_stream, "Could not read the world builder file.");
-
-    rapidjson::IStreamWrapper isw(json_input_stream);
+    // Now read in the world builder file into a string and put it into a
+    // the rapidjason document. When the world has an MPI communicator, only
+    // its root process reads the file and broadcasts it to the other processes.
+    const std::string file_content = Utilities::read_and_distribute_file(filename, world.mpi_communicator);
 
     // relaxing sytax by allowing comments () for now, maybe also allow trailing commas and (kParseTrailingCommasFlag) and nan's, inf etc (kParseNanAndInfFlag)?
-    //WBAssertThrow(!parameters.ParseStream<kParseCommentsFlag>(isw).HasParseError(), "Parsing erros world builder file");
-
-    WBAssertThrowExc(!(parameters.ParseStream<kParseCommentsFlag | kParseNanAndInfFlag>(isw).HasParseError()), std::ifstream json_input_stream_error(filename.c_str()); ,
-                     "Parsing errors world builder file: Error(offset " << static_cast<unsigned>(parameters.GetErrorOffset())
-                     << "): " << GetParseError_En(parameters.GetParseError()) << std::endl << std::endl
-                     << " Showing 50 chars before and after: "
-                     << std::string((std::istreambuf_iterator<char>(json_input_stream_error.seekg(0, json_input_stream_error.beg))),
-                                    std::istreambuf_iterator<char>()).substr(static_cast<unsigned>(parameters.GetErrorOffset()) <= 50
-                                                                             ?
-                                                                             0
-                                                                             :
-                                                                             static_cast<unsigned>(parameters.GetErrorOffset()) - 50, 100
-                                                                            ) << std::endl << std::endl
-                     << " Showing 5 chars before and after: "
-                     << std::string((std::istreambuf_iterator<char>(json_input_stream_error.seekg(0, json_input_stream_error.beg))),
-                                    std::istreambuf_iterator<char>()).substr(static_cast<unsigned>(parameters.GetErrorOffset()) <= 5
-                                                                             ? 0
-                                                                             :
-                                                                             static_cast<unsigned>(parameters.GetErrorOffset())-5,
-                                                                             (static_cast<unsigned>(parameters.GetErrorOffset()) + 10 > json_input_stream_error.seekg(0,std::ios::end).tellg()
-                                                                              ?
-                                                                              static_cast<unsigned>(json_input_stream.tellg())-static_cast<unsigned>(parameters.GetErrorOffset())
-                                                                              :
-                                                                              10)
-                                                                            ));
+    //WBAssertThrow(!parameters.Parse<kParseCommentsFlag>(file_content.c_str()).HasParseError(), "Parsing erros world builder file");
+
+    WBAssertThrow(!(parameters.Parse<kParseCommentsFlag | kParseNanAndInfFlag>(file_content.c_str()).HasParseError()),
+                  "Parsing errors world builder file: Error(offset " << static_cast<unsigned>(parameters.GetErrorOffset())
+                  << "): " << GetParseError_En(parameters.GetParseError()) << std::endl << std::endl
+                  << " Showing 50 chars before and after: "
+                  << file_content.substr(static_cast<unsigned>(parameters.GetErrorOffset()) <= 50
+                                         ?
+                                         0
+                                         :
+                                         static_cast<unsigned>(parameters.GetErrorOffset()) - 50, 100
+                                        ) << std::endl << std::endl
+                  << " Showing 5 chars before and after: "
+                  << file_content.substr(static_cast<unsigned>(parameters.GetErrorOffset()) <= 5
+                                         ? 0
+                                         :
+                                         static_cast<unsigned>(parameters.GetErrorOffset())-5,
+                                         10));
 
     WBAssertThrow(parameters.IsObject(), "World builder file is is not an object.");
-    json_input_stream.close();
 
 
-    SchemaDocument schema(declarations);
-    SchemaValidator validator(schema);
+    // Compiling the schema is expensive, so only do it when no precompiled
+    // schema has been provided.
+    std::unique_ptr<SchemaDocument> local_schema;
+    if (schema == nullptr)
+      {
+        local_schema = std::make_unique<SchemaDocument>(declarations);
+        schema = local_schema.get();
+      }
+    SchemaValidator validator(*schema);
 
     if (!parameters.Accept(validator))
       {
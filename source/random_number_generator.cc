@@ -0,0 +1,134 @@
+/*
+  Copyright (C) 2020 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "world_builder/random_number_generator.h"
+
+#include <cstring>
+
+namespace WorldBuilder
+{
+  CounterBasedRandomNumberGenerator::CounterBasedRandomNumberGenerator(const std::uint64_t key_,
+                                                                       const std::uint64_t stream)
+    :
+    key({{static_cast<std::uint32_t>(key_), static_cast<std::uint32_t>(key_ >> 32)}}),
+    counter({{static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32), 0, 0}}),
+    block(),
+    index(4)
+  {}
+
+
+
+  CounterBasedRandomNumberGenerator::result_type
+  CounterBasedRandomNumberGenerator::operator()()
+  {
+    if (index == 4)
+      {
+        block = philox(counter, key);
+        index = 0;
+
+        // go to the next block
+        ++counter[2];
+        if (counter[2] == 0)
+          ++counter[3];
+      }
+    return block[index++];
+  }
+
+
+
+  double
+  CounterBasedRandomNumberGenerator::uniform_real()
+  {
+    // Take the upper 27 and 26 bits of two numbers, like the genrand_res53
+    // function of the reference implementation of the Mersenne twister.
+    const std::uint32_t a = (*this)() >> 5;
+    const std::uint32_t b = (*this)() >> 6;
+    return (a * 67108864.0 + b) * (1.0 / 9007199254740992.0);
+  }
+
+
+
+  std::array<std::uint32_t,4>
+  CounterBasedRandomNumberGenerator::philox(std::array<std::uint32_t,4> counter_,
+                                            std::array<std::uint32_t,2> key_)
+  {
+    const std::uint64_t multiplier_0 = 0xD2511F53;
+    const std::uint64_t multiplier_1 = 0xCD9E8D57;
+    const std::uint32_t weyl_0 = 0x9E3779B9;
+    const std::uint32_t weyl_1 = 0xBB67AE85;
+
+    for (unsigned int round = 0; round < 10; ++round)
+      {
+        if (round > 0)
+          {
+            key_[0] += weyl_0;
+            key_[1] += weyl_1;
+          }
+        const std::uint64_t product_0 = multiplier_0 * counter_[0];
+        const std::uint64_t product_1 = multiplier_1 * counter_[2];
+        counter_ = {{static_cast<std::uint32_t>(product_1 >> 32) ^ counter_[1] ^ key_[0],
+                     static_cast<std::uint32_t>(product_1),
+                     static_cast<std::uint32_t>(product_0 >> 32) ^ counter_[3] ^ key_[1],
+                     static_cast<std::uint32_t>(product_0)
+                    }
+                   };
+      }
+    return counter_;
+  }
+
+
+
+  std::uint64_t
+  CounterBasedRandomNumberGenerator::hash_combine(const std::uint64_t hash_, const std::uint64_t value)
+  {
+    // The finalizer of the splitmix64 generator mixes all the bits.
+    std::uint64_t z = hash_ ^ (value + 0x9E3779B97F4A7C15 + (hash_ << 6) + (hash_ >> 2));
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    return z ^ (z >> 31);
+  }
+
+
+
+  std::uint64_t
+  CounterBasedRandomNumberGenerator::hash_combine(const std::uint64_t hash_, const double value)
+  {
+    // adding zero turns -0 into 0
+    const double normalized_value = value + 0.0;
+    std::uint64_t bits;
+    std::memcpy(&bits, &normalized_value, sizeof(bits));
+    return hash_combine(hash_, bits);
+  }
+
+
+
+  std::uint64_t
+  CounterBasedRandomNumberGenerator::hash(const std::string &string)
+  {
+    // 64 bit FNV-1a hash
+    std::uint64_t hash_ = 0xCBF29CE484222325;
+    for (const char character : string)
+      {
+        hash_ ^= static_cast<unsigned char>(character);
+        hash_ *= 0x100000001B3;
+      }
+    return hash_;
+  }
+} // namespace WorldBuilder
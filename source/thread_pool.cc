@@ -0,0 +1,203 @@
+/*
+  Copyright (C) 2018 - 2021 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "world_builder/thread_pool.h"
+
+#include <algorithm>
+#include <map>
+
+namespace WorldBuilder
+{
+  ThreadPool::ThreadPool(size_t number_of_threads_)
+    :
+    number_of_threads(number_of_threads_ == 0
+                      ?
+                      std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1))
+                      :
+                      number_of_threads_),
+    current_function(nullptr),
+    current_chunk_size(1),
+    generation(0),
+    n_workers_done(0),
+    stop(false),
+    failed(false)
+  {
+    ranges = std::unique_ptr<WorkRange[]>(new WorkRange[number_of_threads]);
+    for (size_t i = 0; i < number_of_threads; ++i)
+      {
+        ranges[i].next = 0;
+        ranges[i].end = 0;
+      }
+
+    // thread 0 is the thread which calls parallel_for.
+    workers.reserve(number_of_threads-1);
+    for (size_t i = 1; i < number_of_threads; ++i)
+      workers.emplace_back(&ThreadPool::worker_loop, this, i);
+  }
+
+
+  ThreadPool::~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    start_condition.notify_all();
+    for (std::thread &worker : workers)
+      worker.join();
+  }
+
+
+  ThreadPool &
+  ThreadPool::get_shared_pool(size_t number_of_threads_)
+  {
+    if (number_of_threads_ == 0)
+      number_of_threads_ = std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1));
+
+    static std::mutex shared_pools_mutex;
+    static std::map<size_t, std::unique_ptr<ThreadPool> > shared_pools;
+
+    std::lock_guard<std::mutex> lock(shared_pools_mutex);
+    std::unique_ptr<ThreadPool> &pool = shared_pools[number_of_threads_];
+    if (pool == nullptr)
+      pool = std::make_unique<ThreadPool>(number_of_threads_);
+    return *pool;
+  }
+
+
+  size_t
+  ThreadPool::n_threads() const
+  {
+    return number_of_threads;
+  }
+
+
+  void
+  ThreadPool::run(const std::function<void(size_t, size_t)> &range_function,
+                  size_t start,
+                  size_t end,
+                  size_t chunk_size)
+  {
+    if (end <= start)
+      return;
+
+    const size_t n = end - start;
+    if (chunk_size == 0)
+      chunk_size = std::max(n / (number_of_threads * 64), static_cast<size_t>(1));
+
+    // Without workers or with only one chunk, there is nothing to share.
+    if (number_of_threads == 1 || n <= chunk_size)
+      {
+        range_function(start, end);
+        return;
+      }
+
+    std::lock_guard<std::mutex> run_lock(run_mutex);
+
+    // Split the range into one contiguous range per thread.
+    const size_t range_size = n / number_of_threads;
+    const size_t remainder = n % number_of_threads;
+    size_t range_start = start;
+    for (size_t i = 0; i < number_of_threads; ++i)
+      {
+        const size_t range_end = range_start + range_size + (i < remainder ? 1 : 0);
+        ranges[i].next.store(range_start, std::memory_order_relaxed);
+        ranges[i].end = range_end;
+        range_start = range_end;
+      }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      current_function = &range_function;
+      current_chunk_size = chunk_size;
+      n_workers_done = 0;
+      exception = nullptr;
+      failed = false;
+      ++generation;
+    }
+    start_condition.notify_all();
+
+    work(0);
+
+    std::exception_ptr loop_exception;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      done_condition.wait(lock, [this] {return n_workers_done == workers.size();});
+      current_function = nullptr;
+      loop_exception = exception;
+      exception = nullptr;
+    }
+
+    if (loop_exception)
+      std::rethrow_exception(loop_exception);
+  }
+
+
+  void
+  ThreadPool::work(const size_t thread_index)
+  {
+    try
+      {
+        // First work on the own range, then steal from the other ranges.
+        for (size_t offset = 0; offset < number_of_threads; ++offset)
+          {
+            WorkRange &range = ranges[(thread_index + offset) % number_of_threads];
+            while (!failed.load(std::memory_order_relaxed))
+              {
+                const size_t chunk_start = range.next.fetch_add(current_chunk_size);
+                if (chunk_start >= range.end)
+                  break;
+                (*current_function)(chunk_start, std::min(chunk_start + current_chunk_size, range.end));
+              }
+          }
+      }
+    catch (...)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!exception)
+          exception = std::current_exception();
+        failed = true;
+      }
+  }
+
+
+  void
+  ThreadPool::worker_loop(const size_t thread_index)
+  {
+    size_t last_generation = 0;
+    while (true)
+      {
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          start_condition.wait(lock, [&] {return stop || generation != last_generation;});
+          if (stop)
+            return;
+          last_generation = generation;
+        }
+
+        work(thread_index);
+
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          ++n_workers_done;
+        }
+        done_condition.notify_one();
+      }
+  }
+} // namespace WorldBuilder
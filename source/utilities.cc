@@ -18,18 +18,48 @@
 */
 
 #include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iomanip>
+#include <iterator>
+#include <limits>
+
+#if defined(__cplusplus) && __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define WB_HAVE_FLOATING_POINT_CHARCONV
+#endif
+#endif
+#endif
+
+#ifndef WB_HAVE_FLOATING_POINT_CHARCONV
+#include <locale.h>
+#if defined(__APPLE__) || defined(__FreeBSD__)
+#include <xlocale.h>
+#endif
+#endif
 
 #include "world_builder/nan.h"
 #include "world_builder/utilities.h"
 
+#ifdef WB_WITH_MPI
+#define OMPI_SKIP_MPICXX 1
+#include <mpi.h>
+#endif
+
 
 namespace WorldBuilder
 {
   namespace Utilities
   {
     bool
-    polygon_contains_point(const std::vector<Point<2> > &point_list,
+    polygon_contains_point(const ArrayView<Point<2> > point_list,
                            const Point<2> &point)
     {
       if (point.get_coordinate_system() == CoordinateSystem::spherical)
@@ -46,7 +76,14 @@ namespace WorldBuilder
     }
 
     bool
-    polygon_contains_point_implementation(const std::vector<Point<2> > &point_list,
+    polygon_contains_point(const std::vector<Point<2> > &point_list,
+                           const Point<2> &point)
+    {
+      return polygon_contains_point(ArrayView<Point<2> >(point_list), point);
+    }
+
+    bool
+    polygon_contains_point_implementation(const ArrayView<Point<2> > point_list,
                                           const Point<2> &point)
     {
       /**
@@ -145,7 +182,7 @@ namespace WorldBuilder
     }
 
     double
-    signed_distance_to_polygon(const std::vector<Point<2> > &point_list,
+    signed_distance_to_polygon(const ArrayView<Point<2> > point_list,
                                const Point<2> &point)
     {
       // If the point lies outside polygon, we give it a negative sign,
@@ -359,21 +396,151 @@ namespace WorldBuilder
       return array;
     }
 
+    const char *
+    parse_double(const char *begin, const char *end, double &value)
+    {
+      // Only decimal numbers are accepted, like streams do. Both from_chars
+      // and strtod would also read nan, inf and infinity, and strtod also
+      // reads hexadecimal numbers.
+      const char *digits = (begin != end && (*begin == '+' || *begin == '-')) ? begin + 1 : begin;
+      if (digits == end || !(std::isdigit(static_cast<unsigned char>(*digits)) || *digits == '.'))
+        return begin;
+
+#ifdef WB_HAVE_FLOATING_POINT_CHARCONV
+      // from_chars does not accept a leading plus sign, streams do. It
+      // returns an error for numbers which are out of the range of a double.
+      const char *first = *begin == '+' ? begin + 1 : begin;
+      const std::from_chars_result result = std::from_chars(first, end, value);
+      return result.ec == std::errc() ? result.ptr : begin;
+#else
+      // For a hexadecimal number only the leading zero is read, like
+      // from_chars does.
+      if (*digits == '0' && digits + 1 != end && (digits[1] == 'x' || digits[1] == 'X'))
+        end = digits + 1;
+
+      // strtod needs a null terminated string, so the number is copied. A
+      // double never needs more than a few tens of characters, except for
+      // numbers with many trailing digits, which take the slow path.
+      const size_t length = static_cast<size_t>(end - begin);
+
+      char buffer[64];
+      std::string long_number;
+      const char *number = buffer;
+      if (length < sizeof(buffer))
+        {
+          std::copy(begin, end, buffer);
+          buffer[length] = '\0';
+        }
+      else
+        {
+          long_number.assign(begin, end);
+          number = long_number.c_str();
+        }
+
+      char *number_end = nullptr;
+      errno = 0;
+#ifdef _WIN32
+      static const _locale_t c_locale = _create_locale(LC_NUMERIC, "C");
+      value = _strtod_l(number, &number_end, c_locale);
+#else
+      static const locale_t c_locale = newlocale(LC_NUMERIC_MASK, "C", nullptr);
+      value = strtod_l(number, &number_end, c_locale);
+#endif
+      // Numbers which are too large or too small for a double are rejected,
+      // like from_chars does. Subnormal numbers are accepted.
+      if (errno == ERANGE && (std::isinf(value) || std::fpclassify(value) == FP_ZERO))
+        return begin;
+      return begin + (number_end - number);
+#endif
+    }
+
+
+    char *
+    format_double(const double value, const unsigned int precision, char *buffer)
+    {
+      WBAssert(precision <= 17, "The precision of a double can be at most 17 digits, but is " << precision << ".");
+#ifdef WB_HAVE_FLOATING_POINT_CHARCONV
+      const std::to_chars_result result = precision == 0
+                                          ? std::to_chars(buffer, buffer + 32, value)
+                                          : std::to_chars(buffer, buffer + 32, value, std::chars_format::general, static_cast<int>(precision));
+      return result.ptr;
+#else
+      auto print = [&](const int digits)
+      {
+#ifdef _WIN32
+        static const _locale_t c_locale = _create_locale(LC_NUMERIC, "C");
+        return _snprintf_l(buffer, 32, "%.*g", c_locale, digits, value);
+#else
+        // The locale is only changed for the calling thread.
+        static const locale_t c_locale = newlocale(LC_NUMERIC_MASK, "C", nullptr);
+        const locale_t old_locale = uselocale(c_locale);
+        const int n_characters = std::snprintf(buffer, 32, "%.*g", digits, value);
+        uselocale(old_locale);
+        return n_characters;
+#endif
+      };
+
+      if (precision > 0)
+        return buffer + print(static_cast<int>(precision));
+
+      // The shortest representation which reads back as the same double has
+      // at most 17 digits. Correctly rounding the double to the smallest
+      // number of digits for which it reads back the same gives it.
+      int n_characters = 0;
+      for (int digits = 15; digits <= 17; ++digits)
+        {
+          n_characters = print(digits);
+          double read_value = 0;
+          if (parse_double(buffer, buffer + n_characters, read_value) == buffer + n_characters
+              && ((read_value >= value && read_value <= value) || std::isnan(value)))
+            break;
+        }
+      return buffer + n_characters;
+#endif
+    }
+
+
+    std::vector<std::string>
+    split_data_line(const std::string &line)
+    {
+      auto is_separator = [](const char character)
+      {
+        return character == ',' || std::isspace(static_cast<unsigned char>(character));
+      };
+
+      std::vector<std::string> words;
+      const char *character = line.data();
+      const char *line_end = line.data() + line.size();
+      while (character != line_end)
+        {
+          while (character != line_end && is_separator(*character))
+            ++character;
+          const char *word_begin = character;
+          while (character != line_end && !is_separator(*character))
+            ++character;
+          if (character != word_begin)
+            words.emplace_back(word_begin, character);
+        }
+      return words;
+    }
+
+
     double
     string_to_double(const std::string &string)
     {
       // trim whitespace on either side of the text if necessary
-      std::string s = string;
-      while ((!s.empty()) && (s[0] == ' '))
-        s.erase(s.begin());
-      while ((!s.empty()) && (s[s.size() - 1] == ' '))
-        s.erase(s.end() - 1);
-
-      std::istringstream i(s);
-      double d;
-      char c;
-      if (!(i >> d) || i.get(c))
-        WBAssertThrow(false, "Could not convert \"" + s + "\" to a double.");
+      size_t begin = 0;
+      size_t end = string.size();
+      while (begin < end && string[begin] == ' ')
+        ++begin;
+      while (end > begin && string[end - 1] == ' ')
+        --end;
+
+      double d = 0;
+      const char *first = string.data() + begin;
+      const char *last = string.data() + end;
+      if (begin == end || parse_double(first, last, d) != last)
+        WBAssertThrow(false, "Could not convert \"" + string.substr(begin, end - begin) + "\" to a double.");
 
       return d;
     }
@@ -433,7 +600,7 @@ namespace WorldBuilder
     distance_point_from_curved_planes(const Point<3> &check_point, // cartesian point in cartesian and spherical system
                                       const NaturalCoordinate &natural_coordinate, // cartesian point cartesian system, spherical point in spherical system
                                       const Point<2> &reference_point, // in (rad) spherical coordinates in spherical system
-                                      const std::vector<Point<2> > &point_list, // in  (rad) spherical coordinates in spherical system
+                                      const ArrayView<Point<2> > point_list, // in  (rad) spherical coordinates in spherical system
                                       const std::vector<std::vector<double> > &plane_segment_lengths,
                                       const std::vector<std::vector<Point<2> > > &plane_segment_angles,
                                       const double start_radius,
@@ -442,7 +609,7 @@ namespace WorldBuilder
                                       const InterpolationType interpolation_type,
                                       const interpolation &x_spline,
                                       const interpolation &y_spline,
-                                      std::vector<double> global_x_list)
+                                      ArrayView<double> global_x_list)
     {
       // TODO: Assert that point_list, plane_segment_angles and plane_segment_lenghts have the same size.
       /*WBAssert(point_list.size() == plane_segment_lengths.size(),
@@ -455,12 +622,14 @@ namespace WorldBuilder
                "Internal error: The size of point_list (" << point_list.size()
                << ") and global_x_list (" << global_x_list.size() << ") are different.");*/
 
+      std::vector<double> default_global_x_list;
       if (global_x_list.empty())
         {
           // fill it
-          global_x_list.resize(point_list.size());
+          default_global_x_list.resize(point_list.size());
           for (size_t i = 0; i < point_list.size(); ++i)
-            global_x_list[i] = static_cast<double>(i);
+            default_global_x_list[i] = static_cast<double>(i);
+          global_x_list = default_global_x_list;
         }
       WBAssertThrow(global_x_list.size() == point_list.size(), "The given global_x_list doesn't have "
                     "the same size as the point list. This is required.");
@@ -1207,6 +1376,36 @@ namespace WorldBuilder
       return return_values;
     }
 
+    PointDistanceFromCurvedPlanes
+    distance_point_from_curved_planes(const Point<3> &check_point,
+                                      const NaturalCoordinate &natural_coordinate,
+                                      const Point<2> &reference_point,
+                                      const std::vector<Point<2> > &point_list,
+                                      const std::vector<std::vector<double> > &plane_segment_lengths,
+                                      const std::vector<std::vector<Point<2> > > &plane_segment_angles,
+                                      const double start_radius,
+                                      const std::unique_ptr<CoordinateSystems::Interface> &coordinate_system,
+                                      const bool only_positive,
+                                      const InterpolationType interpolation_type,
+                                      const interpolation &x_spline,
+                                      const interpolation &y_spline,
+                                      const std::vector<double> &global_x_list)
+    {
+      return distance_point_from_curved_planes(check_point,
+                                               natural_coordinate,
+                                               reference_point,
+                                               ArrayView<Point<2> >(point_list),
+                                               plane_segment_lengths,
+                                               plane_segment_angles,
+                                               start_radius,
+                                               coordinate_system,
+                                               only_positive,
+                                               interpolation_type,
+                                               x_spline,
+                                               y_spline,
+                                               ArrayView<double>(global_x_list));
+    }
+
     void interpolation::set_points(const std::vector<double> &x,
                                    const std::vector<double> &y,
                                    bool monotone_spline)
@@ -1376,6 +1575,134 @@ namespace WorldBuilder
       return rot_matrix;
     }
 
+#ifdef WB_WITH_MPI
+    namespace
+    {
+      /**
+       * Broadcast an array of chars from the process with rank 0 in the
+       * communicator to all other processes. MPI counts are ints, so very
+       * large arrays are sent in pieces.
+       */
+      void
+      broadcast_chars(char *data, const long long size, MPI_Comm communicator)
+      {
+        const long long max_chunk_size = std::numeric_limits<int>::max();
+        for (long long offset = 0; offset < size; offset += max_chunk_size)
+          MPI_Bcast(data + offset,
+                    static_cast<int>(std::min(max_chunk_size, size - offset)),
+                    MPI_CHAR, 0, communicator);
+      }
+    } // namespace
+#endif
+
+    std::string
+    read_and_distribute_file(const std::string &filename,
+                             const int mpi_communicator)
+    {
+      std::string file_content;
+      // the size of the file, or -1 if the file could not be read.
+      long long file_size = -1;
+
+      bool distribute = false;
+      int mpi_rank = 0;
+#ifdef WB_WITH_MPI
+      MPI_Comm communicator = MPI_COMM_NULL;
+      if (mpi_communicator != no_mpi_communicator)
+        {
+          int mpi_initialized;
+          MPI_Initialized(&mpi_initialized);
+          if (mpi_initialized != 0)
+            {
+              communicator = MPI_Comm_f2c(mpi_communicator);
+              MPI_Comm_rank(communicator, &mpi_rank);
+              distribute = true;
+            }
+        }
+#else
+      (void)mpi_communicator;
+#endif
+
+      if (mpi_rank == 0)
+        {
+          std::ifstream file_stream(filename.c_str(), std::ios::binary);
+          if (file_stream.good())
+            {
+              file_content.assign(std::istreambuf_iterator<char>(file_stream),
+                                  std::istreambuf_iterator<char>());
+              file_size = file_stream.bad() ? -1 : static_cast<long long>(file_content.size());
+            }
+        }
+
+#ifdef WB_WITH_MPI
+      if (distribute)
+        {
+#if MPI_VERSION >= 3
+          // Only one process per compute node takes part in the broadcast.
+          // It stores the content in a shared memory window from which all
+          // other processes on that node copy it, so the file is only sent
+          // once to every node instead of once to every process.
+          MPI_Comm node_comm;
+          MPI_Comm_split_type(communicator, MPI_COMM_TYPE_SHARED, mpi_rank, MPI_INFO_NULL, &node_comm);
+          int node_rank;
+          MPI_Comm_rank(node_comm, &node_rank);
+
+          // The process with rank 0 has the smallest key on its node, so it
+          // is also rank 0 in both the node and the leader communicator.
+          MPI_Comm leader_comm;
+          MPI_Comm_split(communicator, node_rank == 0 ? 0 : MPI_UNDEFINED, mpi_rank, &leader_comm);
+
+          if (leader_comm != MPI_COMM_NULL)
+            MPI_Bcast(&file_size, 1, MPI_LONG_LONG, 0, leader_comm);
+          MPI_Bcast(&file_size, 1, MPI_LONG_LONG, 0, node_comm);
+
+          if (file_size > 0)
+            {
+              char *window_data = nullptr;
+              MPI_Win window;
+              MPI_Win_allocate_shared(node_rank == 0 ? static_cast<MPI_Aint>(file_size) : 0, 1,
+                                      MPI_INFO_NULL, node_comm, &window_data, &window);
+              MPI_Win_fence(0, window);
+
+              if (mpi_rank == 0)
+                std::copy(file_content.begin(), file_content.end(), window_data);
+
+              if (leader_comm != MPI_COMM_NULL)
+                broadcast_chars(window_data, file_size, leader_comm);
+
+              MPI_Win_fence(0, window);
+
+              if (node_rank != 0)
+                {
+                  MPI_Aint window_size;
+                  int displacement_unit;
+                  MPI_Win_shared_query(window, 0, &window_size, &displacement_unit, &window_data);
+                }
+              if (mpi_rank != 0)
+                file_content.assign(window_data, static_cast<size_t>(file_size));
+
+              MPI_Win_fence(0, window);
+              MPI_Win_free(&window);
+            }
+
+          if (leader_comm != MPI_COMM_NULL)
+            MPI_Comm_free(&leader_comm);
+          MPI_Comm_free(&node_comm);
+#else
+          MPI_Bcast(&file_size, 1, MPI_LONG_LONG, 0, communicator);
+          if (file_size > 0)
+            {
+              file_content.resize(static_cast<size_t>(file_size));
+              broadcast_chars(&file_content[0], file_size, communicator);
+            }
+#endif
+        }
+#endif
+
+      WBAssertThrow(file_size >= 0, "Could not find or read the file at the specified location: " + filename);
+
+      return file_content;
+    }
+
     template std::array<double,2> convert_point_to_array<2>(const Point<2> &point_);
     template std::array<double,3> convert_point_to_array<3>(const Point<3> &point_);
   } // namespace Utilities
@@ -22,6 +22,7 @@
 
 #include "world_builder/config.h"
 #include "world_builder/nan.h"
+#include "world_builder/thread_pool.h"
 #include "world_builder/types/array.h"
 #include "world_builder/types/bool.h"
 #include "world_builder/types/double.h"
@@ -34,17 +35,106 @@
 #include <mpi.h>
 #endif
 
+#include <algorithm>
+#include <memory>
+
 
 namespace WorldBuilder
 {
   using namespace Utilities;
 
-  World::World(std::string filename, bool has_output_dir, const std::string &output_dir, unsigned long random_number_seed)
+  namespace
+  {
+    /**
+     * Enters a subsection of the parameters when it is constructed and leaves
+     * it again when it is destroyed, also when an exception is thrown.
+     */
+    class SubsectionGuard
+    {
+      public:
+        SubsectionGuard(Parameters &prm_, const std::string &name)
+          :
+          prm(prm_)
+        {
+          prm.enter_subsection(name);
+        }
+
+        ~SubsectionGuard()
+        {
+          prm.leave_subsection();
+        }
+
+        SubsectionGuard(const SubsectionGuard &) = delete;
+        SubsectionGuard &operator=(const SubsectionGuard &) = delete;
+
+      private:
+        Parameters &prm;
+    };
+
+    /**
+     * The declarations of the world builder file and the json schema which
+     * is compiled from them. The declarations do not depend on the world
+     * builder file which is loaded, so they only need to be build once per
+     * process. After that they are shared read-only between all World
+     * objects.
+     */
+    struct SharedDeclarations
+    {
+      explicit SharedDeclarations(Parameters &prm)
+      {
+        World::declare_entries(prm);
+        declarations.CopyFrom(prm.declarations, declarations.GetAllocator());
+        schema = std::make_unique<rapidjson::SchemaDocument>(declarations);
+      }
+
+      rapidjson::Document declarations;
+      std::unique_ptr<rapidjson::SchemaDocument> schema;
+    };
+
+    /**
+     * Returns the shared declarations. The first call declares the entries
+     * into the provided parameters, every following call just returns the
+     * already build declarations. The initialization of the function local
+     * static variable is thread safe.
+     */
+    const SharedDeclarations &
+    get_shared_declarations(Parameters &prm)
+    {
+      static const SharedDeclarations shared_declarations(prm);
+      return shared_declarations;
+    }
+
+    /**
+     * Calls evaluate(i) for all points i with n_threads threads, including
+     * the calling thread. The threads are taken from the pool with n_threads
+     * threads which is shared by the process, and no threads are used when
+     * n_threads is zero or one.
+     */
+    template <class Evaluate>
+    void
+    evaluate_points_in_parallel(const size_t n_points, const size_t n_threads, const Evaluate &evaluate)
+    {
+      if (n_threads <= 1 || n_points <= 1)
+        {
+          for (size_t i = 0; i < n_points; ++i)
+            evaluate(i);
+          return;
+        }
+
+      ThreadPool::get_shared_pool(n_threads).parallel_for(0, n_points, evaluate);
+    }
+  } // namespace
+
+  World::World(std::string filename, bool has_output_dir, const std::string &output_dir, unsigned long random_number_seed_,
+               int mpi_communicator_, size_t n_threads)
     :
+    mpi_communicator(mpi_communicator_),
     parameters(*this),
     surface_coord_conversions(invalid),
     dim(NaN::ISNAN),
-    random_number_engine(random_number_seed)
+    random_number_seed(random_number_seed_),
+    random_number_engine(random_number_seed_),
+    number_of_threads(std::max<size_t>(n_threads, 1))
   {
 #ifdef WB_WITH_MPI
     int mpi_initialized;
@@ -56,17 +146,26 @@ namespace WorldBuilder
       }
     else
       {
-        MPI_Comm_rank(MPI_COMM_WORLD, &MPI_RANK);
-        MPI_Comm_size(MPI_COMM_WORLD, &MPI_SIZE);
+        const MPI_Comm communicator = mpi_communicator == no_mpi_communicator
+                                      ?
+                                      MPI_COMM_WORLD
+                                      :
+                                      MPI_Comm_f2c(mpi_communicator);
+        MPI_Comm_rank(communicator, &MPI_RANK);
+        MPI_Comm_size(communicator, &MPI_SIZE);
       }
 #else
     MPI_RANK = 0;
     MPI_SIZE = 1;
 #endif
 
-    WorldBuilder::World::declare_entries(parameters);
+    // Only the first World declares the entries, all others get a copy of
+    // the declarations and use the precompiled schema to validate their file.
+    const SharedDeclarations &shared_declarations = get_shared_declarations(parameters);
+    if (parameters.declarations.IsNull())
+      parameters.declarations.CopyFrom(shared_declarations.declarations, parameters.declarations.GetAllocator());
 
-    parameters.initialize(filename, has_output_dir, output_dir);
+    parameters.initialize(filename, has_output_dir, output_dir, shared_declarations.schema.get());
 
     this->parse_entries(parameters);
   }
@@ -165,6 +264,7 @@ namespace WorldBuilder
         WBAssertThrow(cross_section_natural.size() == 2, "The cross section should contain two points, but it contains "
                       << cross_section.size() << " points.");
 
+        cross_section.clear();
         for (const auto &it : cross_section_natural)
           cross_section.push_back(it *  (coordinate_system == spherical ? const_pi / 180.0 : 1.0));
 
@@ -215,43 +315,164 @@ namespace WorldBuilder
         }
     }
     prm.leave_subsection();
+
+    std::vector<size_t> feature_indices(prm.features.size());
+    for (size_t i = 0; i < feature_indices.size(); ++i)
+      feature_indices[i] = i;
+    prepare_features(prm.features, feature_indices);
   }
 
-  double
-  World::temperature(const std::array<double,2> &point,
-                     const double depth,
-                     const double gravity_norm) const
+  unsigned int
+  World::reload(std::string filename)
   {
-    // turn it into a 3d coordinate and call the 3d temperature function
-    WBAssertThrow(dim == 2, "This function can only be called when the cross section "
-                  "variable in the world builder file has been set. Dim is "
-                  << dim << ".");
+    // Keep the previous input to find out which features have changed, and to
+    // restore it when the new file is invalid.
+    const std::vector<std::string> previous_path = parameters.path;
+    rapidjson::Document previous_parameters;
+    previous_parameters.Swap(parameters.parameters);
+    try
+      {
+        parameters.initialize(filename, false, "", get_shared_declarations(parameters).schema.get());
+      }
+    catch (...)
+      {
+        parameters.path = previous_path;
+        parameters.parameters.Swap(previous_parameters);
+        throw;
+      }
 
-    const CoordinateSystem coordinate_system = this->parameters.coordinate_system->natural_coordinate_system();
+    // If anything besides the features has changed, like the coordinate
+    // system or the global interpolation settings, every feature may be
+    // affected, so everything is parsed again.
+    const rapidjson::Value &new_root = parameters.parameters;
+    bool globals_changed = new_root.MemberCount() != previous_parameters.MemberCount();
+    for (auto it = new_root.MemberBegin(); it != new_root.MemberEnd() && !globals_changed; ++it)
+      {
+        if (std::string(it->name.GetString()) == "features")
+          continue;
+        const auto previous_it = previous_parameters.FindMember(it->name);
+        globals_changed = previous_it == previous_parameters.MemberEnd() || previous_it->value != it->value;
+      }
 
-    Point<2> point_natural(point[0], point[1],coordinate_system);
-    if (coordinate_system == spherical)
+    if (globals_changed)
       {
-        point_natural[1] = std::sqrt(point[0]*point[0]+point[1]*point[1]);
-        point_natural[0] = std::atan2(point[1],point[0]);
+        // parse_entries changes the world in place, so keep everything it
+        // sets to be able to restore the world when parsing fails.
+        std::unique_ptr<CoordinateSystems::Interface> previous_coordinate_system = std::move(parameters.coordinate_system);
+        std::vector<std::unique_ptr<Features::Interface> > previous_features;
+        previous_features.swap(parameters.features);
+        const unsigned int previous_dim = dim;
+        const std::vector<Point<2> > previous_cross_section = cross_section;
+        const Point<2> previous_surface_coord_conversions = surface_coord_conversions;
+        const double previous_potential_mantle_temperature = potential_mantle_temperature;
+        const double previous_surface_temperature = surface_temperature;
+        const bool previous_force_surface_temperature = force_surface_temperature;
+        const double previous_thermal_expansion_coefficient = thermal_expansion_coefficient;
+        const double previous_specific_heat = specific_heat;
+        const double previous_thermal_diffusivity = thermal_diffusivity;
+        const double previous_maximum_distance_between_coordinates = maximum_distance_between_coordinates;
+        const std::string previous_interpolation = interpolation;
+        try
+          {
+            this->parse_entries(parameters);
+          }
+        catch (...)
+          {
+            parameters.coordinate_system = std::move(previous_coordinate_system);
+            parameters.features.swap(previous_features);
+            dim = previous_dim;
+            cross_section = previous_cross_section;
+            surface_coord_conversions = previous_surface_coord_conversions;
+            potential_mantle_temperature = previous_potential_mantle_temperature;
+            surface_temperature = previous_surface_temperature;
+            force_surface_temperature = previous_force_surface_temperature;
+            thermal_expansion_coefficient = previous_thermal_expansion_coefficient;
+            specific_heat = previous_specific_heat;
+            thermal_diffusivity = previous_thermal_diffusivity;
+            maximum_distance_between_coordinates = previous_maximum_distance_between_coordinates;
+            interpolation = previous_interpolation;
+
+            parameters.path = previous_path;
+            parameters.parameters.Swap(previous_parameters);
+            throw;
+          }
+        return static_cast<unsigned int>(parameters.features.size());
       }
 
-    Point<3> coord_3d(coordinate_system);
-    if (coordinate_system == spherical)
+    const rapidjson::Value &new_features_json = new_root["features"];
+    const rapidjson::Value &previous_features_json = previous_parameters["features"];
+
+    // The changed features are parsed and prepared in a separate vector, so
+    // that the features of the world are only replaced when all of them
+    // have been read successfully.
+    std::vector<std::unique_ptr<Features::Interface> > new_features(new_features_json.Size());
+    std::vector<size_t> changed_features;
+    try
       {
-        coord_3d[0] = point_natural[1];
-        coord_3d[1] = cross_section[0][0] + point_natural[0] * surface_coord_conversions[0];
-        coord_3d[2] = cross_section[0][1] + point_natural[0] * surface_coord_conversions[1];
+        SubsectionGuard features_subsection(parameters, "features");
+        for (unsigned int i = 0; i < new_features_json.Size(); ++i)
+          {
+            if (i < previous_features_json.Size() && new_features_json[i] == previous_features_json[i])
+              continue;
+
+            SubsectionGuard feature_subsection(parameters, std::to_string(i));
+            new_features[i] = Features::Interface::create(parameters.get<std::string>("model"), this);
+            new_features[i]->parse_entries(parameters);
+            changed_features.push_back(i);
+          }
+
+        prepare_features(new_features, changed_features);
       }
-    else
+    catch (...)
       {
-        coord_3d[0] = cross_section[0][0] + point_natural[0] * surface_coord_conversions[0];
-        coord_3d[1] = cross_section[0][1] + point_natural[0] * surface_coord_conversions[1];
-        coord_3d[2] = point_natural[1];
+        parameters.path = previous_path;
+        parameters.parameters.Swap(previous_parameters);
+        throw;
       }
 
+    for (size_t i = 0; i < new_features.size(); ++i)
+      if (new_features[i] == nullptr)
+        new_features[i] = std::move(parameters.features[i]);
+    parameters.features.swap(new_features);
 
-    std::array<double, 3> point_3d_cartesian = this->parameters.coordinate_system->natural_to_cartesian_coordinates(coord_3d.get_array());
+    return static_cast<unsigned int>(changed_features.size());
+  }
+
+  void
+  World::prepare_features(std::vector<std::unique_ptr<Features::Interface> > &features,
+                          const std::vector<size_t> &feature_indices)
+  {
+    /**
+     * Reading the parameters has to be done sequentially, but the features
+     * can compute their derived data, like interpolated coordinates and
+     * segment tables, independently of each other, with the number of
+     * threads given to the constructor. When the world has an MPI
+     * communicator, only one thread is used, because the features then share
+     * their coordinates between the processes of a node, which the processes
+     * have to do for the features in the same order.
+     */
+    const size_t n_threads = mpi_communicator != no_mpi_communicator
+                             ?
+                             1
+                             :
+                             number_of_threads;
+    evaluate_points_in_parallel(feature_indices.size(), n_threads, [&](size_t i)
+    {
+      features[feature_indices[i]]->prepare();
+    });
+  }
+
+  double
+  World::temperature(const std::array<double,2> &point,
+                     const double depth,
+                     const double gravity_norm) const
+  {
+    // turn it into a 3d coordinate and call the 3d temperature function
+    WBAssertThrow(dim == 2, "This function can only be called when the cross section "
+                  "variable in the world builder file has been set. Dim is "
+                  << dim << ".");
+
+    const std::array<double, 3> point_3d_cartesian = cross_section_to_cartesian(point);
 
     return temperature(point_3d_cartesian, depth, gravity_norm);
   }
@@ -300,30 +521,7 @@ namespace WorldBuilder
                   "variable in the world builder file has been set. Dim is "
                   << dim << ".");
 
-    const CoordinateSystem coordinate_system = this->parameters.coordinate_system->natural_coordinate_system();
-
-    Point<2> point_natural(point[0], point[1],coordinate_system);
-    if (coordinate_system == spherical)
-      {
-        point_natural[1] = std::sqrt(point[0]*point[0]+point[1]*point[1]);
-        point_natural[0] = std::atan2(point[1],point[0]);
-      }
-
-    Point<3> coord_3d(coordinate_system);
-    if (coordinate_system == spherical)
-      {
-        coord_3d[0] = point_natural[1];
-        coord_3d[1] = cross_section[0][0] + point_natural[0] * surface_coord_conversions[0];
-        coord_3d[2] = cross_section[0][1] + point_natural[0] * surface_coord_conversions[1];
-      }
-    else
-      {
-        coord_3d[0] = cross_section[0][0] + point_natural[0] * surface_coord_conversions[0];
-        coord_3d[1] = cross_section[0][1] + point_natural[0] * surface_coord_conversions[1];
-        coord_3d[2] = point_natural[1];
-      }
-
-    std::array<double, 3> point_3d_cartesian = this->parameters.coordinate_system->natural_to_cartesian_coordinates(coord_3d.get_array());
+    const std::array<double, 3> point_3d_cartesian = cross_section_to_cartesian(point);
 
     return composition(point_3d_cartesian, depth, composition_number);
   }
@@ -364,55 +562,64 @@ namespace WorldBuilder
                 const unsigned int composition_number,
                 size_t number_of_grains) const
   {
-    // turn it into a 3d coordinate and call the 3d temperature function
+    WorldBuilder::grains grains_;
+    grains_.sizes.resize(number_of_grains);
+    grains_.rotation_matrices.resize(number_of_grains);
+    grains(point, depth, composition_number, number_of_grains,
+           grains_.sizes.data(), grains_.rotation_matrices.data());
+    return grains_;
+  }
+
+  WorldBuilder::grains
+  World::grains(const std::array<double,3> &point,
+                const double depth,
+                const unsigned int composition_number,
+                size_t number_of_grains) const
+  {
+    WorldBuilder::grains grains_;
+    grains_.sizes.resize(number_of_grains);
+    grains_.rotation_matrices.resize(number_of_grains);
+    grains(point, depth, composition_number, number_of_grains,
+           grains_.sizes.data(), grains_.rotation_matrices.data());
+    return grains_;
+  }
+
+  void
+  World::grains(const std::array<double,2> &point,
+                const double depth,
+                const unsigned int composition_number,
+                const size_t number_of_grains,
+                double *sizes,
+                std::array<std::array<double,3>,3> *rotation_matrices) const
+  {
+    // turn it into a 3d coordinate and call the 3d grains function
     WBAssertThrow(dim == 2, "This function can only be called when the cross section "
                   "variable in the world builder file has been set. Dim is "
                   << dim << ".");
 
-    const CoordinateSystem coordinate_system = this->parameters.coordinate_system->natural_coordinate_system();
+    const std::array<double, 3> point_3d_cartesian = cross_section_to_cartesian(point);
 
-    Point<2> point_natural(point[0], point[1],coordinate_system);
-    if (coordinate_system == spherical)
-      {
-        point_natural[1] = std::sqrt(point[0]*point[0]+point[1]*point[1]);
-        point_natural[0] = std::atan2(point[1],point[0]);
-      }
-
-    Point<3> coord_3d(coordinate_system);
-    if (coordinate_system == spherical)
-      {
-        coord_3d[0] = point_natural[1];
-        coord_3d[1] = cross_section[0][0] + point_natural[0] * surface_coord_conversions[0];
-        coord_3d[2] = cross_section[0][1] + point_natural[0] * surface_coord_conversions[1];
-      }
-    else
-      {
-        coord_3d[0] = cross_section[0][0] + point_natural[0] * surface_coord_conversions[0];
-        coord_3d[1] = cross_section[0][1] + point_natural[0] * surface_coord_conversions[1];
-        coord_3d[2] = point_natural[1];
-      }
-
-    std::array<double, 3> point_3d_cartesian = this->parameters.coordinate_system->natural_to_cartesian_coordinates(coord_3d.get_array());
-
-    return grains(point_3d_cartesian, depth, composition_number,number_of_grains);
+    grains(point_3d_cartesian, depth, composition_number, number_of_grains, sizes, rotation_matrices);
   }
 
-  WorldBuilder::grains
+  void
   World::grains(const std::array<double,3> &point_,
                 const double depth,
                 const unsigned int composition_number,
-                size_t number_of_grains) const
+                const size_t number_of_grains,
+                double *sizes,
+                std::array<std::array<double,3>,3> *rotation_matrices) const
   {
     // We receive the cartesian points from the user.
     Point<3> point(point_,cartesian);
     WorldBuilder::Utilities::NaturalCoordinate natural_coordinate = WorldBuilder::Utilities::NaturalCoordinate(point,
                                                                     *(this->parameters.coordinate_system));
-    WorldBuilder::grains grains;
-    grains.sizes.resize(number_of_grains,0);
-    grains.rotation_matrices.resize(number_of_grains);
+    std::fill(sizes, sizes + number_of_grains, 0.);
+    std::fill(rotation_matrices, rotation_matrices + number_of_grains, std::array<std::array<double,3>,3>());
+    const WorldBuilder::grains_view grains(sizes, rotation_matrices, number_of_grains);
     for (const auto &feature : parameters.features)
       {
-        grains = feature->grains(point,natural_coordinate,depth,composition_number, grains);
+        feature->grains(point,natural_coordinate,depth,composition_number, grains);
 
         /*WBAssert(!std::isnan(composition), "Composition is not a number: " << composition
                  << ", based on a feature with the name " << (*it)->get_name());
@@ -422,9 +629,142 @@ namespace WorldBuilder
 
     /*WBAssert(!std::isnan(composition), "Composition is not a number: " << composition);
     WBAssert(std::isfinite(composition), "Composition is not a finite: " << composition);*/
+  }
+
+  void
+  World::properties(const size_t n_points,
+                    const double *x,
+                    const double *z,
+                    const double *depth,
+                    const double *gravity_norm,
+                    const size_t n_compositions,
+                    const unsigned int *composition_numbers,
+                    double *temperatures,
+                    double *compositions,
+                    const size_t n_threads) const
+  {
+    WBAssertThrow(dim == 2, "This function can only be called when the cross section "
+                  "variable in the world builder file has been set. Dim is "
+                  << dim << ".");
+
+    evaluate_points_in_parallel(n_points, n_threads, [&](const size_t i)
+    {
+      properties_at_point(cross_section_to_cartesian({{x[i],z[i]}}),
+                          depth[i],
+                          temperatures != nullptr ? gravity_norm[i] : 0.,
+                          n_compositions,
+                          composition_numbers,
+                          temperatures != nullptr ? temperatures + i : nullptr,
+                          compositions != nullptr ? compositions + i * n_compositions : nullptr);
+    });
+  }
+
+  void
+  World::properties(const size_t n_points,
+                    const double *x,
+                    const double *y,
+                    const double *z,
+                    const double *depth,
+                    const double *gravity_norm,
+                    const size_t n_compositions,
+                    const unsigned int *composition_numbers,
+                    double *temperatures,
+                    double *compositions,
+                    const size_t n_threads) const
+  {
+    evaluate_points_in_parallel(n_points, n_threads, [&](const size_t i)
+    {
+      properties_at_point({{x[i],y[i],z[i]}},
+                          depth[i],
+                          temperatures != nullptr ? gravity_norm[i] : 0.,
+                          n_compositions,
+                          composition_numbers,
+                          temperatures != nullptr ? temperatures + i : nullptr,
+                          compositions != nullptr ? compositions + i * n_compositions : nullptr);
+    });
+  }
+
+  void
+  World::properties_at_point(const std::array<double,3> &point_,
+                             const double depth,
+                             const double gravity_norm,
+                             const size_t n_compositions,
+                             const unsigned int *composition_numbers,
+                             double *temperature_,
+                             double *compositions_) const
+  {
+    // We receive the cartesian points from the user.
+    const Point<3> point(point_,cartesian);
+    const WorldBuilder::Utilities::NaturalCoordinate natural_coordinate(point, *(this->parameters.coordinate_system));
+
+    // The temperature and all the compositions are computed in the same
+    // loop over the features, in the same order as temperature() and
+    // composition() do it.
+    const bool compute_temperature = temperature_ != nullptr
+                                     && !(std::fabs(depth) < 2.0 * std::numeric_limits<double>::epsilon() && force_surface_temperature);
+    double temperature = compute_temperature
+                         ?
+                         potential_mantle_temperature * std::exp(((thermal_expansion_coefficient * gravity_norm) / specific_heat) * depth)
+                         :
+                         this->surface_temperature;
+    if (compositions_ != nullptr)
+      std::fill(compositions_, compositions_ + n_compositions, 0.);
+
+    for (auto &&it : parameters.features)
+      {
+        if (compute_temperature)
+          {
+            temperature = it->temperature(point,natural_coordinate,depth,gravity_norm,temperature);
+
+            WBAssert(!std::isnan(temperature), "Temparture is not a number: " << temperature
+                     << ", based on a feature with the name " << it->get_name());
+            WBAssert(std::isfinite(temperature), "Temparture is not a finite: " << temperature
+                     << ", based on a feature with the name " << it->get_name());
+          }
 
+        if (compositions_ != nullptr)
+          for (size_t c = 0; c < n_compositions; ++c)
+            {
+              compositions_[c] = it->composition(point,natural_coordinate,depth,composition_numbers[c],compositions_[c]);
 
-    return grains;
+              WBAssert(!std::isnan(compositions_[c]), "Composition is not a number: " << compositions_[c]
+                       << ", based on a feature with the name " << it->get_name());
+              WBAssert(std::isfinite(compositions_[c]), "Composition is not a finite: " << compositions_[c]
+                       << ", based on a feature with the name " << it->get_name());
+            }
+      }
+
+    if (temperature_ != nullptr)
+      *temperature_ = temperature;
+  }
+
+  std::array<double,3>
+  World::cross_section_to_cartesian(const std::array<double,2> &point) const
+  {
+    const CoordinateSystem coordinate_system = this->parameters.coordinate_system->natural_coordinate_system();
+
+    Point<2> point_natural(point[0], point[1],coordinate_system);
+    if (coordinate_system == spherical)
+      {
+        point_natural[1] = std::sqrt(point[0]*point[0]+point[1]*point[1]);
+        point_natural[0] = std::atan2(point[1],point[0]);
+      }
+
+    Point<3> coord_3d(coordinate_system);
+    if (coordinate_system == spherical)
+      {
+        coord_3d[0] = point_natural[1];
+        coord_3d[1] = cross_section[0][0] + point_natural[0] * surface_coord_conversions[0];
+        coord_3d[2] = cross_section[0][1] + point_natural[0] * surface_coord_conversions[1];
+      }
+    else
+      {
+        coord_3d[0] = cross_section[0][0] + point_natural[0] * surface_coord_conversions[0];
+        coord_3d[1] = cross_section[0][1] + point_natural[0] * surface_coord_conversions[1];
+        coord_3d[2] = point_natural[1];
+      }
+
+    return this->parameters.coordinate_system->natural_to_cartesian_coordinates(coord_3d.get_array());
   }
 
   std::mt19937 &
@@ -433,5 +773,11 @@ namespace WorldBuilder
     return random_number_engine;
   }
 
+  unsigned long
+  World::get_random_number_seed() const
+  {
+    return random_number_seed;
+  }
+
 } // namespace WorldBuilder
 
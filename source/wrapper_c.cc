@@ -19,6 +19,7 @@
 
 #include "world_builder/wrapper_c.h"
 
+#include "world_builder/assert.h"
 #include "world_builder/world.h"
 
 extern "C" {
@@ -93,6 +94,77 @@ extern "C" {
     *composition = a->composition(position,depth,composition_number);
   }
 
+  /**
+   * This function computes the temperature at n_points 2d points at once, given
+   * arrays with the x, z, depth and gravity of every point.
+   */
+  void temperature_2d_batch(void *ptr_ptr_world, size_t n_points, const double *x, const double *z, const double *depth, const double *gravity, double *temperatures, size_t n_threads)
+  {
+    const WorldBuilder::World *a = reinterpret_cast<WorldBuilder::World *>(ptr_ptr_world);
+    a->properties(n_points, x, z, depth, gravity, 0, nullptr, temperatures, nullptr, n_threads);
+  }
+
+  /**
+   * This function computes the temperature at n_points 3d points at once, given
+   * arrays with the x, y, z, depth and gravity of every point.
+   */
+  void temperature_3d_batch(void *ptr_ptr_world, size_t n_points, const double *x, const double *y, const double *z, const double *depth, const double *gravity, double *temperatures, size_t n_threads)
+  {
+    const WorldBuilder::World *a = reinterpret_cast<WorldBuilder::World *>(ptr_ptr_world);
+    a->properties(n_points, x, y, z, depth, gravity, 0, nullptr, temperatures, nullptr, n_threads);
+  }
+
+  /**
+   * This function computes n_compositions compositions at n_points 2d points at
+   * once, given arrays with the x, z and depth of every point.
+   */
+  void composition_2d_batch(void *ptr_ptr_world, size_t n_points, const double *x, const double *z, const double *depth, size_t n_compositions, const unsigned int *composition_numbers, double *compositions, size_t n_threads)
+  {
+    const WorldBuilder::World *a = reinterpret_cast<WorldBuilder::World *>(ptr_ptr_world);
+    a->properties(n_points, x, z, depth, nullptr, n_compositions, composition_numbers, nullptr, compositions, n_threads);
+  }
+
+  /**
+   * This function computes n_compositions compositions at n_points 3d points at
+   * once, given arrays with the x, y, z and depth of every point.
+   */
+  void composition_3d_batch(void *ptr_ptr_world, size_t n_points, const double *x, const double *y, const double *z, const double *depth, size_t n_compositions, const unsigned int *composition_numbers, double *compositions, size_t n_threads)
+  {
+    const WorldBuilder::World *a = reinterpret_cast<WorldBuilder::World *>(ptr_ptr_world);
+    a->properties(n_points, x, y, z, depth, nullptr, n_compositions, composition_numbers, nullptr, compositions, n_threads);
+  }
+
+  /**
+   * This function computes the temperature and n_compositions compositions at
+   * n_points 2d points in one pass over the points.
+   */
+  void properties_2d_batch(void *ptr_ptr_world, size_t n_points, const double *x, const double *z, const double *depth, const double *gravity, size_t n_compositions, const unsigned int *composition_numbers, double *temperatures, double *compositions, size_t n_threads)
+  {
+    const WorldBuilder::World *a = reinterpret_cast<WorldBuilder::World *>(ptr_ptr_world);
+    a->properties(n_points, x, z, depth, gravity, n_compositions, composition_numbers, temperatures, compositions, n_threads);
+  }
+
+  /**
+   * This function computes the temperature and n_compositions compositions at
+   * n_points 3d points in one pass over the points.
+   */
+  void properties_3d_batch(void *ptr_ptr_world, size_t n_points, const double *x, const double *y, const double *z, const double *depth, const double *gravity, size_t n_compositions, const unsigned int *composition_numbers, double *temperatures, double *compositions, size_t n_threads)
+  {
+    const WorldBuilder::World *a = reinterpret_cast<WorldBuilder::World *>(ptr_ptr_world);
+    a->properties(n_points, x, y, z, depth, gravity, n_compositions, composition_numbers, temperatures, compositions, n_threads);
+  }
+
+  /**
+   * This function checks that the array with the name array_name has
+   * expected_size values, and throws an error otherwise.
+   */
+  void check_array_size(const char *routine_name, const char *array_name, size_t array_size, const char *expected_name, size_t expected_size)
+  {
+    WBAssertThrow(array_size == expected_size,
+                  "Error in " << routine_name << ": The size of " << array_name << " is " << array_size
+                  << ", but it has to be the size of " << expected_name << ", which is " << expected_size << ".");
+  }
+
   /**
    * The destructor for the world builder class. Call this function when done with the
    * world builder.
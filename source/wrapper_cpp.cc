@@ -63,4 +63,30 @@ namespace wrapper_cpp
     std::array<double,3> position = {{x,y,z}};
     return reinterpret_cast<WorldBuilder::World *>(ptr_ptr_world)->composition(position,depth,composition_number);
   }
+
+  void
+  WorldBuilderWrapper::temperature_2d_batch(size_t n_points, const double *x, const double *z, const double *depth, const double *gravity, double *temperatures, size_t n_threads) const
+  {
+    reinterpret_cast<const WorldBuilder::World *>(ptr_ptr_world)->properties(n_points, x, z, depth, gravity, 0, nullptr, temperatures, nullptr, n_threads);
+  }
+
+  void
+  WorldBuilderWrapper::temperature_3d_batch(size_t n_points, const double *x, const double *y, const double *z, const double *depth, const double *gravity, double *temperatures, size_t n_threads) const
+  {
+    reinterpret_cast<const WorldBuilder::World *>(ptr_ptr_world)->properties(n_points, x, y, z, depth, gravity, 0, nullptr, temperatures, nullptr, n_threads);
+  }
+
+  void
+  WorldBuilderWrapper::composition_2d_batch(size_t n_points, const double *x, const double *z, const double *depth,
+                                            size_t n_compositions, const unsigned int *composition_numbers, double *compositions, size_t n_threads) const
+  {
+    reinterpret_cast<const WorldBuilder::World *>(ptr_ptr_world)->properties(n_points, x, z, depth, nullptr, n_compositions, composition_numbers, nullptr, compositions, n_threads);
+  }
+
+  void
+  WorldBuilderWrapper::composition_3d_batch(size_t n_points, const double *x, const double *y, const double *z, const double *depth,
+                                            size_t n_compositions, const unsigned int *composition_numbers, double *compositions, size_t n_threads) const
+  {
+    reinterpret_cast<const WorldBuilder::World *>(ptr_ptr_world)->properties(n_points, x, y, z, depth, nullptr, n_compositions, composition_numbers, nullptr, compositions, n_threads);
+  }
 } // namespace wrapper_cpp
@@ -7,5 +7,246 @@
 %module gwb
 %{
 #include "../include/world_builder/wrapper_cpp.h"
+
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace
+{
+  /**
+   * Gives access to the memory of a Python object which supports the buffer
+   * protocol, like a NumPy array of float64 values, without copying it.
+   */
+  class DoubleArray
+  {
+    public:
+      DoubleArray()
+        : acquired(false)
+      {}
+
+      ~DoubleArray()
+      {
+        if (acquired)
+          PyBuffer_Release(&view);
+      }
+
+      DoubleArray(const DoubleArray &) = delete;
+      DoubleArray &operator=(const DoubleArray &) = delete;
+
+      /**
+       * Gets the memory of the object, which has to be a C contiguous array
+       * of doubles. Returns false and sets a Python error if it is not.
+       */
+      bool acquire(PyObject *object, const char *name, const bool writable)
+      {
+        const int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0);
+        if (PyObject_GetBuffer(object, &view, flags) != 0)
+          {
+            PyErr_Format(PyExc_TypeError, "The argument %s has to be a %scontiguous array of float64 values.",
+                         name, writable ? "writable " : "");
+            return false;
+          }
+        acquired = true;
+
+        const std::string format = view.format == nullptr ? "B" : view.format;
+        if (view.itemsize != static_cast<Py_ssize_t>(sizeof(double)) || (format != "d" && format != "@d" && format != "=d"))
+          {
+            PyErr_Format(PyExc_TypeError, "The argument %s has to be an array of float64 values, but has the format %s.",
+                         name, format.c_str());
+            return false;
+          }
+        return true;
+      }
+
+      size_t size() const
+      {
+        return static_cast<size_t>(view.len) / sizeof(double);
+      }
+
+      double *data() const
+      {
+        return static_cast<double *>(view.buf);
+      }
+
+    private:
+      Py_buffer view;
+      bool acquired;
+  };
+
+  /**
+   * Gets the memory of the input arrays, which all need to have the same
+   * number of points, and of the output array, which needs to have room for
+   * values_per_point values for every point. Returns false and sets a Python
+   * error if any of them is not valid.
+   */
+  bool acquire_arrays(const std::vector<PyObject *> &inputs,
+                      const std::vector<const char *> &names,
+                      PyObject *output,
+                      const char *output_name,
+                      const size_t values_per_point,
+                      std::vector<DoubleArray> &input_arrays,
+                      DoubleArray &output_array)
+  {
+    for (size_t i = 0; i < inputs.size(); ++i)
+      {
+        if (!input_arrays[i].acquire(inputs[i], names[i], false))
+          return false;
+        if (input_arrays[i].size() != input_arrays[0].size())
+          {
+            PyErr_Format(PyExc_ValueError, "The argument %s has %zu values, but %s has %zu values.",
+                         names[i], input_arrays[i].size(), names[0], input_arrays[0].size());
+            return false;
+          }
+      }
+
+    if (!output_array.acquire(output, output_name, true))
+      return false;
+    if (output_array.size() != input_arrays[0].size() * values_per_point)
+      {
+        PyErr_Format(PyExc_ValueError, "The argument %s needs room for %zu values, but has %zu values.",
+                     output_name, input_arrays[0].size() * values_per_point, output_array.size());
+        return false;
+      }
+    return true;
+  }
+
+  /**
+   * Converts a sequence of Python integers to composition numbers. Returns
+   * false and sets a Python error if it is not possible.
+   */
+  bool get_composition_numbers(PyObject *sequence, std::vector<unsigned int> &composition_numbers)
+  {
+    PyObject *fast_sequence = PySequence_Fast(sequence, "The composition numbers have to be a sequence of integers.");
+    if (fast_sequence == nullptr)
+      return false;
+
+    const Py_ssize_t n_compositions = PySequence_Fast_GET_SIZE(fast_sequence);
+    for (Py_ssize_t i = 0; i < n_compositions; ++i)
+      {
+        const unsigned long number = PyLong_AsUnsignedLong(PySequence_Fast_GET_ITEM(fast_sequence, i));
+        if (PyErr_Occurred() != nullptr)
+          {
+            Py_DECREF(fast_sequence);
+            return false;
+          }
+        composition_numbers.push_back(static_cast<unsigned int>(number));
+      }
+    Py_DECREF(fast_sequence);
+    return true;
+  }
+
+  /**
+   * Calls the function with the global interpreter lock released, so that
+   * other Python threads can run while the world builder evaluates the
+   * points. Returns None, or a nullptr with a Python error set if the
+   * function throws an exception.
+   */
+  PyObject *call_without_gil(const std::function<void()> &function)
+  {
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    try
+      {
+        function();
+      }
+    catch (const std::exception &exception)
+      {
+        error = exception.what();
+      }
+    Py_END_ALLOW_THREADS
+
+    if (!error.empty())
+      {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+      }
+    Py_RETURN_NONE;
+  }
+} // namespace
 %}
+
+// The batch functions take raw pointers, which are not usable from Python.
+// The array functions below wrap them for objects with the buffer protocol.
+%ignore wrapper_cpp::WorldBuilderWrapper::temperature_2d_batch;
+%ignore wrapper_cpp::WorldBuilderWrapper::temperature_3d_batch;
+%ignore wrapper_cpp::WorldBuilderWrapper::composition_2d_batch;
+%ignore wrapper_cpp::WorldBuilderWrapper::composition_3d_batch;
+
 %include "../include/world_builder/wrapper_cpp.h"
+
+// Functions which evaluate a whole array of points at once. The coordinates,
+// depths and gravities are given as one dimensional NumPy arrays of float64
+// values, or other objects with the buffer protocol, and the results are
+// written into the preallocated output array without copying any of them.
+// The compositions of a point are next to each other in the output, so it
+// can be a NumPy array with the shape (n_points, len(composition_numbers)).
+// The global interpreter lock is released while the points are evaluated,
+// which is done with n_threads threads, including the calling thread.
+%extend wrapper_cpp::WorldBuilderWrapper
+{
+  PyObject *temperature_2d_array(PyObject *x, PyObject *z, PyObject *depth, PyObject *gravity, PyObject *temperatures, size_t n_threads = 1)
+  {
+    std::vector<DoubleArray> inputs(4);
+    DoubleArray output;
+    if (!acquire_arrays({x, z, depth, gravity}, {"x", "z", "depth", "gravity"}, temperatures, "temperatures", 1, inputs, output))
+      return nullptr;
+
+    const wrapper_cpp::WorldBuilderWrapper *world = $self;
+    return call_without_gil([&]()
+    {
+      world->temperature_2d_batch(inputs[0].size(), inputs[0].data(), inputs[1].data(), inputs[2].data(), inputs[3].data(), output.data(), n_threads);
+    });
+  }
+
+  PyObject *temperature_3d_array(PyObject *x, PyObject *y, PyObject *z, PyObject *depth, PyObject *gravity, PyObject *temperatures, size_t n_threads = 1)
+  {
+    std::vector<DoubleArray> inputs(5);
+    DoubleArray output;
+    if (!acquire_arrays({x, y, z, depth, gravity}, {"x", "y", "z", "depth", "gravity"}, temperatures, "temperatures", 1, inputs, output))
+      return nullptr;
+
+    const wrapper_cpp::WorldBuilderWrapper *world = $self;
+    return call_without_gil([&]()
+    {
+      world->temperature_3d_batch(inputs[0].size(), inputs[0].data(), inputs[1].data(), inputs[2].data(), inputs[3].data(), inputs[4].data(), output.data(), n_threads);
+    });
+  }
+
+  PyObject *composition_2d_array(PyObject *x, PyObject *z, PyObject *depth, PyObject *composition_numbers, PyObject *compositions, size_t n_threads = 1)
+  {
+    std::vector<unsigned int> numbers;
+    if (!get_composition_numbers(composition_numbers, numbers))
+      return nullptr;
+
+    std::vector<DoubleArray> inputs(3);
+    DoubleArray output;
+    if (!acquire_arrays({x, z, depth}, {"x", "z", "depth"}, compositions, "compositions", numbers.size(), inputs, output))
+      return nullptr;
+
+    const wrapper_cpp::WorldBuilderWrapper *world = $self;
+    return call_without_gil([&]()
+    {
+      world->composition_2d_batch(inputs[0].size(), inputs[0].data(), inputs[1].data(), inputs[2].data(), numbers.size(), numbers.data(), output.data(), n_threads);
+    });
+  }
+
+  PyObject *composition_3d_array(PyObject *x, PyObject *y, PyObject *z, PyObject *depth, PyObject *composition_numbers, PyObject *compositions, size_t n_threads = 1)
+  {
+    std::vector<unsigned int> numbers;
+    if (!get_composition_numbers(composition_numbers, numbers))
+      return nullptr;
+
+    std::vector<DoubleArray> inputs(4);
+    DoubleArray output;
+    if (!acquire_arrays({x, y, z, depth}, {"x", "y", "z", "depth"}, compositions, "compositions", numbers.size(), inputs, output))
+      return nullptr;
+
+    const wrapper_cpp::WorldBuilderWrapper *world = $self;
+    return call_without_gil([&]()
+    {
+      world->composition_3d_batch(inputs[0].size(), inputs[0].data(), inputs[1].data(), inputs[2].data(), inputs[3].data(), numbers.size(), numbers.data(), output.data(), n_threads);
+    });
+  }
+}
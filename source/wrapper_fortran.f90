@@ -102,6 +102,145 @@ USE, INTRINSIC :: ISO_C_BINDING!, ONLY: C_PTR
       REAL(C_DOUBLE), intent(out) :: composition
     END SUBROUTINE composition_3d
 
+    !> Create an interface with the 2d temperature batch C function of the World builder.
+    !! This function computes the temperature at n_points points at once given arrays
+    !! with the x, z, depth and gravity of every point. The points are evaluated with
+    !! n_threads threads, including the calling thread, which is the same for all the
+    !! batch functions.
+    SUBROUTINE temperature_2d_batch(cworld, n_points, x, z, depth, gravity, temperatures, n_threads) &
+      BIND(C, NAME='temperature_2d_batch')
+      USE, INTRINSIC :: ISO_C_BINDING
+      IMPLICIT NONE
+      ! This argument is a pointer passed by value.
+      TYPE(C_PTR), INTENT(IN), VALUE :: cworld
+      INTEGER(C_SIZE_T), intent(in), value :: n_points
+      REAL(C_DOUBLE), intent(in) :: x(n_points)
+      REAL(C_DOUBLE), intent(in) :: z(n_points)
+      REAL(C_DOUBLE), intent(in) :: depth(n_points)
+      REAL(C_DOUBLE), intent(in) :: gravity(n_points)
+      REAL(C_DOUBLE), intent(out) :: temperatures(n_points)
+      INTEGER(C_SIZE_T), intent(in), value :: n_threads
+    END SUBROUTINE temperature_2d_batch
+
+    !> Create an interface with the 3d temperature batch C function of the World builder.
+    !! This function computes the temperature at n_points points at once given arrays
+    !! with the x, y, z, depth and gravity of every point.
+    SUBROUTINE temperature_3d_batch(cworld, n_points, x, y, z, depth, gravity, temperatures, n_threads) &
+      BIND(C, NAME='temperature_3d_batch')
+      USE, INTRINSIC :: ISO_C_BINDING
+      IMPLICIT NONE
+      ! This argument is a pointer passed by value.
+      TYPE(C_PTR), INTENT(IN), VALUE :: cworld
+      INTEGER(C_SIZE_T), intent(in), value :: n_points
+      REAL(C_DOUBLE), intent(in) :: x(n_points)
+      REAL(C_DOUBLE), intent(in) :: y(n_points)
+      REAL(C_DOUBLE), intent(in) :: z(n_points)
+      REAL(C_DOUBLE), intent(in) :: depth(n_points)
+      REAL(C_DOUBLE), intent(in) :: gravity(n_points)
+      REAL(C_DOUBLE), intent(out) :: temperatures(n_points)
+      INTEGER(C_SIZE_T), intent(in), value :: n_threads
+    END SUBROUTINE temperature_3d_batch
+
+    !> Create an interface with the 2d composition batch C function of the World builder.
+    !! This function computes n_compositions compositions at n_points points at once given
+    !! arrays with the x, z and depth of every point. Column i of the compositions contains
+    !! the compositions of point i.
+    SUBROUTINE composition_2d_batch(cworld, n_points, x, z, depth, n_compositions, composition_numbers, compositions, &
+                                    n_threads) &
+      BIND(C, NAME='composition_2d_batch')
+      USE, INTRINSIC :: ISO_C_BINDING
+      IMPLICIT NONE
+      ! This argument is a pointer passed by value.
+      TYPE(C_PTR), INTENT(IN), VALUE :: cworld
+      INTEGER(C_SIZE_T), intent(in), value :: n_points
+      REAL(C_DOUBLE), intent(in) :: x(n_points)
+      REAL(C_DOUBLE), intent(in) :: z(n_points)
+      REAL(C_DOUBLE), intent(in) :: depth(n_points)
+      INTEGER(C_SIZE_T), intent(in), value :: n_compositions
+      INTEGER(C_INT), intent(in) :: composition_numbers(n_compositions)
+      REAL(C_DOUBLE), intent(out) :: compositions(n_compositions, n_points)
+      INTEGER(C_SIZE_T), intent(in), value :: n_threads
+    END SUBROUTINE composition_2d_batch
+
+    !> Create an interface with the 3d composition batch C function of the World builder.
+    !! This function computes n_compositions compositions at n_points points at once given
+    !! arrays with the x, y, z and depth of every point. Column i of the compositions
+    !! contains the compositions of point i.
+    SUBROUTINE composition_3d_batch(cworld, n_points, x, y, z, depth, n_compositions, composition_numbers, compositions, &
+                                    n_threads) &
+      BIND(C, NAME='composition_3d_batch')
+      USE, INTRINSIC :: ISO_C_BINDING
+      IMPLICIT NONE
+      ! This argument is a pointer passed by value.
+      TYPE(C_PTR), INTENT(IN), VALUE :: cworld
+      INTEGER(C_SIZE_T), intent(in), value :: n_points
+      REAL(C_DOUBLE), intent(in) :: x(n_points)
+      REAL(C_DOUBLE), intent(in) :: y(n_points)
+      REAL(C_DOUBLE), intent(in) :: z(n_points)
+      REAL(C_DOUBLE), intent(in) :: depth(n_points)
+      INTEGER(C_SIZE_T), intent(in), value :: n_compositions
+      INTEGER(C_INT), intent(in) :: composition_numbers(n_compositions)
+      REAL(C_DOUBLE), intent(out) :: compositions(n_compositions, n_points)
+      INTEGER(C_SIZE_T), intent(in), value :: n_threads
+    END SUBROUTINE composition_3d_batch
+
+    !> Create an interface with the 2d properties batch C function of the World builder.
+    !! This function computes the temperature and n_compositions compositions at n_points
+    !! points in one pass over the points.
+    SUBROUTINE properties_2d_batch(cworld, n_points, x, z, depth, gravity, n_compositions, composition_numbers, &
+                                   temperatures, compositions, n_threads) BIND(C, NAME='properties_2d_batch')
+      USE, INTRINSIC :: ISO_C_BINDING
+      IMPLICIT NONE
+      ! This argument is a pointer passed by value.
+      TYPE(C_PTR), INTENT(IN), VALUE :: cworld
+      INTEGER(C_SIZE_T), intent(in), value :: n_points
+      REAL(C_DOUBLE), intent(in) :: x(n_points)
+      REAL(C_DOUBLE), intent(in) :: z(n_points)
+      REAL(C_DOUBLE), intent(in) :: depth(n_points)
+      REAL(C_DOUBLE), intent(in) :: gravity(n_points)
+      INTEGER(C_SIZE_T), intent(in), value :: n_compositions
+      INTEGER(C_INT), intent(in) :: composition_numbers(n_compositions)
+      REAL(C_DOUBLE), intent(out) :: temperatures(n_points)
+      REAL(C_DOUBLE), intent(out) :: compositions(n_compositions, n_points)
+      INTEGER(C_SIZE_T), intent(in), value :: n_threads
+    END SUBROUTINE properties_2d_batch
+
+    !> Create an interface with the 3d properties batch C function of the World builder.
+    !! This function computes the temperature and n_compositions compositions at n_points
+    !! points in one pass over the points.
+    SUBROUTINE properties_3d_batch(cworld, n_points, x, y, z, depth, gravity, n_compositions, composition_numbers, &
+                                   temperatures, compositions, n_threads) BIND(C, NAME='properties_3d_batch')
+      USE, INTRINSIC :: ISO_C_BINDING
+      IMPLICIT NONE
+      ! This argument is a pointer passed by value.
+      TYPE(C_PTR), INTENT(IN), VALUE :: cworld
+      INTEGER(C_SIZE_T), intent(in), value :: n_points
+      REAL(C_DOUBLE), intent(in) :: x(n_points)
+      REAL(C_DOUBLE), intent(in) :: y(n_points)
+      REAL(C_DOUBLE), intent(in) :: z(n_points)
+      REAL(C_DOUBLE), intent(in) :: depth(n_points)
+      REAL(C_DOUBLE), intent(in) :: gravity(n_points)
+      INTEGER(C_SIZE_T), intent(in), value :: n_compositions
+      INTEGER(C_INT), intent(in) :: composition_numbers(n_compositions)
+      REAL(C_DOUBLE), intent(out) :: temperatures(n_points)
+      REAL(C_DOUBLE), intent(out) :: compositions(n_compositions, n_points)
+      INTEGER(C_SIZE_T), intent(in), value :: n_threads
+    END SUBROUTINE properties_3d_batch
+
+    !> Create an interface with the function which checks the size of an array given to
+    !! the array routines. It throws an error when array_size is not expected_size. The
+    !! names have to be null terminated.
+    SUBROUTINE check_array_size(routine_name, array_name, array_size, expected_name, expected_size) &
+      BIND(C, NAME='check_array_size')
+      USE, INTRINSIC :: ISO_C_BINDING
+      IMPLICIT NONE
+      CHARACTER(KIND=C_CHAR), intent(in) :: routine_name(*)
+      CHARACTER(KIND=C_CHAR), intent(in) :: array_name(*)
+      INTEGER(C_SIZE_T), intent(in), value :: array_size
+      CHARACTER(KIND=C_CHAR), intent(in) :: expected_name(*)
+      INTEGER(C_SIZE_T), intent(in), value :: expected_size
+    END SUBROUTINE check_array_size
+
     !> Create an interface with the release world function.
     !! This is the destructor for the world builder class. Call this function when done
     !! with the world builder.
@@ -115,4 +254,200 @@ USE, INTRINSIC :: ISO_C_BINDING!, ONLY: C_PTR
 
   !> The C pointer to the World Builder world. It is generated by the create_world function.
   TYPE(C_PTR) :: cworld
+
+  !> The array routines below evaluate a whole array of points with one call to the
+  !! World Builder, which is much faster than calling the scalar functions for every
+  !! point. The arrays have to be contiguous and of the same size, and the size of
+  !! the first dimension of the compositions has to be the number of composition
+  !! numbers, otherwise the array routines stop the program with an error message. The points
+  !! are evaluated with n_threads threads, including the calling thread, or only on
+  !! the calling thread when n_threads is not given.
+  !!
+  !! Notes on the use with OpenMP: The temperature and composition functions, scalar
+  !! and array, can be called from several threads at the same time with the same
+  !! world, for example from an OpenMP parallel loop. Creating and releasing a world
+  !! can not be done while other threads use it. Outside of a parallel region, the
+  !! array routines can instead be called with the points of a whole mesh partition
+  !! and the number of threads to use for them.
+  CONTAINS
+
+  !> Returns the number of threads to pass to the batch functions for the optional
+  !! n_threads argument of the array routines.
+  FUNCTION batch_n_threads(n_threads)
+    INTEGER, OPTIONAL, intent(in) :: n_threads
+    INTEGER(C_SIZE_T) :: batch_n_threads
+    batch_n_threads = 1
+    IF (PRESENT(n_threads)) batch_n_threads = INT(MAX(n_threads, 1), KIND=C_SIZE_T)
+  END FUNCTION batch_n_threads
+
+  !> Computes the temperatures at the 2d points given by the arrays x, z, depth and gravity.
+  SUBROUTINE temperature_2d_array(cworld, x, z, depth, gravity, temperatures, n_threads)
+    TYPE(C_PTR), INTENT(IN) :: cworld
+    REAL(C_DOUBLE), CONTIGUOUS, intent(in) :: x(:), z(:), depth(:), gravity(:)
+    REAL(C_DOUBLE), CONTIGUOUS, intent(out) :: temperatures(:)
+    INTEGER, OPTIONAL, intent(in) :: n_threads
+    CALL check_array_size('temperature_2d_array'//C_NULL_CHAR, &
+                          'z'//C_NULL_CHAR, SIZE(z, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('temperature_2d_array'//C_NULL_CHAR, &
+                          'depth'//C_NULL_CHAR, SIZE(depth, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('temperature_2d_array'//C_NULL_CHAR, &
+                          'gravity'//C_NULL_CHAR, SIZE(gravity, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('temperature_2d_array'//C_NULL_CHAR, &
+                          'temperatures'//C_NULL_CHAR, SIZE(temperatures, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL temperature_2d_batch(cworld, SIZE(x, KIND=C_SIZE_T), x, z, depth, gravity, temperatures, &
+                              batch_n_threads(n_threads))
+  END SUBROUTINE temperature_2d_array
+
+  !> Computes the temperatures at the 3d points given by the arrays x, y, z, depth and gravity.
+  SUBROUTINE temperature_3d_array(cworld, x, y, z, depth, gravity, temperatures, n_threads)
+    TYPE(C_PTR), INTENT(IN) :: cworld
+    REAL(C_DOUBLE), CONTIGUOUS, intent(in) :: x(:), y(:), z(:), depth(:), gravity(:)
+    REAL(C_DOUBLE), CONTIGUOUS, intent(out) :: temperatures(:)
+    INTEGER, OPTIONAL, intent(in) :: n_threads
+    CALL check_array_size('temperature_3d_array'//C_NULL_CHAR, &
+                          'y'//C_NULL_CHAR, SIZE(y, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('temperature_3d_array'//C_NULL_CHAR, &
+                          'z'//C_NULL_CHAR, SIZE(z, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('temperature_3d_array'//C_NULL_CHAR, &
+                          'depth'//C_NULL_CHAR, SIZE(depth, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('temperature_3d_array'//C_NULL_CHAR, &
+                          'gravity'//C_NULL_CHAR, SIZE(gravity, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('temperature_3d_array'//C_NULL_CHAR, &
+                          'temperatures'//C_NULL_CHAR, SIZE(temperatures, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL temperature_3d_batch(cworld, SIZE(x, KIND=C_SIZE_T), x, y, z, depth, gravity, temperatures, &
+                              batch_n_threads(n_threads))
+  END SUBROUTINE temperature_3d_array
+
+  !> Computes the compositions with the given composition numbers at the 2d points given
+  !! by the arrays x, z and depth. Column i of the compositions contains the compositions
+  !! of point i.
+  SUBROUTINE composition_2d_array(cworld, x, z, depth, composition_numbers, compositions, n_threads)
+    TYPE(C_PTR), INTENT(IN) :: cworld
+    REAL(C_DOUBLE), CONTIGUOUS, intent(in) :: x(:), z(:), depth(:)
+    INTEGER(C_INT), CONTIGUOUS, intent(in) :: composition_numbers(:)
+    REAL(C_DOUBLE), CONTIGUOUS, intent(out) :: compositions(:,:)
+    INTEGER, OPTIONAL, intent(in) :: n_threads
+    CALL check_array_size('composition_2d_array'//C_NULL_CHAR, &
+                          'z'//C_NULL_CHAR, SIZE(z, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('composition_2d_array'//C_NULL_CHAR, &
+                          'depth'//C_NULL_CHAR, SIZE(depth, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('composition_2d_array'//C_NULL_CHAR, &
+                          'the first dimension of compositions'//C_NULL_CHAR, SIZE(compositions, 1, KIND=C_SIZE_T), &
+                          'composition_numbers'//C_NULL_CHAR, SIZE(composition_numbers, KIND=C_SIZE_T))
+    CALL check_array_size('composition_2d_array'//C_NULL_CHAR, &
+                          'the second dimension of compositions'//C_NULL_CHAR, SIZE(compositions, 2, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL composition_2d_batch(cworld, SIZE(x, KIND=C_SIZE_T), x, z, depth, &
+                              SIZE(composition_numbers, KIND=C_SIZE_T), composition_numbers, compositions, &
+                              batch_n_threads(n_threads))
+  END SUBROUTINE composition_2d_array
+
+  !> Computes the compositions with the given composition numbers at the 3d points given
+  !! by the arrays x, y, z and depth. Column i of the compositions contains the compositions
+  !! of point i.
+  SUBROUTINE composition_3d_array(cworld, x, y, z, depth, composition_numbers, compositions, n_threads)
+    TYPE(C_PTR), INTENT(IN) :: cworld
+    REAL(C_DOUBLE), CONTIGUOUS, intent(in) :: x(:), y(:), z(:), depth(:)
+    INTEGER(C_INT), CONTIGUOUS, intent(in) :: composition_numbers(:)
+    REAL(C_DOUBLE), CONTIGUOUS, intent(out) :: compositions(:,:)
+    INTEGER, OPTIONAL, intent(in) :: n_threads
+    CALL check_array_size('composition_3d_array'//C_NULL_CHAR, &
+                          'y'//C_NULL_CHAR, SIZE(y, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('composition_3d_array'//C_NULL_CHAR, &
+                          'z'//C_NULL_CHAR, SIZE(z, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('composition_3d_array'//C_NULL_CHAR, &
+                          'depth'//C_NULL_CHAR, SIZE(depth, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('composition_3d_array'//C_NULL_CHAR, &
+                          'the first dimension of compositions'//C_NULL_CHAR, SIZE(compositions, 1, KIND=C_SIZE_T), &
+                          'composition_numbers'//C_NULL_CHAR, SIZE(composition_numbers, KIND=C_SIZE_T))
+    CALL check_array_size('composition_3d_array'//C_NULL_CHAR, &
+                          'the second dimension of compositions'//C_NULL_CHAR, SIZE(compositions, 2, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL composition_3d_batch(cworld, SIZE(x, KIND=C_SIZE_T), x, y, z, depth, &
+                              SIZE(composition_numbers, KIND=C_SIZE_T), composition_numbers, compositions, &
+                              batch_n_threads(n_threads))
+  END SUBROUTINE composition_3d_array
+
+  !> Computes the temperatures and the compositions with the given composition numbers at
+  !! the 2d points given by the arrays x, z, depth and gravity in one pass over the points.
+  SUBROUTINE properties_2d_array(cworld, x, z, depth, gravity, composition_numbers, temperatures, compositions, &
+                                 n_threads)
+    TYPE(C_PTR), INTENT(IN) :: cworld
+    REAL(C_DOUBLE), CONTIGUOUS, intent(in) :: x(:), z(:), depth(:), gravity(:)
+    INTEGER(C_INT), CONTIGUOUS, intent(in) :: composition_numbers(:)
+    REAL(C_DOUBLE), CONTIGUOUS, intent(out) :: temperatures(:)
+    REAL(C_DOUBLE), CONTIGUOUS, intent(out) :: compositions(:,:)
+    INTEGER, OPTIONAL, intent(in) :: n_threads
+    CALL check_array_size('properties_2d_array'//C_NULL_CHAR, &
+                          'z'//C_NULL_CHAR, SIZE(z, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('properties_2d_array'//C_NULL_CHAR, &
+                          'depth'//C_NULL_CHAR, SIZE(depth, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('properties_2d_array'//C_NULL_CHAR, &
+                          'gravity'//C_NULL_CHAR, SIZE(gravity, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('properties_2d_array'//C_NULL_CHAR, &
+                          'temperatures'//C_NULL_CHAR, SIZE(temperatures, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('properties_2d_array'//C_NULL_CHAR, &
+                          'the first dimension of compositions'//C_NULL_CHAR, SIZE(compositions, 1, KIND=C_SIZE_T), &
+                          'composition_numbers'//C_NULL_CHAR, SIZE(composition_numbers, KIND=C_SIZE_T))
+    CALL check_array_size('properties_2d_array'//C_NULL_CHAR, &
+                          'the second dimension of compositions'//C_NULL_CHAR, SIZE(compositions, 2, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL properties_2d_batch(cworld, SIZE(x, KIND=C_SIZE_T), x, z, depth, gravity, &
+                             SIZE(composition_numbers, KIND=C_SIZE_T), composition_numbers, temperatures, compositions, &
+                             batch_n_threads(n_threads))
+  END SUBROUTINE properties_2d_array
+
+  !> Computes the temperatures and the compositions with the given composition numbers at
+  !! the 3d points given by the arrays x, y, z, depth and gravity in one pass over the points.
+  SUBROUTINE properties_3d_array(cworld, x, y, z, depth, gravity, composition_numbers, temperatures, compositions, &
+                                 n_threads)
+    TYPE(C_PTR), INTENT(IN) :: cworld
+    REAL(C_DOUBLE), CONTIGUOUS, intent(in) :: x(:), y(:), z(:), depth(:), gravity(:)
+    INTEGER(C_INT), CONTIGUOUS, intent(in) :: composition_numbers(:)
+    REAL(C_DOUBLE), CONTIGUOUS, intent(out) :: temperatures(:)
+    REAL(C_DOUBLE), CONTIGUOUS, intent(out) :: compositions(:,:)
+    INTEGER, OPTIONAL, intent(in) :: n_threads
+    CALL check_array_size('properties_3d_array'//C_NULL_CHAR, &
+                          'y'//C_NULL_CHAR, SIZE(y, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('properties_3d_array'//C_NULL_CHAR, &
+                          'z'//C_NULL_CHAR, SIZE(z, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('properties_3d_array'//C_NULL_CHAR, &
+                          'depth'//C_NULL_CHAR, SIZE(depth, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('properties_3d_array'//C_NULL_CHAR, &
+                          'gravity'//C_NULL_CHAR, SIZE(gravity, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('properties_3d_array'//C_NULL_CHAR, &
+                          'temperatures'//C_NULL_CHAR, SIZE(temperatures, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL check_array_size('properties_3d_array'//C_NULL_CHAR, &
+                          'the first dimension of compositions'//C_NULL_CHAR, SIZE(compositions, 1, KIND=C_SIZE_T), &
+                          'composition_numbers'//C_NULL_CHAR, SIZE(composition_numbers, KIND=C_SIZE_T))
+    CALL check_array_size('properties_3d_array'//C_NULL_CHAR, &
+                          'the second dimension of compositions'//C_NULL_CHAR, SIZE(compositions, 2, KIND=C_SIZE_T), &
+                          'x'//C_NULL_CHAR, SIZE(x, KIND=C_SIZE_T))
+    CALL properties_3d_batch(cworld, SIZE(x, KIND=C_SIZE_T), x, y, z, depth, gravity, &
+                             SIZE(composition_numbers, KIND=C_SIZE_T), composition_numbers, temperatures, compositions, &
+                             batch_n_threads(n_threads))
+  END SUBROUTINE properties_3d_array
   END MODULE WorldBuilder
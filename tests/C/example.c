@@ -47,6 +47,19 @@ int main(int argc, char *argv[]) {
   composition_3d(ptr_world,x,y,z,depth,composition_number,&composition);
   printf("composition in C = %f \n", composition);
 
+  printf("3d batch: \n");
+  double xs[2] = {x, 1};
+  double ys[2] = {y, 2};
+  double zs[2] = {z, 3};
+  double depths[2] = {depth, depth};
+  double gravities[2] = {gravity, gravity};
+  unsigned int composition_numbers[2] = {0, composition_number};
+  double temperatures[2];
+  double compositions[4];
+  properties_3d_batch(ptr_world,2,xs,ys,zs,depths,gravities,2,composition_numbers,temperatures,compositions,1);
+  for (int i = 0; i < 2; ++i)
+    printf("temperature in C = %f, compositions in C = %f %f \n", temperatures[i], compositions[2*i], compositions[2*i+1]);
+
   release_world(ptr_world);
 
   return 0;
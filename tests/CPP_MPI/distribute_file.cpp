@@ -0,0 +1,60 @@
+#include "world_builder/utilities.h"
+#include "world_builder/world.h"
+
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <mpi.h>
+
+int main(int argc, char *argv[]) {
+
+   if( argc > 2 ) {
+      printf("Too many arguments supplied.\n");
+      return 1;
+   }
+   else if (argc != 2) {
+      printf("One argument expected.\n");
+      return 1;
+   }
+
+  int MPI_RANK = 0;
+  int MPI_SIZE = 1;
+  MPI_Init(&argc,&argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &MPI_RANK);
+  MPI_Comm_size(MPI_COMM_WORLD, &MPI_SIZE);
+
+  // All processes get the file content, but only rank 0 reads it from disk.
+  std::string distributed_content = WorldBuilder::Utilities::read_and_distribute_file(argv[1], MPI_Comm_c2f(MPI_COMM_WORLD));
+
+  std::ifstream file_stream(argv[1]);
+  std::string local_content((std::istreambuf_iterator<char>(file_stream)),
+                            std::istreambuf_iterator<char>());
+
+  int content_equal = distributed_content == local_content ? 1 : 0;
+  int all_content_equal = 0;
+  MPI_Allreduce(&content_equal, &all_content_equal, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+  // Without a communicator the file is read without any communication, so
+  // this does not wait for the other processes.
+  int local_content_equal = 1;
+  if(MPI_RANK == 1)
+    local_content_equal = WorldBuilder::Utilities::read_and_distribute_file(argv[1]) == local_content ? 1 : 0;
+  int all_local_content_equal = 0;
+  MPI_Allreduce(&local_content_equal, &all_local_content_equal, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+  // Creating a world with a communicator uses the same function to read the
+  // world builder file.
+  WorldBuilder::World world(argv[1], false, "", 1, MPI_Comm_c2f(MPI_COMM_WORLD));
+
+  if(MPI_RANK == 1)
+  {
+  printf("MPI size %i, content size %i, content equal on all ranks: %i\n",MPI_SIZE, static_cast<int>(distributed_content.size()), all_content_equal);
+  printf("content read without communicator equal: %i\n", all_local_content_equal);
+
+  std::array<double,3> coords_3d = {{120e3, 500e3, 500e3}};
+  printf("3d temperature in C = %f \n", world.temperature(coords_3d,0,10));
+  }
+
+  MPI_Finalize();
+  return 0;
+}
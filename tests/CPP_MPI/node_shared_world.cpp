@@ -0,0 +1,108 @@
+#include "world_builder/node_shared_array.h"
+#include "world_builder/world.h"
+
+#include <cmath>
+#include <numeric>
+#include <stdio.h>
+#include <vector>
+#include <mpi.h>
+
+int main(int argc, char *argv[]) {
+
+   if( argc > 2 ) {
+      printf("Too many arguments supplied.\n");
+      return 1;
+   }
+   else if (argc != 2) {
+      printf("One argument expected.\n");
+      return 1;
+   }
+
+  int MPI_RANK = 0;
+  int MPI_SIZE = 1;
+  MPI_Init(&argc,&argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &MPI_RANK);
+  MPI_Comm_size(MPI_COMM_WORLD, &MPI_SIZE);
+
+  MPI_Comm node_comm;
+  MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, MPI_RANK, MPI_INFO_NULL, &node_comm);
+  int node_rank = 0;
+  MPI_Comm_rank(node_comm, &node_rank);
+  int first_on_node = node_rank == 0 ? 1 : 0;
+  int n_nodes = 0;
+  MPI_Allreduce(&first_on_node, &n_nodes, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+  {
+    // The values of a shared array are only computed once per node, and all
+    // processes of the node read the same memory.
+    int n_computed = 0;
+    WorldBuilder::Utilities::NodeSharedArray<double> array;
+    array.create(MPI_Comm_c2f(MPI_COMM_WORLD), [&]()
+    {
+      ++n_computed;
+      std::vector<double> values(1000);
+      std::iota(values.begin(), values.end(), 0.5);
+      return values;
+    });
+
+    int n_computed_total = 0;
+    MPI_Allreduce(&n_computed, &n_computed_total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    int values_correct = array.size() == 1000 ? 1 : 0;
+    for (size_t i = 0; i < array.size(); ++i)
+      if (std::fabs(array[i] - (static_cast<double>(i) + 0.5)) > 0)
+        values_correct = 0;
+    int all_values_correct = 0;
+    MPI_Allreduce(&values_correct, &all_values_correct, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+    if(MPI_RANK == 1)
+      printf("MPI size %i, nodes %i, shared array computed %i times, values correct on all ranks: %i\n",
+             MPI_SIZE, n_nodes, n_computed_total, all_values_correct);
+  }
+
+  {
+    // The densified coordinates of the features are shared between the
+    // processes, which should not change the results.
+    WorldBuilder::World world(argv[1], false, "", 1, MPI_Comm_c2f(MPI_COMM_WORLD));
+
+    std::vector<double> temperatures;
+    std::vector<double> compositions;
+    for (double x = 0; x <= 1000e3; x += 50e3)
+      for (double y = 100e3; y <= 1000e3; y += 100e3)
+        for (double depth = 0; depth <= 200e3; depth += 50e3)
+        {
+          std::array<double,3> coords_3d = {{x, y, 800e3 - depth}};
+          temperatures.push_back(world.temperature(coords_3d, depth, 10));
+          compositions.push_back(world.composition(coords_3d, depth, 0));
+        }
+
+    std::vector<double> temperatures_rank_0 = temperatures;
+    std::vector<double> compositions_rank_0 = compositions;
+    MPI_Bcast(temperatures_rank_0.data(), static_cast<int>(temperatures_rank_0.size()), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Bcast(compositions_rank_0.data(), static_cast<int>(compositions_rank_0.size()), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    int equal = temperatures == temperatures_rank_0 && compositions == compositions_rank_0 ? 1 : 0;
+    int all_equal = 0;
+    MPI_Allreduce(&equal, &all_equal, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+    if(MPI_RANK == 1)
+    {
+    printf("results equal on all ranks: %i\n", all_equal);
+    printf("sum of temperatures = %f, sum of compositions = %f\n",
+           std::accumulate(temperatures.begin(), temperatures.end(), 0.0),
+           std::accumulate(compositions.begin(), compositions.end(), 0.0));
+    }
+  }
+
+  if(MPI_RANK == 1)
+  {
+    // Without a communicator the world does not communicate with the other
+    // processes, so it can be created and destroyed on a single process.
+    WorldBuilder::World world(argv[1]);
+    std::array<double,3> coords_3d = {{500e3, 500e3, 800e3 - 50e3}};
+    printf("temperature of a world on a single rank = %f\n", world.temperature(coords_3d, 50e3, 10));
+  }
+
+  MPI_Comm_free(&node_comm);
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,305 @@
+/*
+  Copyright (C) 2020 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+/**
+ * Queries one world from many threads at the same time and checks that every
+ * thread gets exactly the same temperatures, compositions and grains as a
+ * serial evaluation of the same points. The points are spread over the domain
+ * of a grid file of the visualizer, so every cookbook can be tested with its
+ * own world builder and grid file. Every thread evaluates all the points, each
+ * starting at a different point, so different threads evaluate different
+ * features at the same time. When built with ThreadSanitizer, this also checks
+ * that the queries do not have any data races.
+ */
+
+#include "world_builder/assert.h"
+#include "world_builder/utilities.h"
+#include "world_builder/world.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace WorldBuilder::Utilities;
+
+namespace
+{
+  /**
+   * Reads the settings of a grid file of the visualizer into a map from the
+   * names to the values.
+   */
+  std::map<std::string, std::string> read_grid_file(const std::string &filename)
+  {
+    std::ifstream file(filename);
+    WBAssertThrow(file.good(), "Could not open the grid file " << filename << ".");
+
+    std::map<std::string, std::string> settings;
+    std::string line;
+    while (std::getline(file, line))
+      {
+        line = line.substr(0, line.find('#'));
+        const size_t equal_sign = line.find('=');
+        if (equal_sign == std::string::npos)
+          continue;
+
+        const std::vector<std::string> name = split_data_line(line.substr(0, equal_sign));
+        const std::vector<std::string> value = split_data_line(line.substr(equal_sign + 1));
+        if (name.size() == 1 && value.size() == 1)
+          settings[name[0]] = value[0];
+      }
+    return settings;
+  }
+
+  /**
+   * The points at which the world is queried, with the depth of every point.
+   */
+  struct Points
+  {
+    unsigned int dim;
+    std::vector<std::array<double,3> > positions;
+    std::vector<double> depths;
+  };
+
+  /**
+   * Spreads n_points points over the domain of the grid, with the fractional
+   * parts of multiples of irrational numbers, so that the points cover the
+   * domain evenly without being on a regular grid.
+   */
+  Points create_points(const std::map<std::string, std::string> &settings, const size_t n_points)
+  {
+    auto get = [&](const std::string &name) -> double
+    {
+      const auto setting = settings.find(name);
+      return setting == settings.end() ? 0. : string_to_double(setting->second);
+    };
+
+    const std::string grid_type = settings.count("grid_type") > 0 ? settings.at("grid_type") : "cartesian";
+    WBAssertThrow(grid_type == "cartesian" || grid_type == "chunk",
+                  "Only cartesian and chunk grids are supported, but the grid type is " << grid_type << ".");
+
+    Points points;
+    points.dim = settings.count("dim") > 0 ? string_to_unsigned_int(settings.at("dim")) : 3;
+    for (size_t i = 0; i < n_points; ++i)
+      {
+        const double fraction_x = std::fmod(static_cast<double>(i) * 0.6180339887498949, 1.0);
+        const double fraction_y = std::fmod(static_cast<double>(i) * 0.7548776662466927, 1.0);
+        const double fraction_z = std::fmod(static_cast<double>(i) * 0.5698402909980532, 1.0);
+        const double x = get("x_min") + fraction_x * (get("x_max") - get("x_min"));
+        const double y = get("y_min") + fraction_y * (get("y_max") - get("y_min"));
+        const double z = get("z_min") + fraction_z * (get("z_max") - get("z_min"));
+
+        std::array<double,3> position = {{x, points.dim == 2 ? z : y, z}};
+        if (grid_type == "chunk")
+          {
+            // x and y are the longitude and latitude in degrees and z is the radius
+            const double longitude = x * const_pi / 180.;
+            const double latitude = y * const_pi / 180.;
+            if (points.dim == 2)
+              position = {{z * std::cos(longitude), z * std::sin(longitude), 0.}};
+            else
+              position = {{z * std::cos(latitude) * std::cos(longitude),
+                           z * std::cos(latitude) * std::sin(longitude),
+                           z * std::sin(latitude)
+                          }
+                         };
+          }
+        points.positions.push_back(position);
+        points.depths.push_back(get("z_max") - z);
+      }
+    return points;
+  }
+
+  /**
+   * Computes all the values of a point: the temperature, the compositions
+   * and the sizes and rotation matrices of the grains of the compositions.
+   */
+  void evaluate_point(const WorldBuilder::World &world,
+                      const Points &points,
+                      const size_t point,
+                      const unsigned int n_compositions,
+                      const size_t n_grains,
+                      double *values)
+  {
+    auto evaluate = [&](const auto &position)
+    {
+      const double depth = points.depths[point];
+      *values++ = world.temperature(position, depth, 10.);
+      for (unsigned int c = 0; c < n_compositions; ++c)
+        *values++ = world.composition(position, depth, c);
+
+      std::vector<double> sizes(n_grains);
+      std::vector<std::array<std::array<double,3>,3> > rotation_matrices(n_grains);
+      for (unsigned int c = 0; c < n_compositions; ++c)
+        {
+          world.grains(position, depth, c, n_grains, sizes.data(), rotation_matrices.data());
+          for (size_t g = 0; g < n_grains; ++g)
+            {
+              *values++ = sizes[g];
+              for (size_t i = 0; i < 3; ++i)
+                for (size_t j = 0; j < 3; ++j)
+                  *values++ = rotation_matrices[g][i][j];
+            }
+        }
+    };
+
+    const std::array<double,3> &position = points.positions[point];
+    if (points.dim == 2)
+      evaluate(std::array<double,2> {{position[0], position[1]}});
+    else
+      evaluate(position);
+  }
+
+  /**
+   * Returns the index of the first value which is not bitwise equal in both
+   * vectors, or the size of the vectors if all values are the same.
+   */
+  size_t first_difference(const std::vector<double> &values, const std::vector<double> &reference)
+  {
+    for (size_t i = 0; i < reference.size(); ++i)
+      if (std::memcmp(&values[i], &reference[i], sizeof(double)) != 0)
+        return i;
+    return reference.size();
+  }
+}
+
+
+int main(int argc, char **argv)
+{
+  if (argc < 3)
+    {
+      std::cout << "Usage: " << argv[0] << " world_builder_file grid_file [number_of_threads] [number_of_points]" << std::endl;
+      return 1;
+    }
+
+  try
+    {
+      const size_t n_threads = argc > 3 ? string_to_unsigned_int(argv[3]) : 8;
+      const size_t n_points = argc > 4 ? string_to_unsigned_int(argv[4]) : 1000;
+      const unsigned int n_compositions = 3;
+      const size_t n_grains = 2;
+      const size_t n_values = 1 + n_compositions + n_compositions * n_grains * 10;
+
+      const WorldBuilder::World world(argv[1]);
+      const Points points = create_points(read_grid_file(argv[2]), n_points);
+
+      std::vector<double> reference(n_points * n_values);
+      for (size_t i = 0; i < n_points; ++i)
+        evaluate_point(world, points, i, n_compositions, n_grains, &reference[i * n_values]);
+
+      // Every thread evaluates all points, starting at its own point.
+      std::vector<std::vector<double> > results(n_threads, std::vector<double>(n_points * n_values));
+      {
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < n_threads; ++t)
+          threads.emplace_back([&, t]()
+          {
+            for (size_t k = 0; k < n_points; ++k)
+              {
+                const size_t i = (k + t * n_points / n_threads) % n_points;
+                evaluate_point(world, points, i, n_compositions, n_grains, &results[t][i * n_values]);
+              }
+          });
+        for (auto &thread : threads)
+          thread.join();
+      }
+
+      // Every thread also evaluates all points at once with the functions for
+      // many points, which use the shared thread pools of the process. The
+      // threads ask for two or three threads, so several threads share each
+      // pool at the same time.
+      std::vector<double> reference_properties(n_points * (1 + n_compositions));
+      for (size_t i = 0; i < n_points; ++i)
+        std::copy(&reference[i * n_values], &reference[i * n_values] + 1 + n_compositions, &reference_properties[i * (1 + n_compositions)]);
+
+      std::vector<std::vector<double> > results_properties(n_threads, std::vector<double>(n_points * (1 + n_compositions)));
+      {
+        std::vector<double> x(n_points), y(n_points), z(n_points), gravity(n_points, 10.);
+        for (size_t i = 0; i < n_points; ++i)
+          {
+            x[i] = points.positions[i][0];
+            y[i] = points.positions[i][1];
+            z[i] = points.positions[i][2];
+          }
+        std::vector<unsigned int> composition_numbers(n_compositions);
+        for (unsigned int c = 0; c < n_compositions; ++c)
+          composition_numbers[c] = c;
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < n_threads; ++t)
+          threads.emplace_back([&, t]()
+          {
+            std::vector<double> temperatures(n_points), compositions(n_points * n_compositions);
+            const size_t n_pool_threads = 2 + t % 2;
+            if (points.dim == 2)
+              world.properties(n_points, x.data(), y.data(), points.depths.data(), gravity.data(), n_compositions,
+                               composition_numbers.data(), temperatures.data(), compositions.data(), n_pool_threads);
+            else
+              world.properties(n_points, x.data(), y.data(), z.data(), points.depths.data(), gravity.data(), n_compositions,
+                               composition_numbers.data(), temperatures.data(), compositions.data(), n_pool_threads);
+            for (size_t i = 0; i < n_points; ++i)
+              {
+                results_properties[t][i * (1 + n_compositions)] = temperatures[i];
+                std::copy(&compositions[i * n_compositions], &compositions[i * n_compositions] + n_compositions,
+                          &results_properties[t][i * (1 + n_compositions) + 1]);
+              }
+          });
+        for (auto &thread : threads)
+          thread.join();
+      }
+
+      for (size_t t = 0; t < n_threads; ++t)
+        {
+          const size_t difference = first_difference(results[t], reference);
+          if (difference != reference.size())
+            {
+              std::cout << "Thread " << t << " computed " << results[t][difference] << " for value " << difference % n_values
+                        << " of point " << difference / n_values << ", but the serial evaluation gave " << reference[difference] << "." << std::endl;
+              return 1;
+            }
+
+          const size_t difference_properties = first_difference(results_properties[t], reference_properties);
+          if (difference_properties != reference_properties.size())
+            {
+              std::cout << "Thread " << t << " computed " << results_properties[t][difference_properties]
+                        << " for value " << difference_properties % (1 + n_compositions) << " of point " << difference_properties / (1 + n_compositions)
+                        << " with the functions for many points, but the serial evaluation gave " << reference_properties[difference_properties] << "." << std::endl;
+              return 1;
+            }
+        }
+
+      std::cout << "Evaluated " << n_points << " points with " << n_threads
+                << " threads concurrently, all results are the same as in serial." << std::endl;
+    }
+  catch (std::exception &e)
+    {
+      std::cout << e.what() << std::endl;
+      return 1;
+    }
+
+  return 0;
+}
@@ -0,0 +1,81 @@
+program test_openmp
+use WorldBuilder
+use omp_lib
+USE, INTRINSIC :: ISO_C_BINDING
+IMPLICIT NONE
+
+  ! Evaluates a line of points through the continental plate with the scalar
+  ! functions, with the array routines, and with both from several OpenMP
+  ! threads at the same time, and checks that all give the same results.
+  INTEGER, PARAMETER :: n_points = 4000, chunk_size = 100
+  INTEGER(C_LONG) :: random_number_seed = 1
+  INTEGER(C_INT) :: composition_numbers(2) = (/ 0, 3 /)
+  REAL(C_DOUBLE) :: x(n_points), y(n_points), z(n_points), depth(n_points), gravity(n_points)
+  REAL(C_DOUBLE) :: temperatures(n_points), compositions(2,n_points)
+  REAL(C_DOUBLE) :: array_temperatures(n_points), array_compositions(2,n_points)
+  REAL(C_DOUBLE) :: thread_temperatures(n_points), thread_compositions(2,n_points)
+  INTEGER :: i, first, last, n_threads
+  character(len=256) :: file_name
+  logical(1) :: has_output_dir = .false.
+  character(len=256) :: output_dir = "../../../doc/manual/"//C_NULL_CHAR
+
+  call getarg(1, file_name)
+  CALL create_world(cworld, trim(file_name)//C_NULL_CHAR, has_output_dir, output_dir, random_number_seed)
+
+  do i = 1, n_points
+    x(i) = 1000e3_C_DOUBLE * (i - 1) / n_points
+    y(i) = 500e3_C_DOUBLE
+    z(i) = 0
+    depth(i) = 300e3_C_DOUBLE * mod(i, 7) / 7
+    gravity(i) = 10
+  end do
+
+  ! The reference values, computed point by point.
+  do i = 1, n_points
+    CALL temperature_3d(cworld, x(i), y(i), z(i), depth(i), gravity(i), temperatures(i))
+    CALL composition_3d(cworld, x(i), y(i), z(i), depth(i), composition_numbers(1), compositions(1,i))
+    CALL composition_3d(cworld, x(i), y(i), z(i), depth(i), composition_numbers(2), compositions(2,i))
+  end do
+
+  CALL properties_3d_array(cworld, x, y, z, depth, gravity, composition_numbers, array_temperatures, array_compositions, &
+                           n_threads=4)
+  write(*, *) 'array routine equal to scalar functions: ', &
+    all(array_temperatures == temperatures) .and. all(array_compositions == compositions)
+
+  ! Every thread evaluates its own chunks of the points with the array routines.
+  CALL omp_set_num_threads(4)
+  n_threads = 0
+  thread_temperatures = 0
+  thread_compositions = 0
+  !$omp parallel do private(first, last) schedule(dynamic)
+  do first = 1, n_points, chunk_size
+    last = min(first + chunk_size - 1, n_points)
+    CALL temperature_3d_array(cworld, x(first:last), y(first:last), z(first:last), depth(first:last), &
+                              gravity(first:last), thread_temperatures(first:last))
+    CALL composition_3d_array(cworld, x(first:last), y(first:last), z(first:last), depth(first:last), &
+                              composition_numbers, thread_compositions(:,first:last))
+    !$omp atomic
+    n_threads = max(n_threads, omp_get_num_threads())
+  end do
+  !$omp end parallel do
+  write(*, *) 'used more than one thread: ', n_threads > 1
+  write(*, *) 'array routines from threads equal to scalar functions: ', &
+    all(thread_temperatures == temperatures) .and. all(thread_compositions == compositions)
+
+  ! Every thread evaluates its own points with the scalar functions.
+  thread_temperatures = 0
+  thread_compositions = 0
+  !$omp parallel do schedule(dynamic, 10)
+  do i = 1, n_points
+    CALL temperature_3d(cworld, x(i), y(i), z(i), depth(i), gravity(i), thread_temperatures(i))
+    CALL composition_3d(cworld, x(i), y(i), z(i), depth(i), composition_numbers(2), thread_compositions(2,i))
+  end do
+  !$omp end parallel do
+  write(*, *) 'scalar functions from threads equal to scalar functions: ', &
+    all(thread_temperatures == temperatures) .and. all(thread_compositions(2,:) == compositions(2,:))
+
+  write(*, '(A,F10.3,F10.3)') ' minimum and maximum temperature: ', minval(temperatures), maxval(temperatures)
+  write(*, *) 'number of points in composition 3: ', count(compositions(2,:) > 0.5)
+
+  CALL release_world(cworld)
+END program
@@ -0,0 +1,80 @@
+from gwb import WorldBuilderWrapper
+
+import array, getopt, sys, threading
+
+def main(argv):
+  filename = ""
+  try:
+     opts, _ = getopt.getopt(argv,"i:",["ifile="])
+  except getopt.GetoptError:
+     print("Failed to get commandline argument.")
+     sys.exit(2)
+  for opt, arg in opts:
+     if opt in ("-i", "--ifile"):
+        filename = arg
+
+  world_builder = WorldBuilderWrapper(filename, False, "", 1);
+
+  # The array functions accept NumPy arrays of float64 values and every other
+  # object with the buffer protocol, so the test also runs without NumPy.
+  try:
+    import numpy
+    def new_array(values):
+      return numpy.array(list(values), dtype=numpy.float64)
+  except ImportError:
+    def new_array(values):
+      return array.array('d', values)
+
+  n_points = 1000
+  composition_numbers = [0, 3]
+  x = new_array(1000e3 * i / n_points for i in range(n_points))
+  y = new_array(500e3 for i in range(n_points))
+  z = new_array(0 for i in range(n_points))
+  depth = new_array(300e3 * (i % 7) / 7 for i in range(n_points))
+  gravity = new_array(10 for i in range(n_points))
+
+  temperatures = [world_builder.temperature_3d(x[i], y[i], z[i], depth[i], gravity[i]) for i in range(n_points)]
+  compositions = [world_builder.composition_3d(x[i], y[i], z[i], depth[i], c) for i in range(n_points) for c in composition_numbers]
+
+  array_temperatures = new_array(0 for i in range(n_points))
+  array_compositions = new_array(0 for i in range(2 * n_points))
+  world_builder.temperature_3d_array(x, y, z, depth, gravity, array_temperatures)
+  world_builder.composition_3d_array(x, y, z, depth, composition_numbers, array_compositions)
+  print ("3d array temperatures equal to scalar temperatures:", list(array_temperatures) == temperatures)
+  print ("3d array compositions equal to scalar compositions:", list(array_compositions) == compositions)
+
+  # The points can also be evaluated with more than one thread.
+  world_builder.temperature_3d_array(x, y, z, depth, gravity, array_temperatures, 4)
+  print ("3d array temperatures with 4 threads equal to scalar temperatures:", list(array_temperatures) == temperatures)
+
+  # The global interpreter lock is released during the evaluation, so several
+  # Python threads can evaluate their own part of the points at the same time.
+  thread_temperatures = new_array(0 for i in range(n_points))
+  def evaluate(first, last):
+    part = new_array(0 for i in range(first, last))
+    world_builder.temperature_3d_array(x[first:last], y[first:last], z[first:last], depth[first:last], gravity[first:last], part)
+    thread_temperatures[first:last] = part
+  threads = [threading.Thread(target=evaluate, args=(first, min(first + 250, n_points))) for first in range(0, n_points, 250)]
+  for thread in threads:
+    thread.start()
+  for thread in threads:
+    thread.join()
+  print ("temperatures from threads equal to scalar temperatures:", list(thread_temperatures) == temperatures)
+
+  try:
+    world_builder.temperature_3d_array(x, y, z, depth, gravity, new_array(0 for i in range(n_points - 1)))
+    print ("output of the wrong size raises a ValueError: False")
+  except ValueError:
+    print ("output of the wrong size raises a ValueError: True")
+
+  # In 2d, the points are given by x and z.
+  temperatures_2d = [world_builder.temperature_2d(x[i], depth[i], depth[i], gravity[i]) for i in range(n_points)]
+  compositions_2d = [world_builder.composition_2d(x[i], depth[i], depth[i], c) for i in range(n_points) for c in composition_numbers]
+  world_builder.temperature_2d_array(x, depth, depth, gravity, array_temperatures)
+  world_builder.composition_2d_array(x, depth, depth, composition_numbers, array_compositions)
+  print ("2d array temperatures equal to scalar temperatures:", list(array_temperatures) == temperatures_2d)
+  print ("2d array compositions equal to scalar compositions:", list(array_compositions) == compositions_2d)
+
+
+if __name__ == "__main__":
+   main(sys.argv[1:])
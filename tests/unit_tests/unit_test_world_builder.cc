@@ -29,6 +29,8 @@
 #include "world_builder/grains.h"
 #include "world_builder/parameters.h"
 #include "world_builder/point.h"
+#include "world_builder/random_number_generator.h"
+#include "world_builder/thread_pool.h"
 #include "world_builder/types/array.h"
 #include "world_builder/types/bool.h"
 #include "world_builder/types/double.h"
@@ -47,9 +49,17 @@ extern "C" {
 }
 #include "world_builder/wrapper_cpp.h"
 
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
@@ -58,6 +68,7 @@ extern "C" {
 #include <random>
 #include <stddef.h>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace WorldBuilder
@@ -321,6 +332,39 @@ TEST_CASE("WorldBuilder Utilities: string to conversions")
   CHECK_THROWS_WITH(Utilities::string_to_unsigned_int("c"),
                     Contains("Could not convert \"c\" to an unsigned int."));
 
+  // Test the locale independent parsing and formatting of doubles
+  const std::string number = "-1.5e3 2";
+  double value = 0;
+  CHECK(Utilities::parse_double(number.data(), number.data() + number.size(), value) == number.data() + 6);
+  CHECK(value == Approx(-1500.0));
+  CHECK(Utilities::parse_double(number.data() + 6, number.data() + number.size(), value) == number.data() + 6);
+  CHECK(Utilities::string_to_double("+2.5") == Approx(2.5));
+  CHECK_THROWS_WITH(Utilities::string_to_double(" "),
+                    Contains("Could not convert \"\" to a double."));
+  CHECK_THROWS_WITH(Utilities::string_to_double("nan"),
+                    Contains("Could not convert \"nan\" to a double."));
+  CHECK_THROWS_WITH(Utilities::string_to_double("-inf"),
+                    Contains("Could not convert \"-inf\" to a double."));
+  CHECK_THROWS_WITH(Utilities::string_to_double("0x1p3"),
+                    Contains("Could not convert \"0x1p3\" to a double."));
+  CHECK_THROWS_WITH(Utilities::string_to_double("1e400"),
+                    Contains("Could not convert \"1e400\" to a double."));
+  CHECK_THROWS_WITH(Utilities::string_to_double("+-1"),
+                    Contains("Could not convert \"+-1\" to a double."));
+  CHECK(Utilities::string_to_double("-.5") == Approx(-0.5));
+
+  char buffer[32];
+  CHECK(std::string(buffer, Utilities::format_double(1600.0043948860364, 6, buffer)) == "1600");
+  CHECK(std::string(buffer, Utilities::format_double(1694870.123, 6, buffer)) == "1.69487e+06");
+  CHECK(std::string(buffer, Utilities::format_double(0.1, 0, buffer)) == "0.1");
+  CHECK(std::string(buffer, Utilities::format_double(1.0/3.0, 0, buffer)) == "0.3333333333333333");
+  const char *end = Utilities::format_double(1600.0043948860364, 0, buffer);
+  CHECK(Utilities::parse_double(buffer, end, value) == end);
+  CHECK(value == Approx(1600.0043948860364).epsilon(0));
+
+  CHECK(Utilities::split_data_line("  1, 2.5,3  -4\t5 ") == std::vector<std::string> {"1", "2.5", "3", "-4", "5"});
+  CHECK(Utilities::split_data_line(" ").empty());
+
   // Test point to array conversion
   const Point<2> p2(1,2,cartesian);
   const Point<3> p3(1,2,3,cartesian);
@@ -695,6 +739,70 @@ TEST_CASE("WorldBuilder Utilities: cross product")
   compare_3d_arrays_approx(Utilities::cross_product(point2, point1).get_array(), std::array<double,3> {{3,-6,3}});
 }
 
+TEST_CASE("WorldBuilder Utilities: read and distribute file")
+{
+  const std::string file_name = WorldBuilder::Data::WORLD_BUILDER_SOURCE_DIR + "/tests/data/invalid_1.wb";
+  std::ifstream file_stream(file_name);
+  const std::string expected_content((std::istreambuf_iterator<char>(file_stream)),
+                                     std::istreambuf_iterator<char>());
+
+  CHECK(Utilities::read_and_distribute_file(file_name) == expected_content);
+  CHECK(!expected_content.empty());
+
+  CHECK_THROWS_WITH(Utilities::read_and_distribute_file(file_name + ".does_not_exist"),
+                    Contains("Could not find or read the file at the specified location"));
+}
+
+TEST_CASE("WorldBuilder ThreadPool")
+{
+  for (size_t n_threads = 1; n_threads < 6; ++n_threads)
+    {
+      ThreadPool pool(n_threads);
+      CHECK(pool.n_threads() == n_threads);
+
+      // the pool is reused for loops of different sizes and chunk sizes.
+      for (size_t n = 0; n < 1000; n = n * 3 + 1)
+        for (size_t chunk_size = 0; chunk_size < 4; ++chunk_size)
+          {
+            std::vector<unsigned int> counts(n + 10, 0);
+            pool.parallel_for(5, n + 5, [&](size_t i)
+            {
+              // make the cost of the indices very non-uniform
+              if (i % 97 == 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+              counts[i]++;
+            }, chunk_size);
+
+            for (size_t i = 0; i < counts.size(); ++i)
+              CHECK(counts[i] == (i >= 5 && i < n + 5 ? 1 : 0));
+          }
+
+      CHECK_THROWS_WITH(pool.parallel_for(0, 1000, [&](size_t i)
+      {
+        if (i == 500)
+          throw std::runtime_error("error in parallel for");
+      }),
+      Contains("error in parallel for"));
+
+      // the pool still works after an exception.
+      std::atomic<size_t> sum(0);
+      pool.parallel_for(0, 100, [&](size_t i)
+      {
+        sum += i;
+      });
+      CHECK(sum == 4950);
+    }
+
+  CHECK(ThreadPool(0).n_threads() >= 1);
+
+  // the shared pools are created once for every number of threads.
+  ThreadPool &shared_pool = ThreadPool::get_shared_pool(3);
+  CHECK(shared_pool.n_threads() == 3);
+  CHECK(&ThreadPool::get_shared_pool(3) == &shared_pool);
+  CHECK(&ThreadPool::get_shared_pool(2) != &shared_pool);
+  CHECK(&ThreadPool::get_shared_pool(0) == &ThreadPool::get_shared_pool(ThreadPool(0).n_threads()));
+}
+
 TEST_CASE("WorldBuilder C wrapper")
 {
   // First test a world builder file with a cross section defined
@@ -729,6 +837,56 @@ TEST_CASE("WorldBuilder C wrapper")
   composition_3d(*ptr_ptr_world, 120e3, 500e3, 0, 0, 3, &composition);
   CHECK(composition == Approx(1.0));
 
+  // Test the batch functions with several threads, alternating between the
+  // two points above, and compare them to the batch functions with one thread.
+  const size_t n_points = 2000;
+  std::vector<double> x(n_points), y(n_points), z(n_points), depth(n_points, 0), gravity(n_points, 10);
+  for (size_t i = 0; i < n_points; ++i)
+    {
+      x[i] = i % 2 == 0 ? 1 : 120e3;
+      y[i] = i % 2 == 0 ? 2 : 500e3;
+      z[i] = i % 2 == 0 ? 3 : 0;
+    }
+  const unsigned int composition_numbers[2] = {2, 3};
+  std::vector<double> temperatures(n_points), compositions(2 * n_points);
+
+  temperature_3d_batch(*ptr_ptr_world, n_points, x.data(), y.data(), z.data(), depth.data(), gravity.data(), temperatures.data(), 4);
+  composition_3d_batch(*ptr_ptr_world, n_points, x.data(), y.data(), z.data(), depth.data(), 2, composition_numbers, compositions.data(), 4);
+  for (size_t i = 0; i < n_points; ++i)
+    {
+      CHECK(temperatures[i] == Approx(i % 2 == 0 ? 1600 : 150));
+      CHECK(compositions[2 * i] == Approx(0.0));
+      CHECK(compositions[2 * i + 1] == Approx(i % 2 == 0 ? 0.0 : 1.0));
+    }
+
+  std::vector<double> all_temperatures(n_points), all_compositions(2 * n_points);
+  properties_3d_batch(*ptr_ptr_world, n_points, x.data(), y.data(), z.data(), depth.data(), gravity.data(), 2, composition_numbers,
+                      all_temperatures.data(), all_compositions.data(), 1);
+  CHECK(all_temperatures == temperatures);
+  CHECK(all_compositions == compositions);
+
+  // In 2d, the second point is at x = 550e3.
+  for (size_t i = 0; i < n_points; ++i)
+    {
+      x[i] = i % 2 == 0 ? 1 : 550e3;
+      z[i] = i % 2 == 0 ? 2 : 0;
+    }
+  temperature_2d_batch(*ptr_ptr_world, n_points, x.data(), z.data(), depth.data(), gravity.data(), temperatures.data(), 4);
+  composition_2d_batch(*ptr_ptr_world, n_points, x.data(), z.data(), depth.data(), 2, composition_numbers, compositions.data(), 4);
+  for (size_t i = 0; i < n_points; ++i)
+    {
+      CHECK(temperatures[i] == Approx(i % 2 == 0 ? 1600 : 150));
+      CHECK(compositions[2 * i + 1] == Approx(i % 2 == 0 ? 0.0 : 1.0));
+    }
+  properties_2d_batch(*ptr_ptr_world, n_points, x.data(), z.data(), depth.data(), gravity.data(), 2, composition_numbers,
+                      all_temperatures.data(), nullptr, 1);
+  CHECK(all_temperatures == temperatures);
+
+  // The sizes of the arrays of the Fortran array routines are checked by the C wrapper.
+  check_array_size("temperature_2d_array", "z", n_points, "x", n_points);
+  CHECK_THROWS_WITH(check_array_size("temperature_2d_array", "z", n_points - 1, "x", n_points),
+                    Contains("Error in temperature_2d_array: The size of z is 1999, but it has to be the size of x, which is 2000."));
+
   release_world(*ptr_ptr_world);
 
   // Now test a world builder file without a cross section defined
@@ -759,6 +917,10 @@ TEST_CASE("WorldBuilder C wrapper")
   composition_3d(*ptr_ptr_world, 120e3, 500e3, 0, 0, 3, &composition);
   CHECK(composition == Approx(1.0));
 
+  CHECK_THROWS_WITH(temperature_2d_batch(*ptr_ptr_world, n_points, x.data(), z.data(), depth.data(), gravity.data(), temperatures.data(), 1),
+                    Contains("This function can only be called when the cross section "
+                             "variable in the world builder file has been set. Dim is 3."));
+
   release_world(*ptr_ptr_world);
 }
 
@@ -792,6 +954,25 @@ TEST_CASE("WorldBuilder CPP wrapper")
   composition = world.composition_3d(120e3, 500e3, 0, 0, 3);
   CHECK(composition == Approx(1.0));
 
+  // Test the batch functions
+  const double x[2] = {1, 120e3}, y[2] = {2, 500e3}, z[2] = {3, 0}, depth[2] = {0, 0}, gravity[2] = {10, 10};
+  const unsigned int composition_numbers[2] = {2, 3};
+  double temperatures[2] = {0, 0}, compositions[4] = {0, 0, 0, 0};
+  world.temperature_3d_batch(2, x, y, z, depth, gravity, temperatures, 2);
+  CHECK(temperatures[0] == Approx(1600));
+  CHECK(temperatures[1] == Approx(150));
+  world.composition_3d_batch(2, x, y, z, depth, 2, composition_numbers, compositions);
+  CHECK(compositions[1] == Approx(0.0));
+  CHECK(compositions[3] == Approx(1.0));
+
+  const double x_2d[2] = {1, 550e3}, z_2d[2] = {2, 0};
+  world.temperature_2d_batch(2, x_2d, z_2d, depth, gravity, temperatures);
+  CHECK(temperatures[0] == Approx(1600));
+  CHECK(temperatures[1] == Approx(150));
+  world.composition_2d_batch(2, x_2d, z_2d, depth, 2, composition_numbers, compositions);
+  CHECK(compositions[1] == Approx(0.0));
+  CHECK(compositions[3] == Approx(1.0));
+
 
   // Now test a world builder file without a cross section defined
   file = WorldBuilder::Data::WORLD_BUILDER_SOURCE_DIR + "/tests/data/simple_wb2.json";
@@ -823,11 +1004,9 @@ TEST_CASE("WorldBuilder World random")
 {
   // The world builder uses a deterministic random number generator. This is on prorpose
   // because even though you might want to use random numbers, the result should be
-  // reproducable. Note that when the world builder is used in for example MPI programs
-  // you should supply the world builder created each MPI process a different seed. You
-  // can use the MPI RANK for this (seed is seed + MPI_RANK). Because the generator is
-  // deterministic (known and documented algorithm), we can test the results and they
-  // should be the same even for different compilers and machines.
+  // reproducable. Because the generator is deterministic (known and documented
+  // algorithm), we can test the results and they should be the same even for different
+  // compilers and machines.
   std::string file_name = WorldBuilder::Data::WORLD_BUILDER_SOURCE_DIR + "/tests/data/oceanic_plate_spherical.wb";
   WorldBuilder::World world1(file_name, false, "", 1);
   // same result as https://en.cppreference.com/w/cpp/numeric/random/mersenne_twister_engine/seed
@@ -852,6 +1031,303 @@ TEST_CASE("WorldBuilder World random")
   CHECK(dist(world3.get_random_number_engine()) == Approx(1.1281244478));
 }
 
+TEST_CASE("WorldBuilder counter-based random number generator")
+{
+  // known answers of the reference implementation of Philox4x32-10 (Random123)
+  {
+    const std::array<std::uint32_t,4> result = CounterBasedRandomNumberGenerator::philox({{0,0,0,0}}, {{0,0}});
+    CHECK(result[0] == 0x6627e8d5);
+    CHECK(result[1] == 0xe169c58d);
+    CHECK(result[2] == 0xbc57ac4c);
+    CHECK(result[3] == 0x9b00dbd8);
+  }
+  {
+    const std::array<std::uint32_t,4> result = CounterBasedRandomNumberGenerator::philox({{0xffffffff,0xffffffff,0xffffffff,0xffffffff}},
+                                               {{0xffffffff,0xffffffff}});
+    CHECK(result[0] == 0x408f276d);
+    CHECK(result[1] == 0x41c83b0e);
+    CHECK(result[2] == 0xa20bc7c6);
+    CHECK(result[3] == 0x6d5451fd);
+  }
+  {
+    const std::array<std::uint32_t,4> result = CounterBasedRandomNumberGenerator::philox({{0x243f6a88,0x85a308d3,0x13198a2e,0x03707344}},
+                                               {{0xa4093822,0x299f31d0}});
+    CHECK(result[0] == 0xd16cfe09);
+    CHECK(result[1] == 0x94fdcceb);
+    CHECK(result[2] == 0x5001e420);
+    CHECK(result[3] == 0x24126ea1);
+  }
+
+  // The generator returns the blocks of the counter one after another.
+  {
+    CounterBasedRandomNumberGenerator generator(0, 0);
+    const std::array<std::uint32_t,4> block_0 = CounterBasedRandomNumberGenerator::philox({{0,0,0,0}}, {{0,0}});
+    const std::array<std::uint32_t,4> block_1 = CounterBasedRandomNumberGenerator::philox({{0,0,1,0}}, {{0,0}});
+    for (unsigned int i = 0; i < 4; ++i)
+      CHECK(generator() == block_0[i]);
+    for (unsigned int i = 0; i < 4; ++i)
+      CHECK(generator() == block_1[i]);
+  }
+
+  // The same key and stream give the same numbers, a different key or stream other numbers.
+  {
+    CounterBasedRandomNumberGenerator generator_1(1, 2);
+    CounterBasedRandomNumberGenerator generator_2(1, 2);
+    CounterBasedRandomNumberGenerator generator_3(2, 2);
+    CounterBasedRandomNumberGenerator generator_4(1, 3);
+    for (unsigned int i = 0; i < 100; ++i)
+      {
+        const double value = generator_1.uniform_real();
+        CHECK(value >= 0.0);
+        CHECK(value < 1.0);
+        CHECK(generator_2.uniform_real() == Approx(value));
+        CHECK(std::fabs(generator_3.uniform_real() - value) > 0.0);
+        CHECK(std::fabs(generator_4.uniform_real() - value) > 0.0);
+      }
+  }
+
+  CHECK(CounterBasedRandomNumberGenerator::hash_combine(1, 0.0) == CounterBasedRandomNumberGenerator::hash_combine(1, -0.0));
+  CHECK(CounterBasedRandomNumberGenerator::hash_combine(1, 1.0) != CounterBasedRandomNumberGenerator::hash_combine(2, 1.0));
+  CHECK(CounterBasedRandomNumberGenerator::hash("") == 0xcbf29ce484222325);
+  CHECK(CounterBasedRandomNumberGenerator::hash("a") == 0xaf63dc4c8601ec8c);
+
+  // The random grains only depend on the seed and the point, not on the
+  // order in which the points are evaluated or on the number of threads.
+  std::string file_name = WorldBuilder::Data::WORLD_BUILDER_SOURCE_DIR + "/tests/data/continental_plate.wb";
+  WorldBuilder::World world1(file_name);
+  const std::array<double,3> position = {{750e3,250e3,0}};
+  const WorldBuilder::grains grains_1 = world1.grains(position, 0, 1, 2);
+  world1.grains(std::array<double,3> {{750e3,260e3,0}}, 0, 1, 2);
+  const WorldBuilder::grains grains_2 = world1.grains(position, 0, 1, 2);
+  compare_vectors_approx(grains_2.sizes, grains_1.sizes);
+  compare_vectors_array3_array3_approx(grains_2.rotation_matrices, grains_1.rotation_matrices);
+
+  WorldBuilder::World world2(file_name);
+  const WorldBuilder::grains grains_3 = world2.grains(position, 0, 1, 2);
+  compare_vectors_approx(grains_3.sizes, grains_1.sizes);
+  compare_vectors_array3_array3_approx(grains_3.rotation_matrices, grains_1.rotation_matrices);
+
+  // a different seed gives different grains
+  WorldBuilder::World world3(file_name, false, "", 2);
+  const WorldBuilder::grains grains_4 = world3.grains(position, 0, 1, 2);
+  CHECK(std::fabs(grains_4.sizes[0] - grains_1.sizes[0]) > 0.0);
+
+  const size_t n_points = 1000;
+  std::vector<double> serial_sizes(n_points * 2);
+  std::vector<double> parallel_sizes(n_points * 2);
+  for (size_t i = 0; i < n_points; ++i)
+    {
+      const WorldBuilder::grains grains = world1.grains(std::array<double,3> {{750e3 + static_cast<double>(i), 250e3, 0}}, 0, 1, 2);
+      std::copy(grains.sizes.begin(), grains.sizes.end(), serial_sizes.begin() + static_cast<std::ptrdiff_t>(i * 2));
+    }
+  ThreadPool pool(4);
+  pool.parallel_for(0, n_points, [&](size_t i)
+  {
+    world1.grains(std::array<double,3> {{750e3 + static_cast<double>(n_points - 1 - i), 250e3, 0}}, 0, 1, 2,
+                  &parallel_sizes[(n_points - 1 - i) * 2], std::vector<std::array<std::array<double,3>,3> >(2).data());
+  });
+  compare_vectors_approx(parallel_sizes, serial_sizes);
+}
+
+TEST_CASE("WorldBuilder World shared declarations")
+{
+  // The declarations are only build by the first world and shared with all
+  // the worlds created after it, so every world should end up with the same
+  // declarations, independent of the file it loaded.
+  std::string file_name_1 = WorldBuilder::Data::WORLD_BUILDER_SOURCE_DIR + "/tests/data/oceanic_plate_spherical.wb";
+  std::string file_name_2 = WorldBuilder::Data::WORLD_BUILDER_SOURCE_DIR + "/tests/data/subducting_plate_different_angles_cartesian.wb";
+  WorldBuilder::World world1(file_name_1);
+  WorldBuilder::World world2(file_name_2);
+  WorldBuilder::World world3(file_name_1);
+
+  // Some default values are nan, so compare the written out declarations.
+  auto declarations_to_string = [](const rapidjson::Document &declarations) -> std::string
+  {
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer, rapidjson::UTF8<>, rapidjson::UTF8<>, rapidjson::CrtAllocator, rapidjson::kWriteNanAndInfFlag> writer(buffer);
+    declarations.Accept(writer);
+    return buffer.GetString();
+  };
+
+  CHECK(world1.parameters.declarations.IsObject());
+  CHECK(declarations_to_string(world1.parameters.declarations) == declarations_to_string(world2.parameters.declarations));
+  CHECK(declarations_to_string(world1.parameters.declarations) == declarations_to_string(world3.parameters.declarations));
+
+  // The validation against the shared schema should still catch invalid files.
+  std::string file_name_invalid = WorldBuilder::Data::WORLD_BUILDER_SOURCE_DIR + "/tests/data/invalid_1.wb";
+  CHECK_THROWS_WITH(WorldBuilder::World(file_name_invalid), Contains("Invalid keyword: additionalProperties"));
+
+  // Changing the declarations of one world should not change the others.
+  world2.parameters.enter_subsection("properties");
+  {
+    world2.parameters.declare_entry("only in world 2", Types::Double(1), "An entry only declared in world 2.");
+  }
+  world2.parameters.leave_subsection();
+  CHECK(declarations_to_string(world1.parameters.declarations) != declarations_to_string(world2.parameters.declarations));
+  CHECK(declarations_to_string(world1.parameters.declarations) == declarations_to_string(world3.parameters.declarations));
+
+  std::array<double,3> position = {{120e3,500e3,0}};
+  CHECK(world1.temperature(position, 10e3, 10) == Approx(world3.temperature(position, 10e3, 10)));
+}
+
+TEST_CASE("WorldBuilder World threads")
+{
+  // The features can be prepared by several threads, which should not
+  // change the results.
+  std::string file_name = WorldBuilder::Data::WORLD_BUILDER_SOURCE_DIR + "/tests/data/subducting_plate_different_angles_cartesian.wb";
+  WorldBuilder::World world_serial(file_name);
+  WorldBuilder::World world_threads(file_name, false, "", 1, Utilities::no_mpi_communicator, 4);
+
+  for (double x = 0; x <= 2000e3; x += 250e3)
+    for (double depth = 0; depth <= 300e3; depth += 50e3)
+      {
+        const std::array<double,3> position = {{x,500e3,800e3 - depth}};
+        CHECK(world_serial.temperature(position, depth, 10) == Approx(world_threads.temperature(position, depth, 10)));
+        CHECK(world_serial.composition(position, depth, 0) == Approx(world_threads.composition(position, depth, 0)));
+      }
+}
+
+TEST_CASE("WorldBuilder World properties")
+{
+  // properties() computes the temperature and the compositions in one loop
+  // over the features, which should give the same results as temperature()
+  // and composition(), also at the surface when the surface temperature is
+  // forced.
+  for (const std::string file : {"subducting_plate_different_angles_cartesian.wb", "fault_constant_angles_cartesian_force_temp.wb"})
+    {
+      WorldBuilder::World world(WorldBuilder::Data::WORLD_BUILDER_SOURCE_DIR + "/tests/data/" + file);
+
+      std::vector<double> x, y, z, depth, gravity;
+      for (double x_position = 0; x_position <= 2000e3; x_position += 100e3)
+        for (double depth_position = 0; depth_position <= 300e3; depth_position += 25e3)
+          {
+            x.push_back(x_position);
+            y.push_back(500e3);
+            z.push_back(800e3 - depth_position);
+            depth.push_back(depth_position);
+            gravity.push_back(10);
+          }
+      const unsigned int composition_numbers[3] = {0, 1, 3};
+      std::vector<double> temperatures(x.size()), compositions(3 * x.size());
+      world.properties(x.size(), x.data(), y.data(), z.data(), depth.data(), gravity.data(),
+                       3, composition_numbers, temperatures.data(), compositions.data());
+
+      for (size_t i = 0; i < x.size(); ++i)
+        {
+          const std::array<double,3> position = {{x[i],y[i],z[i]}};
+          CHECK(temperatures[i] == Approx(world.temperature(position, depth[i], gravity[i])));
+          for (size_t c = 0; c < 3; ++c)
+            CHECK(compositions[3 * i + c] == Approx(world.composition(position, depth[i], composition_numbers[c])));
+        }
+    }
+}
+
+TEST_CASE("WorldBuilder World reload")
+{
+  std::string file_name = WorldBuilder::Data::WORLD_BUILDER_SOURCE_DIR + "/tests/data/continental_plate.wb";
+  std::ifstream file_stream(file_name);
+  const std::string original_content((std::istreambuf_iterator<char>(file_stream)),
+                                     std::istreambuf_iterator<char>());
+
+  auto write_file = [](const std::string &name, const std::string &content)
+  {
+    std::ofstream file(name);
+    file << content;
+  };
+
+  // Write the changing world builder file to the temporary directory and
+  // remove it again at the end of the test, also when a check throws.
+  const char *temporary_directory = std::getenv("TMPDIR");
+  if (temporary_directory == nullptr)
+    temporary_directory = std::getenv("TEMP");
+  const std::string reload_file_name = std::string(temporary_directory != nullptr ? temporary_directory : "/tmp")
+                                       + "/world_reload_test_" + std::to_string(std::random_device()()) + ".wb";
+  struct RemoveFile
+  {
+    ~RemoveFile()
+    {
+      std::remove(name.c_str());
+    }
+    const std::string &name;
+  } remove_file {reload_file_name};
+  write_file(reload_file_name, original_content);
+  WorldBuilder::World world(reload_file_name);
+
+  const std::array<double,3> position = {{250e3,750e3,0}};
+  CHECK(world.temperature(position, 10e3, 10) == Approx(150));
+
+  // reloading the same file does not parse any feature again.
+  CHECK(world.reload(reload_file_name) == 0);
+  CHECK(world.temperature(position, 10e3, 10) == Approx(150));
+
+  // only change the first feature
+  std::string changed_content = original_content;
+  const std::string first_temperature = "\"max depth\":75e3, \"temperature\":150";
+  changed_content.replace(changed_content.find(first_temperature), first_temperature.size(),
+                          "\"max depth\":75e3, \"temperature\":175");
+  write_file(reload_file_name, changed_content);
+  CHECK(world.reload(reload_file_name) == 1);
+  CHECK(world.temperature(position, 10e3, 10) == Approx(175));
+
+  WorldBuilder::World world_from_scratch(reload_file_name);
+  for (double depth = 0; depth < 300e3; depth += 20e3)
+    {
+      CHECK(world.temperature(position, depth, 10) == Approx(world_from_scratch.temperature(position, depth, 10)));
+      for (unsigned int composition = 0; composition < 7; ++composition)
+        CHECK(world.composition(position, depth, composition) == Approx(world_from_scratch.composition(position, depth, composition)));
+    }
+
+  // changing a global value parses all features again.
+  const std::string version = "\"version\":\"0.5\",";
+  changed_content.replace(changed_content.find(version), version.size(),
+                          version + " \"surface temperature\":300,");
+  write_file(reload_file_name, changed_content);
+  CHECK(world.reload(reload_file_name) == world.parameters.features.size());
+  CHECK(world.surface_temperature == Approx(300));
+  CHECK(world.temperature(position, 10e3, 10) == Approx(175));
+
+  // an invalid file does not change the world.
+  write_file(reload_file_name, "{\"test\":1}");
+  CHECK_THROWS_WITH(world.reload(reload_file_name), Contains("Invalid keyword: additionalProperties"));
+  CHECK(world.temperature(position, 10e3, 10) == Approx(175));
+
+  // a feature which fails to parse leaves the world unchanged, both when
+  // only features have changed and when everything is parsed again.
+  write_file(reload_file_name, changed_content);
+  CHECK(world.reload(reload_file_name) == 0);
+  std::string invalid_feature_content = changed_content;
+  const std::string second_composition = "\"composition models\":[{\"model\":\"uniform\", \"compositions\":[2]}]";
+  invalid_feature_content.replace(invalid_feature_content.find(second_composition), second_composition.size(),
+                                  "\"composition models\":[{\"model\":\"uniform\", \"compositions\":[2], \"fractions\":[0.5,0.5]}]");
+  invalid_feature_content.replace(invalid_feature_content.find("\"temperature\":175"), std::string("\"temperature\":175").size(),
+                                  "\"temperature\":200");
+  write_file(reload_file_name, invalid_feature_content);
+  CHECK_THROWS_WITH(world.reload(reload_file_name), Contains("There are not the same amount of compositions and fractions."));
+  CHECK(world.parameters.path.empty());
+  CHECK(world.parameters.features.size() == world_from_scratch.parameters.features.size());
+  CHECK(world.temperature(position, 10e3, 10) == Approx(175));
+
+  const std::string surface_temperature = "\"surface temperature\":300,";
+  invalid_feature_content.replace(invalid_feature_content.find(surface_temperature), surface_temperature.size(),
+                                  "\"surface temperature\":310,");
+  write_file(reload_file_name, invalid_feature_content);
+  CHECK_THROWS_WITH(world.reload(reload_file_name), Contains("There are not the same amount of compositions and fractions."));
+  CHECK(world.parameters.path.empty());
+  CHECK(world.surface_temperature == Approx(300));
+  CHECK(world.temperature(position, 10e3, 10) == Approx(175));
+  for (double depth = 0; depth < 300e3; depth += 20e3)
+    for (unsigned int composition = 0; composition < 7; ++composition)
+      CHECK(world.composition(position, depth, composition) == Approx(world_from_scratch.composition(position, depth, composition)));
+
+  // the next reload is compared against the last valid file, so after
+  // restoring it nothing is parsed again.
+  write_file(reload_file_name, changed_content);
+  CHECK(world.reload(reload_file_name) == 0);
+
+  CHECK(world.reload(WorldBuilder::Data::WORLD_BUILDER_SOURCE_DIR + "/tests/data/continental_plate.wb") == world.parameters.features.size());
+  CHECK(world.temperature(position, 10e3, 10) == Approx(150));
+}
+
 TEST_CASE("WorldBuilder Coordinate Systems: Interface")
 {
   std::string file_name = WorldBuilder::Data::WORLD_BUILDER_SOURCE_DIR + "/tests/data/oceanic_plate_spherical.wb";
@@ -1132,28 +1608,28 @@ TEST_CASE("WorldBuilder Features: Continental Plate")
     WorldBuilder::grains grains = world1.grains(position, 0, 0, 2);
     compare_vectors_approx(grains.sizes, {0.5,0.5}); // was 0.2, but is normalized
     // these are random numbers, but they should stay the same.
-    std::array<std::array<double, 3>, 3> array_1 = {{{{-0.9582241838,-0.07911030008,-0.2748599171}},{{-0.1099528091,-0.7852541367,0.6093326847}},{{-0.2640393784,0.6140989344,0.7437511045}}}};
-    std::array<std::array<double, 3>, 3> array_2 = {{{{-0.2124629855,0.07025627985,0.9746402079}},{{0.06298075396,-0.9943536315,0.08540655858}},{{0.9751373772,0.07952930755,0.2068385477}}}};
+    std::array<std::array<double, 3>, 3> array_1 = {{{{0.3325374589,-0.2732923469,-0.9026240256}},{{-0.7118363341,-0.7005534595,-0.05013864613}},{{-0.6186338755,0.6591935554,-0.4274996897}}}};
+    std::array<std::array<double, 3>, 3> array_2 = {{{{0.8254856388,-0.5546108047,-0.1047870003}},{{0.5141262329,0.6622424475,0.5450772031}},{{-0.2329113067,-0.5038271489,0.8318115936}}}};
     std::vector<std::array<std::array<double, 3>, 3> > vector_1 = {array_1,array_2};
 
     compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_1);
     grains = world1.grains(position, 0, 1, 2);
-    std::array<std::array<double, 3>, 3> array_3 = {{{{-0.8434546455,-0.3219802991,-0.4300150555}},{{-0.23850553,0.9417033479,-0.2372971063}},{{0.4813516106,-0.09758837799,-0.8710781454}}}};
-    std::array<std::array<double, 3>, 3> array_4 = {{{{-0.3695282689,-0.1240881435,0.9208968407}},{{-0.9061330384,-0.1714186601,-0.3867021588}},{{0.2058440555,-0.9773524316,-0.04909632573}}}};
+    std::array<std::array<double, 3>, 3> array_3 = {{{{-0.481917773,-0.7850853816,-0.3890966509}},{{-0.817314987,0.5628336777,-0.1233469222}},{{0.3158345645,0.2585714501,-0.912901601}}}};
+    std::array<std::array<double, 3>, 3> array_4 = {{{{-0.4974380925,0.2749382493,-0.8227784047}},{{-0.8669123971,-0.1226598306,0.4831329649}},{{0.03190987183,0.9536055395,0.2993630489}}}};
     std::vector<std::array<std::array<double, 3>, 3> > vector_2 = {array_3,array_4};
 
-    compare_vectors_approx(grains.sizes, {0.4434528938,0.2295772202});
+    compare_vectors_approx(grains.sizes, {0.524759662,0.6989708816});
     compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_2);
   }
 
   // check grains layer 2
   {
     WorldBuilder::grains grains = world1.grains(position, 150e3, 0, 2);
-    compare_vectors_approx(grains.sizes, {0.471427737,0.528572263});
+    compare_vectors_approx(grains.sizes, {0.8025867662,0.1974132338});
     CHECK(grains.sizes[0] + grains.sizes[1] == Approx(1.0));
     // these are random numbers, but they should stay the same.
-    std::array<std::array<double, 3>, 3> array_1 = {{{{0.6535959261,0.5566812833,-0.5127556087}},{{0.3237701162,0.4067148135,0.8542575562}},{{0.6840944944,-0.7243542016,0.08559038145}}}};
-    std::array<std::array<double, 3>, 3> array_2 = {{{{0.937444582,0.1583937415,-0.3100146421}},{{0.3453462197,-0.5355813035,0.7706417169}},{{-0.04397322126,-0.8294962869,-0.5567784711}}}};
+    std::array<std::array<double, 3>, 3> array_1 = {{{{-0.07153378719,0.7294810024,-0.6802502367}},{{0.9049258607,0.3343065884,0.263340638}},{{0.4195141285,-0.5967382777,-0.6840404403}}}};
+    std::array<std::array<double, 3>, 3> array_2 = {{{{0.173342445,0.0307815036,0.9843804629}},{{0.9835714101,-0.05655550753,-0.17143149}},{{0.05039521766,0.9979248336,-0.04007927685}}}};
     std::vector<std::array<std::array<double, 3>, 3> > vector_1 = {array_1,array_2};
     compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_1);
 
@@ -1383,28 +1859,28 @@ TEST_CASE("WorldBuilder Features: Mantle layer")
     WorldBuilder::grains grains = world1.grains(position, 0+300e3, 0, 2);
     compare_vectors_approx(grains.sizes, {0.5,0.5}); // was 0.2, but is normalized
     // these are random numbers, but they should stay the same.
-    std::array<std::array<double, 3>, 3> array_1 = {{{{-0.9582241838,-0.07911030008,-0.2748599171}},{{-0.1099528091,-0.7852541367,0.6093326847}},{{-0.2640393784,0.6140989344,0.7437511045}}}};
-    std::array<std::array<double, 3>, 3> array_2 = {{{{-0.2124629855,0.07025627985,0.9746402079}},{{0.06298075396,-0.9943536315,0.08540655858}},{{0.9751373772,0.07952930755,0.2068385477}}}};
+    std::array<std::array<double, 3>, 3> array_1 = {{{{-0.8146403001,-0.2649718584,-0.5158983386}},{{0.3373433397,0.5070861215,-0.7931350052}},{{0.4717633439,-0.8201546072,-0.3237062986}}}};
+    std::array<std::array<double, 3>, 3> array_2 = {{{{0.4346249827,0.321394107,-0.8413126365}},{{0.2557346655,-0.939746491,-0.226883921}},{{-0.8635397531,-0.1165433855,-0.4906289169}}}};
     std::vector<std::array<std::array<double, 3>, 3> > vector_1 = {array_1,array_2};
     compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_1);
 
     grains = world1.grains(position, 0+300e3, 1, 2);
-    std::array<std::array<double, 3>, 3> array_3 = {{{{-0.8434546455,-0.3219802991,-0.4300150555}},{{-0.23850553,0.9417033479,-0.2372971063}},{{0.4813516106,-0.09758837799,-0.8710781454}}}};
-    std::array<std::array<double, 3>, 3> array_4 = {{{{-0.3695282689,-0.1240881435,0.9208968407}},{{-0.9061330384,-0.1714186601,-0.3867021588}},{{0.2058440555,-0.9773524316,-0.04909632573}}}};
+    std::array<std::array<double, 3>, 3> array_3 = {{{{-0.2519619848,-0.9072882554,0.3366647886}},{{-0.4809671546,0.4192836808,0.7699816824}},{{-0.8397533891,0.03208140755,-0.542019399}}}};
+    std::array<std::array<double, 3>, 3> array_4 = {{{{-0.6119114276,0.03011023188,0.7903529456}},{{-0.5865106756,0.6531377271,-0.4789742549}},{{-0.5306313524,-0.7566402602,-0.3820024666}}}};
     std::vector<std::array<std::array<double, 3>, 3> > vector_2 = {array_3,array_4};
 
-    compare_vectors_approx(grains.sizes, {0.4434528938,0.2295772202});
+    compare_vectors_approx(grains.sizes, {0.1056462932,0.5309003786});
     compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_2);
   }
 
   // check grains layer 2
   {
     WorldBuilder::grains grains = world1.grains(position, 150e3+300e3, 0, 2);
-    compare_vectors_approx(grains.sizes, {0.471427737,0.528572263});
+    compare_vectors_approx(grains.sizes, {0.2458971336,0.7541028664});
     CHECK(grains.sizes[0] + grains.sizes[1] == Approx(1.0));
     // these are random numbers, but they should stay the same.
-    std::array<std::array<double, 3>, 3> array_1 = {{{{0.6535959261,0.5566812833,-0.5127556087}},{{0.3237701162,0.4067148135,0.8542575562}},{{0.6840944944,-0.7243542016,0.08559038145}}}};
-    std::array<std::array<double, 3>, 3> array_2 = {{{{0.937444582,0.1583937415,-0.3100146421}},{{0.3453462197,-0.5355813035,0.7706417169}},{{-0.04397322126,-0.8294962869,-0.5567784711}}}};
+    std::array<std::array<double, 3>, 3> array_1 = {{{{0.2443814326,-0.9496309857,-0.1961599}},{{0.3565688196,-0.1001147549,0.9288895051}},{{-0.9017407567,-0.296947852,0.3141426124}}}};
+    std::array<std::array<double, 3>, 3> array_2 = {{{{-0.8753853614,0.4288837807,-0.2230676395}},{{0.02175096389,0.4959065237,0.8681034589}},{{0.4829361911,0.7550731239,-0.4434379471}}}};
     std::vector<std::array<std::array<double, 3>, 3> > vector_1 = {array_1,array_2};
     compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_1);
 
@@ -1817,28 +2293,28 @@ TEST_CASE("WorldBuilder Features: Oceanic Plate")
     WorldBuilder::grains grains = world2.grains(position, 0, 0, 2);
     compare_vectors_approx(grains.sizes, {0.5,0.5}); // was 0.2, but is normalized
     // these are random numbers, but they should stay the same.
-    std::array<std::array<double, 3>, 3> array_1 = {{{{-0.9582241838,-0.07911030008,-0.2748599171}},{{-0.1099528091,-0.7852541367,0.6093326847}},{{-0.2640393784,0.6140989344,0.7437511045}}}};
-    std::array<std::array<double, 3>, 3> array_2 = {{{{-0.2124629855,0.07025627985,0.9746402079}},{{0.06298075396,-0.9943536315,0.08540655858}},{{0.9751373772,0.07952930755,0.2068385477}}}};
+    std::array<std::array<double, 3>, 3> array_1 = {{{{0.7360419113,-0.6381467125,-0.2258563217}},{{-0.2266914507,-0.5467416755,0.8060301027}},{{-0.637850524,-0.5420722401,-0.5470871919}}}};
+    std::array<std::array<double, 3>, 3> array_2 = {{{{-0.3388383187,0.9383396232,-0.06861009585}},{{0.0785244573,-0.04446479243,-0.995920073}},{{-0.9375619997,-0.3428434537,-0.05861623417}}}};
     std::vector<std::array<std::array<double, 3>, 3> > vector_1 = {array_1,array_2};
 
     compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_1);
     grains = world2.grains(position, 0, 1, 2);
-    std::array<std::array<double, 3>, 3> array_3 = {{{{-0.8434546455,-0.3219802991,-0.4300150555}},{{-0.23850553,0.9417033479,-0.2372971063}},{{0.4813516106,-0.09758837799,-0.8710781454}}}};
-    std::array<std::array<double, 3>, 3> array_4 = {{{{-0.3695282689,-0.1240881435,0.9208968407}},{{-0.9061330384,-0.1714186601,-0.3867021588}},{{0.2058440555,-0.9773524316,-0.04909632573}}}};
+    std::array<std::array<double, 3>, 3> array_3 = {{{{-0.08917505454,0.8657904013,0.4923969849}},{{-0.8541102027,-0.3207935372,0.4093742398}},{{0.5123900578,-0.3840553184,0.7680871963}}}};
+    std::array<std::array<double, 3>, 3> array_4 = {{{{-0.7501599971,-0.5522090863,0.3637651766}},{{0.2364815535,0.2896961953,0.9274441165}},{{-0.6175244558,0.7817552299,-0.08673123441}}}};
     std::vector<std::array<std::array<double, 3>, 3> > vector_2 = {array_3,array_4};
 
-    compare_vectors_approx(grains.sizes, {0.4434528938,0.2295772202});
+    compare_vectors_approx(grains.sizes, {0.3023520893,0.3966103229});
     compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_2);
   }
 
   // check grains layer 2
   {
     WorldBuilder::grains grains = world2.grains(position, 150e3, 0, 2);
-    compare_vectors_approx(grains.sizes, {0.471427737,0.528572263});
+    compare_vectors_approx(grains.sizes, {0.6949680883,0.3050319117});
     CHECK(grains.sizes[0] + grains.sizes[1] == Approx(1.0));
     // these are random numbers, but they should stay the same.
-    std::array<std::array<double, 3>, 3> array_1 = {{{{0.6535959261,0.5566812833,-0.5127556087}},{{0.3237701162,0.4067148135,0.8542575562}},{{0.6840944944,-0.7243542016,0.08559038145}}}};
-    std::array<std::array<double, 3>, 3> array_2 = {{{{0.937444582,0.1583937415,-0.3100146421}},{{0.3453462197,-0.5355813035,0.7706417169}},{{-0.04397322126,-0.8294962869,-0.5567784711}}}};
+    std::array<std::array<double, 3>, 3> array_1 = {{{{0.1456000871,-0.8044779243,-0.5758609936}},{{-0.9783128492,-0.03039762576,-0.204890101}},{{0.1473247562,0.5932042259,-0.7914569872}}}};
+    std::array<std::array<double, 3>, 3> array_2 = {{{{0.5891313583,-0.5902440451,0.5518479953}},{{0.5877963516,-0.1555760564,-0.7939090249}},{{0.5544544091,0.7920909404,0.2552885629}}}};
     std::vector<std::array<std::array<double, 3>, 3> > vector_1 = {array_1,array_2};
     compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_1);
 
@@ -1977,18 +2453,18 @@ TEST_CASE("WorldBuilder Features: Subducting Plate")
     // note that the values are different from for example the continental plate since
     // this performs a interpolation between segments of the slab.
 
-    std::array<std::array<double, 3>, 3> array_1 = {{{{-0.8841073844,-0.1312960784,-0.4484589977}},{{-0.4639013434,0.3618800113,0.8086027461}},{{0.05612197756,0.9229323904,-0.3808492174}}}};
-    std::array<std::array<double, 3>, 3> array_2 = {{{{-0.2568202195,-0.0592025578,0.9646441997}},{{-0.5750059457,-0.7928848317,-0.2017468859}},{{0.7767956856,-0.6064888299,0.1695870338}}}};
+    std::array<std::array<double, 3>, 3> array_1 = {{{{0.8984111637,0.3327780512,-0.2865591555}},{{0.3137617342,-0.029849038,0.9490324594}},{{0.3072636572,-0.9425326539,-0.1312297274}}}};
+    std::array<std::array<double, 3>, 3> array_2 = {{{{-0.4624632196,0.8389673115,-0.2868128671}},{{-0.6553749567,-0.1055859224,0.7478872102}},{{0.5971695209,0.5338402975,0.598667771}}}};
     std::vector<std::array<std::array<double, 3>, 3> > vector_1 = {array_1,array_2};
     compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_1);
 
     grains = world1.grains(position, std::sqrt(2) * 33e3 - 1, 1, 2);
 
-    std::array<std::array<double, 3>, 3> array_3 = {{{{0.6521279994,0.6032912374,0.459095584}},{{-0.5017626042,0.7974338311,-0.3351620115}},{{-0.5682986551,-0.01178846375,0.8227379113}}}};
-    std::array<std::array<double, 3>, 3> array_4 = {{{{-0.7358966282,0.4557371955,-0.5007591849}},{{0.6726233448,0.4071992867,-0.6178726219}},{{-0.07767875296,-0.791512697,-0.6061960589}}}};
+    std::array<std::array<double, 3>, 3> array_3 = {{{{-0.5631974292,-0.5622992147,-0.6054983476}},{{0.7928503315,-0.1612789278,-0.587688233}},{{0.2328025077,-0.8110540676,0.5366509963}}}};
+    std::array<std::array<double, 3>, 3> array_4 = {{{{0.9232721903,-0.3685431311,0.1083716897}},{{-0.2278796207,-0.2983360634,0.9268583882}},{{-0.3092561091,-0.8804382737,-0.3594288596}}}};
     std::vector<std::array<std::array<double, 3>, 3> > vector_2 = {array_3,array_4};
 
-    compare_vectors_approx(grains.sizes, {0.8843655798,0.5257196065});
+    compare_vectors_approx(grains.sizes, {0.4385750704,0.2783115186});
     compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_2);
   }
 
@@ -1996,11 +2472,11 @@ TEST_CASE("WorldBuilder Features: Subducting Plate")
   {
     WorldBuilder::grains grains = world1.grains(position, std::sqrt(2) * 66e3 - 1, 0, 2);
 
-    compare_vectors_approx(grains.sizes, {0.6692173347,0.3307826653});
+    compare_vectors_approx(grains.sizes, {0.6488606485,0.3511393515});
     CHECK(grains.sizes[0] + grains.sizes[1] == Approx(1.0));
     // these are random numbers, but they should stay the same.
-    std::array<std::array<double, 3>, 3> array_1 = {{{{-0.5791315939,0.7367092885,-0.3490931411}},{{-0.1853986251,-0.5360105647,-0.8236018603}},{{-0.7938727522,-0.4122524697,0.4470055419}}}};
-    std::array<std::array<double, 3>, 3> array_2 = {{{{0.6418405971,0.7328740545,-0.2256906471}},{{-0.6739597786,0.3987178861,-0.6219342924}},{{-0.3658126088,0.5512890961,0.7498409616}}}};
+    std::array<std::array<double, 3>, 3> array_1 = {{{{-0.8921692758,-0.4132462713,-0.1823773629}},{{-0.434589809,0.6752180214,0.5959969141}},{{-0.1231490204,0.6109894785,-0.7820013913}}}};
+    std::array<std::array<double, 3>, 3> array_2 = {{{{0.5156478132,0.6572417827,-0.5496731501}},{{-0.7155841774,0.6831852056,0.1455927877}},{{0.4712182274,0.3182628064,0.8225947777}}}};
     std::vector<std::array<std::array<double, 3>, 3> > vector_1 = {array_1,array_2};
     compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_1);
 
@@ -2236,6 +2712,22 @@ TEST_CASE("WorldBuilder Features: Subducting Plate")
       compare_vectors_approx(grains.sizes, {1./3.,1./3.,1./3.});
       compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_2);
     }
+
+    {
+      // the grains stored in caller-provided buffers should be the same as the
+      // returned grains, also when the buffers are reused and contain old values.
+      std::vector<double> sizes(3, -1.);
+      std::vector<std::array<std::array<double, 3>, 3> > rotation_matrices(3, Utilities::euler_angles_to_rotation_matrix(1,2,3));
+      for (const double depth : {0., 80e3, 100e3, 250e3})
+        for (unsigned int composition_number = 0; composition_number < 2; ++composition_number)
+          {
+            const WorldBuilder::grains grains = world1.grains(position, depth, composition_number, 3);
+            world1.grains(position, depth, composition_number, 3, sizes.data(), rotation_matrices.data());
+
+            compare_vectors_approx(sizes, grains.sizes);
+            compare_vectors_array3_array3_approx(rotation_matrices, grains.rotation_matrices);
+          }
+    }
   }
 
 
@@ -2932,18 +3424,18 @@ TEST_CASE("WorldBuilder Features: Fault")
     // note that the values are different from for example the continental plate since
     // this performs a interpolation between segments of the slab.
 
-    std::array<std::array<double, 3>, 3> array_1 = {{{{-0.8841073844,-0.1312960784,-0.4484589977}},{{-0.4639013434,0.3618800113,0.8086027461}},{{0.05612197756,0.9229323904,-0.3808492174}}}};
-    std::array<std::array<double, 3>, 3> array_2 = {{{{-0.2568202195,-0.0592025578,0.9646441997}},{{-0.5750059457,-0.7928848317,-0.2017468859}},{{0.7767956856,-0.6064888299,0.1695870338}}}};
+    std::array<std::array<double, 3>, 3> array_1 = {{{{0.397414387,0.9072458271,0.1377200572}},{{0.2912907844,-0.2670430283,0.9186063901}},{{0.8701789953,-0.324950812,-0.37039909}}}};
+    std::array<std::array<double, 3>, 3> array_2 = {{{{0.9967463484,-0.08044834267,0.004978062466}},{{-0.05802306382,-0.7590261802,-0.6484694147}},{{0.05594676942,0.6460706787,-0.7612244328}}}};
     std::vector<std::array<std::array<double, 3>, 3> > vector_1 = {array_1,array_2};
     compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_1);
 
     grains = world3.grains(position, 95e3, 1, 2);
 
-    std::array<std::array<double, 3>, 3> array_3 = {{{{0.6521279994,0.6032912374,0.459095584}},{{-0.5017626042,0.7974338311,-0.3351620115}},{{-0.5682986551,-0.01178846375,0.8227379113}}}};
-    std::array<std::array<double, 3>, 3> array_4 = {{{{-0.7358966282,0.4557371955,-0.5007591849}},{{0.6726233448,0.4071992867,-0.6178726219}},{{-0.07767875296,-0.791512697,-0.6061960589}}}};
+    std::array<std::array<double, 3>, 3> array_3 = {{{{0.1932640069,-0.06948580185,0.9786831699}},{{-0.5446004018,-0.8373154954,0.04809535779}},{{0.8161246388,-0.5422863491,-0.1996649433}}}};
+    std::array<std::array<double, 3>, 3> array_4 = {{{{-0.667668924,-0.3273550539,0.66862312}},{{0.4750569194,0.5041568544,0.7212120281}},{{-0.5731833313,0.7991648984,-0.181097581}}}};
     std::vector<std::array<std::array<double, 3>, 3> > vector_2 = {array_3,array_4};
 
-    compare_vectors_approx(grains.sizes, {0.8843655798,0.5257196065});
+    compare_vectors_approx(grains.sizes, {0.9424694787,0.9268430841});
     compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_2);
   }
 
@@ -2951,11 +3443,11 @@ TEST_CASE("WorldBuilder Features: Fault")
   {
     WorldBuilder::grains grains = world3.grains(position, 150e3, 0, 2);
 
-    compare_vectors_approx(grains.sizes, {0.6692173347,0.3307826653});
+    compare_vectors_approx(grains.sizes, {0.798965935,0.201034065});
     CHECK(grains.sizes[0] + grains.sizes[1] == Approx(1.0));
     // these are random numbers, but they should stay the same.
-    std::array<std::array<double, 3>, 3> array_1 = {{{{-0.5791315939,0.7367092885,-0.3490931411}},{{-0.1853986251,-0.5360105647,-0.8236018603}},{{-0.7938727522,-0.4122524697,0.4470055419}}}};
-    std::array<std::array<double, 3>, 3> array_2 = {{{{0.6418405971,0.7328740545,-0.2256906471}},{{-0.6739597786,0.3987178861,-0.6219342924}},{{-0.3658126088,0.5512890961,0.7498409616}}}};
+    std::array<std::array<double, 3>, 3> array_1 = {{{{-0.3408273552,-0.9356163258,-0.09197176111}},{{0.7869525479,-0.2304066142,-0.5723796638}},{{0.5143368559,-0.2674600587,0.8148145284}}}};
+    std::array<std::array<double, 3>, 3> array_2 = {{{{-0.3379753583,0.3628527284,0.8683953907}},{{0.4873629865,0.8568197681,-0.1683365806}},{{-0.8051397249,0.366330155,-0.4664249575}}}};
     std::vector<std::array<std::array<double, 3>, 3> > vector_1 = {array_1,array_2};
     compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_1);
 
@@ -2965,12 +3457,12 @@ TEST_CASE("WorldBuilder Features: Fault")
   {
     WorldBuilder::grains grains = world3.grains(position, 35e3, 0, 2);
 
-    compare_vectors_approx(grains.sizes, {0.3070168208,0.6929831792});
+    compare_vectors_approx(grains.sizes, {0.2224542279,0.7775457721});
     CHECK(grains.sizes[0] + grains.sizes[1] == Approx(1.0));
     // these are random numbers, but they should stay the same.
 
-    std::array<std::array<double, 3>, 3> array_1 = {{{{-0.6634752307,-0.3450403529,0.663888374}},{{-0.2770374165,-0.7109563284,-0.646367828}},{{0.6950186243,-0.6127709638,0.376112826}}}};
-    std::array<std::array<double, 3>, 3> array_2 = {{{{0.6976381754,-0.134849869,0.7036451443}},{{-0.1367834457,-0.9891309921,-0.05394598614}},{{0.7032718288,-0.05861222805,-0.7085007703}}}};
+    std::array<std::array<double, 3>, 3> array_1 = {{{{0.8067684443,0.5397246663,0.240461976}},{{0.1352503852,0.227473055,-0.9643460699}},{{-0.5751799811,0.8105265534,0.1105201137}}}};
+    std::array<std::array<double, 3>, 3> array_2 = {{{{-0.4082780924,0.9111268567,0.05618585493}},{{0.8212064859,0.3934700882,-0.4132810147}},{{-0.3986588852,-0.1225933958,-0.9088685013}}}};
     std::vector<std::array<std::array<double, 3>, 3> > vector_1 = {array_1,array_2};
     compare_vectors_array3_array3_approx(grains.rotation_matrices, vector_1);
 
@@ -15,11 +15,16 @@ endif( NOT TEST_REFERENCE )
 # create a directory for the test
 file(MAKE_DIRECTORY ${CMAKE_BINARY_DIR}/visualization/${TEST_NAME})
 
-set(EXECUTE_COMMAND ${TEST_PROGRAM} ${TEST_ARGS})
+# programs which use mpi are run with 4 processes
+if( MPIEXEC_EXECUTABLE )
+  set(TEST_MPIEXEC ${MPIEXEC_EXECUTABLE} -np 4)
+endif( MPIEXEC_EXECUTABLE )
+
+set(EXECUTE_COMMAND ${TEST_MPIEXEC} ${TEST_PROGRAM} ${TEST_ARGS})
 
 # run the test program, capture the stdout/stderr and the result var ${TEST_ARGS}
 execute_process(
-  COMMAND ${TEST_PROGRAM} ${TEST_ARGS} 
+  COMMAND ${TEST_MPIEXEC} ${TEST_PROGRAM} ${TEST_ARGS} 
   WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}/visualization/ 
   OUTPUT_FILE ${TEST_OUTPUT}.log
   ERROR_VARIABLE TEST_ERROR_VAR
@@ -79,3 +84,42 @@ if( TEST_RESULT )
 	execute_process(COMMAND ${TEST_DIFF} ${TEST_NATIVE_OUTPUT} ${TEST_NATIVE_REFERENCE})
 	message( FATAL_ERROR "Failed: The output of ${TEST_NAME} stored in ${TEST_NATIVE_OUTPUT} did not match the reference output stored in ${TEST_NATIVE_REFERENCE}")
 endif( TEST_RESULT )
+
+# partitioned output also has a directory with the pieces, which are compared one by one.
+get_filename_component(TEST_REFERENCE_DIRECTORY ${TEST_REFERENCE} DIRECTORY)
+get_filename_component(TEST_OUTPUT_DIRECTORY ${TEST_OUTPUT} DIRECTORY)
+if(IS_DIRECTORY ${TEST_REFERENCE_DIRECTORY}/${TEST_NAME})
+  file(GLOB TEST_REFERENCE_PIECES RELATIVE ${TEST_REFERENCE_DIRECTORY}/${TEST_NAME} ${TEST_REFERENCE_DIRECTORY}/${TEST_NAME}/*.vtu)
+  foreach(TEST_PIECE ${TEST_REFERENCE_PIECES})
+    file(TO_NATIVE_PATH "${TEST_OUTPUT_DIRECTORY}/${TEST_NAME}/${TEST_PIECE}" TEST_NATIVE_PIECE_OUTPUT)
+    file(TO_NATIVE_PATH "${TEST_REFERENCE_DIRECTORY}/${TEST_NAME}/${TEST_PIECE}" TEST_NATIVE_PIECE_REFERENCE)
+    execute_process(
+      COMMAND ${TEST_DIFF} -q ${TEST_NATIVE_PIECE_OUTPUT} ${TEST_NATIVE_PIECE_REFERENCE}
+      RESULT_VARIABLE TEST_RESULT
+      )
+    if( TEST_RESULT )
+      execute_process(COMMAND ${TEST_DIFF} ${TEST_NATIVE_PIECE_OUTPUT} ${TEST_NATIVE_PIECE_REFERENCE})
+      message( FATAL_ERROR "Failed: The piece ${TEST_PIECE} of ${TEST_NAME} stored in ${TEST_NATIVE_PIECE_OUTPUT} did not match the reference output stored in ${TEST_NATIVE_PIECE_REFERENCE}")
+    endif( TEST_RESULT )
+  endforeach()
+endif()
+
+# raw binary output is compared through the checksums of its files, which are
+# listed next to the reference in the format of sha256sum.
+if(EXISTS ${TEST_REFERENCE_DIRECTORY}/${TEST_NAME}.sha256)
+  file(STRINGS ${TEST_REFERENCE_DIRECTORY}/${TEST_NAME}.sha256 TEST_CHECKSUMS)
+  foreach(TEST_CHECKSUM_LINE ${TEST_CHECKSUMS})
+    if(NOT TEST_CHECKSUM_LINE MATCHES "^([0-9a-f]+)  (.+)$")
+      message( FATAL_ERROR "Failed: Could not read the checksum \"${TEST_CHECKSUM_LINE}\" of ${TEST_NAME}.")
+    endif()
+    set(TEST_CHECKSUM_REFERENCE ${CMAKE_MATCH_1})
+    set(TEST_CHECKSUM_FILE ${TEST_OUTPUT_DIRECTORY}/${CMAKE_MATCH_2})
+    if(NOT EXISTS ${TEST_CHECKSUM_FILE})
+      message( FATAL_ERROR "Failed: The file ${TEST_CHECKSUM_FILE} of ${TEST_NAME} was not written.")
+    endif()
+    file(SHA256 ${TEST_CHECKSUM_FILE} TEST_CHECKSUM_OUTPUT)
+    if(NOT TEST_CHECKSUM_OUTPUT STREQUAL TEST_CHECKSUM_REFERENCE)
+      message( FATAL_ERROR "Failed: The checksum ${TEST_CHECKSUM_OUTPUT} of ${TEST_CHECKSUM_FILE} did not match the reference checksum ${TEST_CHECKSUM_REFERENCE}.")
+    endif()
+  endforeach()
+endif()
@@ -0,0 +1,303 @@
+/*
+  Copyright (C) 2018 - 2021 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "visualization/adaptive_grid.h"
+
+#include "world_builder/assert.h"
+#include "world_builder/thread_pool.h"
+#include "world_builder/world.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace WorldBuilder
+{
+  namespace Visualization
+  {
+    namespace
+    {
+      /**
+       * The number of bits of every coordinate in the key of a lattice point.
+       */
+      const unsigned int key_bits = 21;
+    }
+
+
+    AdaptiveGrid::AdaptiveGrid(const WorldBuilder::World &world_,
+                               const std::string &grid_type_,
+                               const size_t dim_,
+                               const double gravity_,
+                               const size_t compositions_,
+                               const double x_min, const double x_max,
+                               const double y_min, const double y_max,
+                               const double z_min, const double z_max,
+                               const size_t n_cell_x, const size_t n_cell_y, const size_t n_cell_z,
+                               const size_t max_refinement_level,
+                               const double temperature_difference,
+                               const double composition_difference,
+                               const size_t first_coarse_cell,
+                               const size_t last_coarse_cell,
+                               WorldBuilder::ThreadPool &pool_)
+      :
+      world(world_),
+      grid_type(grid_type_),
+      dim(dim_),
+      gravity(gravity_),
+      compositions(compositions_),
+      min {x_min, y_min, z_min},
+      lattice_spacing {0, 0, 0},
+      surface(z_max),
+      pool(pool_)
+    {
+      WBAssertThrow(grid_type == "cartesian" || grid_type == "chunk",
+                    "Adaptive refinement is only available for the cartesian and chunk grids, not for " << grid_type << ".");
+      WBAssertThrow(dim == 2 || dim == 3, "The dimension should be 2 or 3.");
+
+      const std::uint64_t cell_size = std::uint64_t(1) << max_refinement_level;
+      const size_t n_cells[3] = {n_cell_x, dim == 3 ? n_cell_y : 1, n_cell_z};
+      const double max[3] = {x_max, y_max, z_max};
+      for (size_t d = 0; d < 3; ++d)
+        {
+          WBAssertThrow(n_cells[d] * cell_size < (std::uint64_t(1) << key_bits),
+                        "The number of cells times 2 to the power of the maximum refinement level has to be smaller than "
+                        << (std::uint64_t(1) << key_bits) << " in every direction.");
+          lattice_spacing[d] = (max[d] - min[d]) / static_cast<double>(n_cells[d] * cell_size);
+        }
+
+      WBAssertThrow(first_coarse_cell <= last_coarse_cell && last_coarse_cell <= n_cells[0] * n_cells[1] * n_cells[2],
+                    "The range of coarse cells [" << first_coarse_cell << ", " << last_coarse_cell
+                    << ") is not part of the grid with " << n_cells[0] * n_cells[1] * n_cells[2] << " cells.");
+
+      evaluated_values.resize(2 + compositions);
+      n_cells_per_level.assign(max_refinement_level + 1, 0);
+
+      // start from the given range of the uniform grid.
+      std::vector<Cell> cells;
+      std::vector<Cell> leaves;
+      for (size_t coarse_cell = first_coarse_cell; coarse_cell < last_coarse_cell; ++coarse_cell)
+        {
+          Cell cell;
+          cell.corner[0] = (coarse_cell / (n_cells[2] * n_cells[1])) * cell_size;
+          cell.corner[1] = ((coarse_cell / n_cells[2]) % n_cells[1]) * cell_size;
+          cell.corner[2] = (coarse_cell % n_cells[2]) * cell_size;
+          cell.size = cell_size;
+          cells.emplace_back(cell);
+        }
+
+      for (size_t level = 0; !cells.empty(); ++level)
+        {
+          if (level == max_refinement_level)
+            {
+              n_cells_per_level[level] = cells.size();
+              leaves.insert(leaves.end(), cells.begin(), cells.end());
+              break;
+            }
+
+          std::vector<std::uint64_t> keys;
+          for (const Cell &cell : cells)
+            {
+              const std::vector<std::uint64_t> cell_keys = cell_points(cell, true);
+              keys.insert(keys.end(), cell_keys.begin(), cell_keys.end());
+            }
+          evaluate(keys);
+
+          // A cell is refined when the temperature in its center differs
+          // from the average of its corners, which is the value a linear
+          // interpolation would give, or when a composition is not the same
+          // everywhere in the cell. A smooth temperature gradient, like in
+          // most of the mantle, does therefore not lead to refinement.
+          std::vector<char> refine(cells.size(), 0);
+          pool.parallel_for(0, cells.size(), [&] (size_t c)
+          {
+            const std::vector<std::uint64_t> cell_keys = cell_points(cells[c], true);
+            std::vector<size_t> indices(cell_keys.size());
+            for (size_t p = 0; p < cell_keys.size(); ++p)
+              indices[p] = evaluated_index.find(cell_keys[p])->second;
+            const size_t center = indices.back();
+            indices.pop_back();
+
+            double average = 0;
+            for (const size_t index : indices)
+              average += evaluated_values[1][index];
+            average /= static_cast<double>(indices.size());
+            if (std::fabs(evaluated_values[1][center] - average) > temperature_difference)
+              {
+                refine[c] = 1;
+                return;
+              }
+
+            for (size_t field = 2; field < evaluated_values.size(); ++field)
+              {
+                const double value = evaluated_values[field][center];
+                for (const size_t index : indices)
+                  if (std::fabs(evaluated_values[field][index] - value) > composition_difference)
+                    {
+                      refine[c] = 1;
+                      return;
+                    }
+              }
+          });
+
+          std::vector<Cell> children;
+          size_t n_leaves = 0;
+          for (size_t c = 0; c < cells.size(); ++c)
+            {
+              if (refine[c] == 0)
+                {
+                  leaves.emplace_back(cells[c]);
+                  n_leaves++;
+                  continue;
+                }
+
+              const std::uint64_t half = cells[c].size / 2;
+              for (std::uint64_t i = 0; i < 2; ++i)
+                for (std::uint64_t j = 0; j < (dim == 3 ? 2u : 1u); ++j)
+                  for (std::uint64_t k = 0; k < 2; ++k)
+                    {
+                      Cell child;
+                      child.corner[0] = cells[c].corner[0] + i * half;
+                      child.corner[1] = cells[c].corner[1] + j * half;
+                      child.corner[2] = cells[c].corner[2] + k * half;
+                      child.size = half;
+                      children.emplace_back(child);
+                    }
+            }
+          n_cells_per_level[level] = n_leaves;
+          cells.swap(children);
+        }
+
+      // The corners of the cells on the finest level have not been evaluated
+      // yet.
+      std::vector<std::uint64_t> keys;
+      for (const Cell &cell : leaves)
+        {
+          const std::vector<std::uint64_t> cell_keys = cell_points(cell, false);
+          keys.insert(keys.end(), cell_keys.begin(), cell_keys.end());
+        }
+      evaluate(keys);
+
+      // Only the corners of the cells become points of the grid, the centers
+      // were only needed to decide about the refinement.
+      std::vector<std::int64_t> output_index(evaluated_positions.size(), -1);
+      std::vector<size_t> output_points;
+      connectivity.reserve(keys.size());
+      for (const std::uint64_t cell_key : keys)
+        {
+          const size_t index = evaluated_index.find(cell_key)->second;
+          if (output_index[index] < 0)
+            {
+              output_index[index] = static_cast<std::int64_t>(output_points.size());
+              output_points.emplace_back(index);
+            }
+          connectivity.emplace_back(output_index[index]);
+        }
+
+      points.resize(output_points.size() * 3);
+      values.assign(evaluated_values.size(), std::vector<double>(output_points.size()));
+      for (size_t p = 0; p < output_points.size(); ++p)
+        {
+          std::copy(evaluated_positions[output_points[p]].begin(), evaluated_positions[output_points[p]].end(),
+                    points.begin() + static_cast<std::ptrdiff_t>(p * 3));
+          for (size_t field = 0; field < values.size(); ++field)
+            values[field][p] = evaluated_values[field][output_points[p]];
+        }
+    }
+
+
+    std::uint64_t
+    AdaptiveGrid::key(const std::uint64_t i, const std::uint64_t j, const std::uint64_t k)
+    {
+      return i | (j << key_bits) | (k << (2 * key_bits));
+    }
+
+
+    std::vector<std::uint64_t>
+    AdaptiveGrid::cell_points(const Cell &cell, const bool with_center) const
+    {
+      const std::uint64_t x0 = cell.corner[0];
+      const std::uint64_t y0 = cell.corner[1];
+      const std::uint64_t z0 = cell.corner[2];
+      const std::uint64_t x1 = x0 + cell.size;
+      const std::uint64_t y1 = y0 + cell.size;
+      const std::uint64_t z1 = z0 + cell.size;
+
+      std::vector<std::uint64_t> keys;
+      if (dim == 2)
+        keys = {key(x0, 0, z0), key(x1, 0, z0), key(x1, 0, z1), key(x0, 0, z1)};
+      else
+        keys = {key(x0, y0, z0), key(x1, y0, z0), key(x1, y1, z0), key(x0, y1, z0),
+                key(x0, y0, z1), key(x1, y0, z1), key(x1, y1, z1), key(x0, y1, z1)
+               };
+
+      if (with_center)
+        keys.emplace_back(key(x0 + cell.size / 2, dim == 3 ? y0 + cell.size / 2 : 0, z0 + cell.size / 2));
+
+      return keys;
+    }
+
+
+    void
+    AdaptiveGrid::evaluate(const std::vector<std::uint64_t> &keys)
+    {
+      const size_t first_new = evaluated_positions.size();
+      std::vector<std::uint64_t> new_keys;
+      for (const std::uint64_t new_key : keys)
+        if (evaluated_index.emplace(new_key, first_new + new_keys.size()).second)
+          new_keys.emplace_back(new_key);
+
+      evaluated_positions.resize(first_new + new_keys.size());
+      for (std::vector<double> &field : evaluated_values)
+        field.resize(first_new + new_keys.size());
+
+      const std::uint64_t mask = (std::uint64_t(1) << key_bits) - 1;
+      pool.parallel_for(0, new_keys.size(), [&] (size_t n)
+      {
+        const size_t index = first_new + n;
+        const double p[3] = {min[0] + static_cast<double>(new_keys[n] & mask) *lattice_spacing[0],
+                             min[1] + static_cast<double>((new_keys[n] >> key_bits) & mask) *lattice_spacing[1],
+                             min[2] + static_cast<double>((new_keys[n] >> (2 * key_bits)) & mask) *lattice_spacing[2]
+                            };
+
+        std::array<double,3> &position = evaluated_positions[index];
+        if (grid_type == "cartesian")
+          position = dim == 2 ? std::array<double,3> {{p[0], p[2], 0}} : std::array<double,3> {{p[0], p[1], p[2]}};
+        else if (dim == 2)
+          position = {{p[2] *std::cos(p[0]), p[2] *std::sin(p[0]), 0}};
+        else
+          position = {{p[2] *std::cos(p[1]) *std::cos(p[0]), p[2] *std::cos(p[1]) *std::sin(p[0]), p[2] *std::sin(p[1])}};
+
+        const double depth = surface - p[2];
+        evaluated_values[0][index] = depth;
+        if (dim == 2)
+          {
+            const std::array<double,2> position_2d = {{position[0], position[1]}};
+            evaluated_values[1][index] = world.temperature(position_2d, depth, gravity);
+            for (size_t c = 0; c < compositions; ++c)
+              evaluated_values[2 + c][index] = world.composition(position_2d, depth, static_cast<unsigned int>(c));
+          }
+        else
+          {
+            evaluated_values[1][index] = world.temperature(position, depth, gravity);
+            for (size_t c = 0; c < compositions; ++c)
+              evaluated_values[2 + c][index] = world.composition(position, depth, static_cast<unsigned int>(c));
+          }
+      });
+    }
+  }
+}
@@ -24,11 +24,15 @@
  */
 
 #include "visualization/main.h"
+#include "visualization/adaptive_grid.h"
+#include "visualization/streaming_vtu_writer.h"
+#include "visualization/xdmf_writer.h"
 
 #include "world_builder/assert.h"
 #include "world_builder/coordinate_system.h"
 #include "world_builder/nan.h"
 #include "world_builder/point.h"
+#include "world_builder/thread_pool.h"
 #include "world_builder/utilities.h"
 #include "world_builder/world.h"
 
@@ -43,11 +47,13 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <iterator>
 #include <memory>
 #include <string>
-#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 
@@ -55,74 +61,6 @@ using namespace WorldBuilder;
 using namespace WorldBuilder::Utilities;
 
 
-/**
- * A very simple threadpool class. The threadpool currently only supports a
- * parallel for function, to easily parallelize the for function.
- *
- * Todo: might need something more advanced and safe in the future.
- */
-class ThreadPool
-{
-  public:
-
-    /**
-     * Constructor
-     */
-    explicit ThreadPool(size_t number_of_threads)
-    {
-      pool.resize(number_of_threads);
-    }
-
-    /**
-     * A function which allows to parallelize for loops.
-     */
-    template<typename Callable>
-    void parallel_for(size_t start, size_t end, Callable func)
-    {
-      // Deterimine the size of the slice for the loop
-      size_t n = end - start + 1;
-      size_t slice = static_cast<size_t>(std::round(n / static_cast<size_t>((pool.size()))));
-      slice = std::max(slice, static_cast<size_t>(1));
-
-      // Function which loops the passed function func
-      auto loop_function = [&func] (size_t k1, size_t k2)
-      {
-        for (size_t k = k1; k < k2; k++)
-          {
-            func(k);
-          }
-      };
-
-      // Launch jobs
-      size_t i1 = start;
-      size_t i2 = std::min(start + slice, end);
-      for (size_t i = 0; i + 1 < pool.size() && i1 < end; ++i)
-        {
-          pool[i] = std::thread(loop_function, i1, i2);
-          i1 = i2;
-          i2 = std::min(i2 + slice, end);
-        }
-      if (i1 < end)
-        {
-          pool[pool.size()-1] = std::thread(loop_function, i1, end);
-        }
-
-      // Wait for jobs to finish
-      for (std::thread &t : pool)
-        {
-          if (t.joinable())
-            {
-              t.join();
-            }
-        }
-    }
-
-  private:
-    std::vector<std::thread> pool;
-
-};
-
-
 void project_on_sphere(double radius, double &x_, double &y_, double &z_)
 {
   double x = x_;
@@ -140,6 +78,29 @@ void project_on_sphere(double radius, double &x_, double &y_, double &z_)
 
 }
 
+/**
+ * Computes the direction of every point of the sphere shell as the cosine and
+ * sine of its longitude and the sine and cosine of its colatitude, in the same
+ * way as project_on_sphere does. A point of any layer of the sphere is then
+ * just the direction scaled by the radius of the layer.
+ */
+std::vector<std::array<double,4> > compute_shell_directions(const std::vector<double> &shell_grid_x,
+                                                             const std::vector<double> &shell_grid_y,
+                                                             const std::vector<double> &shell_grid_z)
+{
+  std::vector<std::array<double,4> > directions(shell_grid_x.size());
+  for (size_t i = 0; i < shell_grid_x.size(); ++i)
+    {
+      const WorldBuilder::Point<3> in_point(std::array<double,3> {{shell_grid_x[i],shell_grid_y[i],shell_grid_z[i]}},
+                                            WorldBuilder::CoordinateSystem::cartesian);
+      const double r = in_point.norm();
+      const double theta = std::atan2(in_point[1],in_point[0]);
+      const double phi = std::acos(in_point[2]/r);
+      directions[i] = {{std::cos(theta), std::sin(theta), std::sin(phi), std::cos(phi)}};
+    }
+  return directions;
+}
+
 void lay_points(double x1, double y1, double z1,
                 double x2, double y2, double z2,
                 double x3, double y3, double z3,
@@ -184,6 +145,1093 @@ void lay_points(double x1, double y1, double z1,
 }
 
 
+/**
+ * Creates the surface of the sphere grid on the unit sphere out of 12 blocks
+ * of n_cell_x by n_cell_x cells each. The points on the edges of the blocks
+ * are merged, so every point is only present once. The connectivity contains
+ * the four vertices of every cell one after another. The blocks are computed
+ * on the given thread pool.
+ */
+void create_sphere_shell(size_t n_cell_x,
+                         std::vector<double> &shell_grid_x,
+                         std::vector<double> &shell_grid_y,
+                         std::vector<double> &shell_grid_z,
+                         std::vector<size_t> &shell_grid_connectivity,
+                         ThreadPool &pool)
+{
+  size_t n_block = 12;
+
+  size_t block_n_cell = n_cell_x*n_cell_x;
+  size_t block_n_p = (n_cell_x + 1) * (n_cell_x + 1);
+  size_t block_n_v = 4;
+
+
+  std::vector<std::vector<double> > block_grid_x(n_block,std::vector<double>(block_n_p));
+  std::vector<std::vector<double> > block_grid_y(n_block,std::vector<double>(block_n_p));
+  std::vector<std::vector<double> > block_grid_z(n_block,std::vector<double>(block_n_p));
+  // All blocks have the same connectivity.
+  std::vector<size_t> block_grid_connectivity(block_n_cell * block_n_v);
+  std::vector<std::vector<bool> > block_grid_hull(n_block,std::vector<bool>(block_n_p));
+
+  /**
+   * block node layout
+   */
+  for (size_t i_block = 0; i_block < n_block; ++i_block)
+    {
+      size_t block_n_cell_x = n_cell_x;
+      size_t block_n_cell_y = n_cell_x;
+      double Lx = 1.0;
+      double Ly = 1.0;
+
+      size_t counter = 0;
+      for (size_t j = 0; j <= block_n_cell_y; ++j)
+        {
+          for (size_t i = 0; i <= block_n_cell_y; ++i)
+            {
+              block_grid_x[i_block][counter] = static_cast<double>(i) * Lx / static_cast<double>(block_n_cell_x);
+              block_grid_y[i_block][counter] = static_cast<double>(j) * Ly / static_cast<double>(block_n_cell_y);
+              block_grid_z[i_block][counter] = 0.0;
+              counter++;
+            }
+        }
+
+    }
+
+  // using i=1 and j=1 here because i an j are not used in lookup and storage
+  // so the code can remain very similar to ghost and the cartesian code.
+  size_t counter = 0;
+  for (size_t j = 1; j <= n_cell_x; ++j)
+    {
+      for (size_t i = 1; i <= n_cell_x; ++i)
+        {
+          block_grid_connectivity[counter*block_n_v] = i + (j - 1) * (n_cell_x + 1) - 1;
+          block_grid_connectivity[counter*block_n_v+1] = i + 1 + (j - 1) * (n_cell_x + 1) - 1;
+          block_grid_connectivity[counter*block_n_v+2] = i + 1  + j * (n_cell_x + 1) - 1;
+          block_grid_connectivity[counter*block_n_v+3] = i + j * (n_cell_x + 1) - 1;
+          counter++;
+        }
+    }
+
+  /**
+   * map blocks
+   */
+  double radius = 1;
+
+  // four corners
+  double xA = -1.0;
+  double yA = 0.0;
+  double zA = -1.0 / std::sqrt(2.0);
+
+  double xB = 1.0;
+  double yB = 0.0;
+  double zB = -1.0 / std::sqrt(2.0);
+
+  double xC = 0.0;
+  double yC = -1.0;
+  double zC = 1.0 / std::sqrt(2.0);
+
+  double xD = 0.0;
+  double yD = 1.0;
+  double zD = 1.0 / std::sqrt(2.0);
+
+  // middles of faces
+  double xM = (xA+xB+xC)/3.0;
+  double yM = (yA+yB+yC)/3.0;
+  double zM = (zA+zB+zC)/3.0;
+
+  double xN = (xA+xD+xC)/3.0;
+  double yN = (yA+yD+yC)/3.0;
+  double zN = (zA+zD+zC)/3.0;
+
+  double xP = (xA+xD+xB)/3.0;
+  double yP = (yA+yD+yB)/3.0;
+  double zP = (zA+zD+zB)/3.0;
+
+  double xQ = (xC+xD+xB)/3.0;
+  double yQ = (yC+yD+yB)/3.0;
+  double zQ = (zC+zD+zB)/3.0;
+
+  // middle of edges
+  double xF = (xB+xC)/2.0;
+  double yF = (yB+yC)/2.0;
+  double zF = (zB+zC)/2.0;
+
+  double xG = (xA+xC)/2.0;
+  double yG = (yA+yC)/2.0;
+  double zG = (zA+zC)/2.0;
+
+  double xE = (xB+xA)/2.0;
+  double yE = (yB+yA)/2.0;
+  double zE = (zB+zA)/2.0;
+
+  double xH = (xD+xC)/2.0;
+  double yH = (yD+yC)/2.0;
+  double zH = (zD+zC)/2.0;
+
+  double xJ = (xD+xA)/2.0;
+  double yJ = (yD+yA)/2.0;
+  double zJ = (zD+zA)/2.0;
+
+  double xK = (xD+xB)/2.0;
+  double yK = (yD+yB)/2.0;
+  double zK = (zD+zB)/2.0;
+
+  // Making sure points A..Q are on a sphere
+  project_on_sphere(radius,xA,yA,zA);
+  project_on_sphere(radius,xB,yB,zB);
+  project_on_sphere(radius,xC,yC,zC);
+  project_on_sphere(radius,xD,yD,zD);
+  project_on_sphere(radius,xE,yE,zE);
+  project_on_sphere(radius,xF,yF,zF);
+  project_on_sphere(radius,xG,yG,zG);
+  project_on_sphere(radius,xH,yH,zH);
+  project_on_sphere(radius,xJ,yJ,zJ);
+  project_on_sphere(radius,xK,yK,zK);
+  project_on_sphere(radius,xM,yM,zM);
+  project_on_sphere(radius,xN,yN,zN);
+  project_on_sphere(radius,xP,yP,zP);
+  project_on_sphere(radius,xQ,yQ,zQ);
+
+  // The blocks as the indices of their four corners in the order A, B, C, D,
+  // E, F, G, H, J, K, M, N, P, Q.
+  const size_t n_corners = 14;
+  const std::array<std::array<double,3>,n_corners> corners = {{{{xA,yA,zA}}, {{xB,yB,zB}}, {{xC,yC,zC}}, {{xD,yD,zD}},
+      {{xE,yE,zE}}, {{xF,yF,zF}}, {{xG,yG,zG}}, {{xH,yH,zH}},
+      {{xJ,yJ,zJ}}, {{xK,yK,zK}}, {{xM,yM,zM}}, {{xN,yN,zN}},
+      {{xP,yP,zP}}, {{xQ,yQ,zQ}}
+    }
+  };
+  const std::array<std::array<size_t,4>,12> block_corners = {{{{10,6,0,4}}, {{5,10,4,1}}, {{2,6,10,5}}, {{6,11,8,0}},
+      {{2,7,11,6}}, {{7,3,8,11}}, {{0,8,12,4}}, {{8,3,9,12}},
+      {{12,9,1,4}}, {{13,9,3,7}}, {{13,7,2,5}}, {{13,5,1,9}}
+    }
+  };
+
+  pool.parallel_for(0, n_block, [&] (size_t i_block)
+  {
+    const std::array<double,3> &p1 = corners[block_corners[i_block][0]];
+    const std::array<double,3> &p2 = corners[block_corners[i_block][1]];
+    const std::array<double,3> &p3 = corners[block_corners[i_block][2]];
+    const std::array<double,3> &p4 = corners[block_corners[i_block][3]];
+    lay_points(p1[0],p1[1],p1[2],p2[0],p2[1],p2[2],p3[0],p3[1],p3[2],p4[0],p4[1],p4[2],
+               block_grid_x[i_block], block_grid_y[i_block], block_grid_z[i_block], block_grid_hull[i_block], n_cell_x);
+
+    // make sure all points end up on a sphere
+    for (size_t i_point = 0; i_point < block_n_p; ++i_point)
+      {
+        project_on_sphere(radius,block_grid_x[i_block][i_point],block_grid_y[i_block][i_point],block_grid_z[i_block][i_point]);
+      }
+  }, 1);
+
+  /**
+   * merge blocks
+   */
+  // A point on the hull of a block is identified by the two corners of its
+  // edge and its position along the edge, counted from the corner with the
+  // lower index. The neighbouring block computes the same key for the same
+  // point, so the points are merged without comparing their coordinates.
+  const size_t level = n_cell_x;
+  auto hull_key = [&](const size_t i_block, const size_t i, const size_t j) -> size_t
+  {
+    const std::array<size_t,4> &c = block_corners[i_block];
+    size_t first = c[0];
+    size_t second = c[3];
+    size_t position = j;
+    if (j == 0)
+      {
+        second = c[1];
+        position = i;
+      }
+    else if (i == level)
+      {
+        first = c[1];
+        second = c[2];
+      }
+    else if (j == level)
+      {
+        first = c[3];
+        second = c[2];
+        position = i;
+      }
+
+    if (position == 0)
+      return first;
+    if (position == level)
+      return second;
+    if (first > second)
+      {
+        std::swap(first, second);
+        position = level - position;
+      }
+    return n_corners + (first * n_corners + second) * (level + 1) + position;
+  };
+
+  // Every point of the blocks points to its index in the shell. Only the
+  // first occurrence of a point on the hull is stored in the shell.
+  std::vector<size_t> point_to(n_block * block_n_p);
+  std::unordered_map<size_t,size_t> hull_points;
+  shell_grid_x.clear();
+  shell_grid_y.clear();
+  shell_grid_z.clear();
+  for (size_t i_block = 0; i_block < n_block; ++i_block)
+    {
+      for (size_t j = 0; j <= level; ++j)
+        {
+          for (size_t i = 0; i <= level; ++i)
+            {
+              const size_t i_point = i + j * (level + 1);
+              if (block_grid_hull[i_block][i_point])
+                {
+                  const auto inserted = hull_points.emplace(hull_key(i_block, i, j), shell_grid_x.size());
+                  if (!inserted.second)
+                    {
+                      point_to[i_block * block_n_p + i_point] = inserted.first->second;
+                      continue;
+                    }
+                }
+              point_to[i_block * block_n_p + i_point] = shell_grid_x.size();
+              shell_grid_x.push_back(block_grid_x[i_block][i_point]);
+              shell_grid_y.push_back(block_grid_y[i_block][i_point]);
+              shell_grid_z.push_back(block_grid_z[i_block][i_point]);
+            }
+        }
+    }
+
+  size_t shell_n_cell = n_block * block_n_cell;
+  size_t shell_n_v = block_n_v;
+
+  shell_grid_connectivity.resize(shell_n_cell * shell_n_v);
+
+  // map the block connectivity to the merged and compacted points of the shell.
+  for (size_t i = 0; i < n_block; ++i)
+    {
+      for (size_t j = 0; j < block_n_cell * block_n_v; ++j)
+        {
+          shell_grid_connectivity[i * block_n_cell * block_n_v + j] = point_to[block_grid_connectivity[j] + i * block_n_p];
+        }
+    }
+}
+
+
+/**
+ * Creates a generator for the grid of the given type, which computes the
+ * points and cells of the grid one at a time. It is used both to build the
+ * whole grid in memory and to write it in chunks or pieces.
+ */
+GridGenerator create_grid_generator(const std::string &grid_type, const size_t dim,
+                                    const double x_min, const double x_max,
+                                    const double y_min, const double y_max,
+                                    const double z_min, const double z_max,
+                                    const size_t n_cell_x, const size_t n_cell_y, const size_t n_cell_z,
+                                    ThreadPool &pool)
+{
+  GridGenerator grid;
+  grid.n_vertices_per_cell = dim == 2 ? 4 : 8;
+  grid.cell_type = dim == 2 ? 9 : 12;
+
+  if (grid_type == "cartesian" || grid_type == "chunk")
+    {
+      grid.n_cells = n_cell_x * n_cell_z * (dim == 3 ? n_cell_y : 1);
+      grid.n_points = (n_cell_x + 1) * (n_cell_z + 1) * (dim == 3 ? (n_cell_y + 1) : 1);
+
+      if (dim == 3)
+        {
+          grid.cell = [=](size_t cell, std::int64_t *vertices)
+          {
+            const size_t k = cell % n_cell_z + 1;
+            const size_t j = (cell / n_cell_z) % n_cell_y + 1;
+            const size_t i = cell / (n_cell_z * n_cell_y) + 1;
+            vertices[0] = static_cast<std::int64_t>((n_cell_y + 1) * (n_cell_z + 1) * (i - 1) + (n_cell_z + 1) * (j - 1) + k - 1);
+            vertices[1] = static_cast<std::int64_t>((n_cell_y + 1) * (n_cell_z + 1) * (i    ) + (n_cell_z + 1) * (j - 1) + k - 1);
+            vertices[2] = static_cast<std::int64_t>((n_cell_y + 1) * (n_cell_z + 1) * (i    ) + (n_cell_z + 1) * (j    ) + k - 1);
+            vertices[3] = static_cast<std::int64_t>((n_cell_y + 1) * (n_cell_z + 1) * (i - 1) + (n_cell_z + 1) * (j    ) + k - 1);
+            vertices[4] = static_cast<std::int64_t>((n_cell_y + 1) * (n_cell_z + 1) * (i - 1) + (n_cell_z + 1) * (j - 1) + k);
+            vertices[5] = static_cast<std::int64_t>((n_cell_y + 1) * (n_cell_z + 1) * (i    ) + (n_cell_z + 1) * (j - 1) + k);
+            vertices[6] = static_cast<std::int64_t>((n_cell_y + 1) * (n_cell_z + 1) * (i    ) + (n_cell_z + 1) * (j    ) + k);
+            vertices[7] = static_cast<std::int64_t>((n_cell_y + 1) * (n_cell_z + 1) * (i - 1) + (n_cell_z + 1) * (j    ) + k);
+          };
+        }
+
+      if (grid_type == "cartesian")
+        {
+          const double dx = (x_max - x_min) / static_cast<double>(n_cell_x);
+          const double dy = (y_max - y_min) / static_cast<double>(n_cell_y);
+          const double dz = (z_max - z_min) / static_cast<double>(n_cell_z);
+          const double surface = z_max;
+
+          WBAssertThrow(!std::isnan(dx), "dx is not a number:" << dx << ".");
+          WBAssertThrow(dim == 2 || !std::isnan(dy), "dy is not a number:" << dy << ".");
+          WBAssertThrow(!std::isnan(dz), "dz is not a number:" << dz << ".");
+
+          if (dim == 2)
+            {
+              grid.point = [=](size_t point, std::array<double,3> &position, double &depth)
+              {
+                const size_t i = point % (n_cell_x + 1);
+                const size_t j = point / (n_cell_x + 1);
+                position[0] = x_min + static_cast<double>(i) * dx;
+                position[1] = z_min + static_cast<double>(j) * dz;
+                position[2] = 0;
+                depth = (surface - z_min) - static_cast<double>(j) * dz;
+              };
+              grid.cell = [=](size_t cell, std::int64_t *vertices)
+              {
+                const size_t i = cell % n_cell_x + 1;
+                const size_t j = cell / n_cell_x + 1;
+                vertices[0] = static_cast<std::int64_t>(i + (j - 1) * (n_cell_x + 1) - 1);
+                vertices[1] = static_cast<std::int64_t>(i + 1 + (j - 1) * (n_cell_x + 1) - 1);
+                vertices[2] = static_cast<std::int64_t>(i + 1  + j * (n_cell_x + 1) - 1);
+                vertices[3] = static_cast<std::int64_t>(i + j * (n_cell_x + 1) - 1);
+              };
+            }
+          else
+            {
+              grid.point = [=](size_t point, std::array<double,3> &position, double &depth)
+              {
+                const size_t k = point % (n_cell_z + 1);
+                const size_t j = (point / (n_cell_z + 1)) % (n_cell_y + 1);
+                const size_t i = point / ((n_cell_z + 1) * (n_cell_y + 1));
+                position[0] = x_min + static_cast<double>(i) * dx;
+                position[1] = y_min + static_cast<double>(j) * dy;
+                position[2] = z_min + static_cast<double>(k) * dz;
+                depth = (surface - z_min) - static_cast<double>(k) * dz;
+              };
+            }
+        }
+      else
+        {
+          const double inner_radius = z_min;
+
+          WBAssertThrow(x_min <= x_max, "The minimum longitude must be less than the maximum longitude.");
+          WBAssertThrow(dim == 2 || y_min <= y_max, "The minimum latitude must be less than the maximum latitude.");
+          WBAssertThrow(inner_radius < z_max, "The inner radius must be less than the outer radius.");
+
+          WBAssertThrow(x_min - x_max <= 2.0 * const_pi, "The difference between the minimum and maximum longitude "
+                        " must be less than or equal to 360 degree.");
+
+          WBAssertThrow(dim == 2 || y_min >= - 0.5 * const_pi, "The minimum latitude must be larger then or equal to -90 degree.");
+          WBAssertThrow(dim == 2 || y_min <= 0.5 * const_pi, "The maximum latitude must be smaller then or equal to 90 degree.");
+
+          const double dlong = (x_max - x_min) / static_cast<double>(n_cell_x);
+          const double dlat = (y_max - y_min) / static_cast<double>(n_cell_y);
+          const double lr = z_max - inner_radius;
+          const double dr = lr / static_cast<double>(n_cell_z);
+
+          if (dim == 2)
+            {
+              grid.point = [=](size_t point, std::array<double,3> &position, double &depth)
+              {
+                const size_t i = point / (n_cell_z + 1) + 1;
+                const size_t j = point % (n_cell_z + 1) + 1;
+                const double longitude = x_min + (static_cast<double>(i) - 1.0) * dlong;
+                const double radius = inner_radius + (static_cast<double>(j) - 1.0) * dr;
+                position[0] = radius * std::cos(longitude);
+                position[1] = radius * std::sin(longitude);
+                position[2] = 0;
+                depth = lr - (static_cast<double>(j) - 1.0) * dr;
+              };
+              grid.cell = [=](size_t cell, std::int64_t *vertices)
+              {
+                const size_t i = cell / n_cell_z + 1;
+                const size_t j = cell % n_cell_z + 1;
+                vertices[0] = static_cast<std::int64_t>((n_cell_z + 1) * (i - 1) + j - 1);
+                vertices[1] = static_cast<std::int64_t>((n_cell_z + 1) * (i - 1) + j);
+                vertices[2] = static_cast<std::int64_t>((n_cell_z + 1) * (i    ) + j);
+                vertices[3] = static_cast<std::int64_t>((n_cell_z + 1) * (i    ) + j - 1);
+              };
+            }
+          else
+            {
+              grid.point = [=](size_t point, std::array<double,3> &position, double &depth)
+              {
+                const size_t k = point % (n_cell_z + 1) + 1;
+                const size_t j = (point / (n_cell_z + 1)) % (n_cell_y + 1) + 1;
+                const size_t i = point / ((n_cell_z + 1) * (n_cell_y + 1)) + 1;
+                const double longitude = x_min + (static_cast<double>(i) - 1.0) * dlong;
+                const double latitude = y_min + (static_cast<double>(j) - 1.0) * dlat;
+                const double radius = inner_radius + (static_cast<double>(k) - 1.0) * dr;
+                position[0] = radius * std::cos(latitude) * std::cos(longitude);
+                position[1] = radius * std::cos(latitude) * std::sin(longitude);
+                position[2] = radius * std::sin(latitude);
+                depth = lr - (static_cast<double>(k) - 1.0) * dr;
+              };
+            }
+        }
+    }
+  else if (grid_type == "annulus")
+    {
+      WBAssertThrow(dim == 2, "The annulus only works in 2d.");
+
+      const double inner_radius = z_min;
+      const double outer_radius = z_max;
+      const double l_outer = 2.0 * const_pi * outer_radius;
+      const double dr = (outer_radius - inner_radius) / static_cast<double>(n_cell_z);
+      const size_t n_cell_t = static_cast<size_t>((2.0 * const_pi * outer_radius)/dr);
+      const double sx = l_outer / static_cast<double>(n_cell_t);
+      const double sz = dr;
+
+      grid.n_cells = n_cell_t * n_cell_z;
+      grid.n_points = n_cell_t * (n_cell_z + 1);
+
+      grid.point = [=](size_t point, std::array<double,3> &position, double &depth)
+      {
+        const size_t i = point % n_cell_t + 1;
+        const size_t j = point / n_cell_t;
+        const double xi = (static_cast<double>(i) - 1.0) * sx;
+        const double zi = static_cast<double>(j) * sz;
+        const double theta = xi / l_outer * 2.0 * const_pi;
+        position[0] = std::cos(theta) * (inner_radius + zi);
+        position[1] = std::sin(theta) * (inner_radius + zi);
+        position[2] = 0;
+        depth = outer_radius - (inner_radius + zi);
+      };
+      grid.cell = [=](size_t cell, std::int64_t *vertices)
+      {
+        const size_t i = cell % n_cell_t + 1;
+        const size_t j = cell / n_cell_t + 1;
+        size_t vertex_0 = cell + 1;
+        size_t vertex_1 = cell + 1 + 1;
+        size_t vertex_2 = i + j * n_cell_t + 1;
+        size_t vertex_3 = i + j * n_cell_t;
+        if (i == n_cell_t)
+          {
+            vertex_1 = vertex_1 - n_cell_t;
+            vertex_2 = vertex_2 - n_cell_t;
+          }
+        vertices[0] = static_cast<std::int64_t>(vertex_1 - 1);
+        vertices[1] = static_cast<std::int64_t>(vertex_0 - 1);
+        vertices[2] = static_cast<std::int64_t>(vertex_3 - 1);
+        vertices[3] = static_cast<std::int64_t>(vertex_2 - 1);
+      };
+    }
+  else if (grid_type == "sphere")
+    {
+      WBAssertThrow(dim == 3, "The sphere only works in 3d.");
+
+      const double inner_radius = z_min;
+      const double outer_radius = z_max;
+
+      // The shell only grows with the square of the number of cells, so it is
+      // stored and every layer of the sphere is computed from it.
+      auto shell_grid_x = std::make_shared<std::vector<double> >();
+      auto shell_grid_y = std::make_shared<std::vector<double> >();
+      auto shell_grid_z = std::make_shared<std::vector<double> >();
+      auto shell_grid_connectivity = std::make_shared<std::vector<size_t> >();
+      create_sphere_shell(n_cell_x, *shell_grid_x, *shell_grid_y, *shell_grid_z, *shell_grid_connectivity, pool);
+
+      const size_t shell_n_p = shell_grid_x->size();
+      const size_t shell_n_cell = shell_grid_connectivity->size() / 4;
+      auto shell_directions = std::make_shared<std::vector<std::array<double,4> > >(
+                                compute_shell_directions(*shell_grid_x, *shell_grid_y, *shell_grid_z));
+
+      grid.n_cells = n_cell_z * shell_n_cell;
+      grid.n_points = (n_cell_z + 1) * shell_n_p;
+
+      grid.point = [=](size_t point, std::array<double,3> &position, double &depth)
+      {
+        const size_t layer = point / shell_n_p;
+        const size_t j = point % shell_n_p;
+        const double radius = inner_radius + ((outer_radius - inner_radius) / static_cast<double>(n_cell_z)) * static_cast<double>(layer);
+        const std::array<double,4> &direction = (*shell_directions)[j];
+        position[0] = radius * direction[0] * direction[2];
+        position[1] = radius * direction[1] * direction[2];
+        position[2] = radius * direction[3];
+        depth = outer_radius - radius;
+      };
+      grid.cell = [=](size_t cell, std::int64_t *vertices)
+      {
+        const size_t layer = cell / shell_n_cell;
+        const size_t *shell_cell = &(*shell_grid_connectivity)[(cell % shell_n_cell) * 4];
+        for (size_t k = 0; k < 4; ++k)
+          {
+            vertices[k] = static_cast<std::int64_t>(shell_cell[k] + layer * shell_n_p);
+            vertices[k+4] = static_cast<std::int64_t>(shell_cell[k] + (layer+1) * shell_n_p);
+          }
+      };
+    }
+  else
+    {
+      WBAssertThrow(false, "Geometry type '" << grid_type << "' is not a valid geometry type. Valid geometry types are: "
+                    << "'cartesian', 'annulus', 'chunk' and 'sphere'. "
+                    << "Please note that the annulus can only be used in 2d and the sphere can only be used in 3d.");
+    }
+
+  return grid;
+}
+
+
+GridGenerator create_plane_generator(const std::array<double,3> &origin,
+                                     const std::array<double,3> &direction_1,
+                                     const std::array<double,3> &direction_2,
+                                     const double surface,
+                                     const size_t n_cell_1, const size_t n_cell_2)
+{
+  WBAssertThrow(n_cell_1 != 0 && n_cell_2 != 0, "The plane needs at least one cell in both directions.");
+
+  GridGenerator grid;
+  grid.n_vertices_per_cell = 4;
+  grid.cell_type = 9;
+  grid.n_cells = n_cell_1 * n_cell_2;
+  grid.n_points = (n_cell_1 + 1) * (n_cell_2 + 1);
+
+  grid.point = [=](size_t point, std::array<double,3> &position, double &depth)
+  {
+    const double s = static_cast<double>(point % (n_cell_1 + 1)) / static_cast<double>(n_cell_1);
+    const double t = static_cast<double>(point / (n_cell_1 + 1)) / static_cast<double>(n_cell_2);
+    for (size_t d = 0; d < 3; ++d)
+      position[d] = origin[d] + s * direction_1[d] + t * direction_2[d];
+    depth = surface - position[2];
+  };
+  grid.cell = [=](size_t cell, std::int64_t *vertices)
+  {
+    const size_t i = cell % n_cell_1;
+    const size_t j = cell / n_cell_1;
+    vertices[0] = static_cast<std::int64_t>(i + j * (n_cell_1 + 1));
+    vertices[1] = static_cast<std::int64_t>(i + 1 + j * (n_cell_1 + 1));
+    vertices[2] = static_cast<std::int64_t>(i + 1 + (j + 1) * (n_cell_1 + 1));
+    vertices[3] = static_cast<std::int64_t>(i + (j + 1) * (n_cell_1 + 1));
+  };
+
+  return grid;
+}
+
+
+GridGenerator create_great_circle_generator(const double start_longitude, const double start_latitude,
+                                            const double end_longitude, const double end_latitude,
+                                            const double inner_radius, const double outer_radius,
+                                            const size_t n_cell_x, const size_t n_cell_z)
+{
+  WBAssertThrow(n_cell_x != 0 && n_cell_z != 0, "The great circle needs at least one cell along the circle and in depth.");
+  WBAssertThrow(inner_radius < outer_radius, "The inner radius must be less than the outer radius.");
+
+  // The unit vectors of the start and end point and the angle between them.
+  const std::array<double,3> start = {{std::cos(start_latitude) *std::cos(start_longitude),
+                                       std::cos(start_latitude) *std::sin(start_longitude),
+                                       std::sin(start_latitude)
+                                      }
+                                     };
+  const std::array<double,3> end = {{std::cos(end_latitude) *std::cos(end_longitude),
+                                     std::cos(end_latitude) *std::sin(end_longitude),
+                                     std::sin(end_latitude)
+                                    }
+                                   };
+  const double angle = std::acos(std::min(1.0, std::max(-1.0, start[0] * end[0] + start[1] * end[1] + start[2] * end[2])));
+  WBAssertThrow(angle > 0 && angle < const_pi,
+                "The start and end point of the great circle may not be the same or opposite points on the sphere.");
+
+  GridGenerator grid;
+  grid.n_vertices_per_cell = 4;
+  grid.cell_type = 9;
+  grid.n_cells = n_cell_x * n_cell_z;
+  grid.n_points = (n_cell_x + 1) * (n_cell_z + 1);
+
+  const double dr = (outer_radius - inner_radius) / static_cast<double>(n_cell_z);
+  grid.point = [=](size_t point, std::array<double,3> &position, double &depth)
+  {
+    // spherical linear interpolation between the start and end point.
+    const double fraction = static_cast<double>(point % (n_cell_x + 1)) / static_cast<double>(n_cell_x);
+    const double radius = inner_radius + static_cast<double>(point / (n_cell_x + 1)) * dr;
+    const double a = std::sin((1.0 - fraction) * angle) / std::sin(angle);
+    const double b = std::sin(fraction * angle) / std::sin(angle);
+    for (size_t d = 0; d < 3; ++d)
+      position[d] = radius * (a * start[d] + b * end[d]);
+    depth = outer_radius - radius;
+  };
+  grid.cell = [=](size_t cell, std::int64_t *vertices)
+  {
+    const size_t i = cell % n_cell_x;
+    const size_t j = cell / n_cell_x;
+    vertices[0] = static_cast<std::int64_t>(i + j * (n_cell_x + 1));
+    vertices[1] = static_cast<std::int64_t>(i + 1 + j * (n_cell_x + 1));
+    vertices[2] = static_cast<std::int64_t>(i + 1 + (j + 1) * (n_cell_x + 1));
+    vertices[3] = static_cast<std::int64_t>(i + (j + 1) * (n_cell_x + 1));
+  };
+
+  return grid;
+}
+
+
+GridGenerator create_depth_shell_generator(const double x_min, const double x_max,
+                                           const double y_min, const double y_max,
+                                           const double outer_radius, const double depth,
+                                           const size_t n_cell_x, const size_t n_cell_y)
+{
+  WBAssertThrow(n_cell_x != 0 && n_cell_y != 0, "The depth shell needs at least one cell in longitude and latitude.");
+  WBAssertThrow(depth >= 0 && depth < outer_radius, "The depth of the shell has to be between zero and the outer radius.");
+
+  // The plane generator computes the longitude, latitude and radius, which
+  // are then converted into cartesian coordinates.
+  const GridGenerator lat_long = create_plane_generator({{x_min, y_min, outer_radius - depth}},
+                                                         {{x_max - x_min, 0, 0}},
+                                                         {{0, y_max - y_min, 0}},
+                                                         0, n_cell_x, n_cell_y);
+
+  GridGenerator grid = lat_long;
+  grid.point = [=](size_t point, std::array<double,3> &position, double &point_depth)
+  {
+    std::array<double,3> spherical;
+    lat_long.point(point, spherical, point_depth);
+    position[0] = spherical[2] * std::cos(spherical[1]) * std::cos(spherical[0]);
+    position[1] = spherical[2] * std::cos(spherical[1]) * std::sin(spherical[0]);
+    position[2] = spherical[2] * std::sin(spherical[1]);
+    point_depth = depth;
+  };
+
+  return grid;
+}
+
+
+/**
+ * The hash of an edge between two points of a grid, which is used for the
+ * edge tables of the isosurface.
+ */
+struct EdgeHash
+{
+  size_t operator()(const std::pair<std::int64_t, std::int64_t> &edge) const
+  {
+    return std::hash<std::int64_t>()(edge.first) ^ (std::hash<std::int64_t>()(edge.second) * static_cast<size_t>(0x9e3779b97f4a7c15ULL));
+  }
+};
+
+
+GridGenerator create_isosurface_generator(const GridGenerator &volume,
+                                          const WorldBuilder::World &world,
+                                          const double gravity,
+                                          const double temperature,
+                                          ThreadPool &pool)
+{
+  WBAssertThrow(volume.n_vertices_per_cell == 8, "The isosurface can only be computed on a 3d grid.");
+
+  // The coarse pre-pass: evaluate the temperature at all points of the volume.
+  std::vector<std::array<double,3> > positions(volume.n_points);
+  std::vector<double> depths(volume.n_points);
+  std::vector<double> temperatures(volume.n_points);
+  pool.parallel_for(0, volume.n_points, [&] (size_t i)
+  {
+    volume.point(i, positions[i], depths[i]);
+    temperatures[i] = world.temperature(positions[i], depths[i], gravity);
+  });
+
+  // Every hexahedron is split into six tetrahedra around the diagonal from
+  // vertex 0 to vertex 6, in which the isosurface is one or two triangles
+  // (marching tetrahedra). The points of the isosurface are on the edges of
+  // the volume grid, and every edge is only used once.
+  const size_t tetrahedra[6][4] = {{0,5,1,6}, {0,1,2,6}, {0,2,3,6}, {0,3,7,6}, {0,7,4,6}, {0,4,5,6}};
+
+  // The cells are divided into slabs which are extracted in parallel. Every
+  // slab has its own edge table and numbers its points in the order in
+  // which they are first used. The slabs are merged in order afterwards, so
+  // the isosurface does not depend on the number of threads.
+  struct Slab
+  {
+    std::vector<std::pair<std::int64_t, std::int64_t> > edges;
+    std::vector<std::array<double,4> > points;
+    std::vector<std::int64_t> connectivity;
+  };
+  const size_t n_slabs = std::min(volume.n_cells, 4 * pool.n_threads());
+  std::vector<Slab> slabs(n_slabs);
+
+  pool.parallel_for(0, n_slabs, [&] (size_t s)
+  {
+    Slab &slab = slabs[s];
+    std::unordered_map<std::pair<std::int64_t, std::int64_t>, std::int64_t, EdgeHash> edge_points;
+
+    auto edge_point = [&](std::int64_t a, std::int64_t b)
+    {
+      const std::pair<std::int64_t, std::int64_t> edge(std::min(a, b), std::max(a, b));
+      const auto inserted = edge_points.emplace(edge, static_cast<std::int64_t>(slab.points.size()));
+      if (!inserted.second)
+        return inserted.first->second;
+
+      const size_t first = static_cast<size_t>(edge.first);
+      const size_t second = static_cast<size_t>(edge.second);
+      const double fraction = (temperature - temperatures[first]) / (temperatures[second] - temperatures[first]);
+      std::array<double,4> point;
+      for (size_t d = 0; d < 3; ++d)
+        point[d] = positions[first][d] + fraction * (positions[second][d] - positions[first][d]);
+      point[3] = depths[first] + fraction * (depths[second] - depths[first]);
+
+      slab.edges.emplace_back(edge);
+      slab.points.emplace_back(point);
+      return inserted.first->second;
+    };
+
+    std::int64_t vertices[8];
+    for (size_t cell = volume.n_cells * s / n_slabs; cell < volume.n_cells * (s + 1) / n_slabs; ++cell)
+      {
+        volume.cell(cell, vertices);
+        for (const auto &tetrahedron : tetrahedra)
+          {
+            std::int64_t inside[4];
+            std::int64_t outside[4];
+            size_t n_inside = 0;
+            size_t n_outside = 0;
+            for (const size_t v : tetrahedron)
+              {
+                if (temperatures[static_cast<size_t>(vertices[v])] >= temperature)
+                  inside[n_inside++] = vertices[v];
+                else
+                  outside[n_outside++] = vertices[v];
+              }
+
+            if (n_inside == 1 || n_outside == 1)
+              {
+                const std::int64_t single = n_inside == 1 ? inside[0] : outside[0];
+                const std::int64_t *others = n_inside == 1 ? outside : inside;
+                for (size_t other = 0; other < 3; ++other)
+                  slab.connectivity.emplace_back(edge_point(single, others[other]));
+              }
+            else if (n_inside == 2)
+              {
+                const std::int64_t p0 = edge_point(inside[0], outside[0]);
+                const std::int64_t p1 = edge_point(inside[0], outside[1]);
+                const std::int64_t p2 = edge_point(inside[1], outside[1]);
+                const std::int64_t p3 = edge_point(inside[1], outside[0]);
+                slab.connectivity.insert(slab.connectivity.end(), {p0, p1, p2, p0, p2, p3});
+              }
+          }
+      }
+  }, 1);
+
+  // The points on the edges which are shared by two slabs are only kept
+  // once. The connectivity of every slab is then renumbered in parallel.
+  auto surface_points = std::make_shared<std::vector<std::array<double,4> > >();
+  auto surface_connectivity = std::make_shared<std::vector<std::int64_t> >();
+  std::vector<std::vector<std::int64_t> > global_index(n_slabs);
+  std::vector<size_t> first_vertex(n_slabs + 1, 0);
+  {
+    size_t n_points = 0;
+    for (const Slab &slab : slabs)
+      n_points += slab.points.size();
+    std::unordered_map<std::pair<std::int64_t, std::int64_t>, std::int64_t, EdgeHash> edge_points(n_points);
+    surface_points->reserve(n_points);
+
+    for (size_t s = 0; s < n_slabs; ++s)
+      {
+        global_index[s].resize(slabs[s].points.size());
+        for (size_t p = 0; p < slabs[s].points.size(); ++p)
+          {
+            const auto inserted = edge_points.emplace(slabs[s].edges[p], static_cast<std::int64_t>(surface_points->size()));
+            if (inserted.second)
+              surface_points->emplace_back(slabs[s].points[p]);
+            global_index[s][p] = inserted.first->second;
+          }
+        std::vector<std::pair<std::int64_t, std::int64_t> >().swap(slabs[s].edges);
+        std::vector<std::array<double,4> >().swap(slabs[s].points);
+        first_vertex[s + 1] = first_vertex[s] + slabs[s].connectivity.size();
+      }
+  }
+
+  surface_connectivity->resize(first_vertex[n_slabs]);
+  pool.parallel_for(0, n_slabs, [&] (size_t s)
+  {
+    for (size_t v = 0; v < slabs[s].connectivity.size(); ++v)
+      (*surface_connectivity)[first_vertex[s] + v] = global_index[s][static_cast<size_t>(slabs[s].connectivity[v])];
+  }, 1);
+
+  GridGenerator grid;
+  grid.n_vertices_per_cell = 3;
+  grid.cell_type = 5;
+  grid.n_cells = surface_connectivity->size() / 3;
+  grid.n_points = surface_points->size();
+  grid.point = [=](size_t point, std::array<double,3> &position, double &depth)
+  {
+    const std::array<double,4> &surface_point = (*surface_points)[point];
+    position = {{surface_point[0], surface_point[1], surface_point[2]}};
+    depth = surface_point[3];
+  };
+  grid.cell = [=](size_t cell, std::int64_t *cell_vertices)
+  {
+    std::copy(surface_connectivity->begin() + static_cast<std::ptrdiff_t>(cell * 3),
+              surface_connectivity->begin() + static_cast<std::ptrdiff_t>(cell * 3 + 3),
+              cell_vertices);
+  };
+
+  return grid;
+}
+
+
+/**
+ * Writes the cells [first_cell, last_cell) of the grid and the points they
+ * use into a vtu file, together with the depth, temperature and compositions
+ * of the points. The grid is generated, evaluated and written in chunks of
+ * chunk_size points or cells. The chunks are evaluated in parallel when a
+ * thread pool is provided, and only then the progress is reported, because
+ * pieces which are written by the workers of a pool would mix their output.
+ */
+void write_vtu_piece(const GridGenerator &grid,
+                     const WorldBuilder::World &world,
+                     const size_t dim,
+                     const double gravity,
+                     const size_t compositions,
+                     const size_t first_cell,
+                     const size_t last_cell,
+                     const std::string &filename,
+                     const std::string &vtu_output_format,
+                     const size_t chunk_size,
+                     ThreadPool *pool)
+{
+  WBAssertThrow(chunk_size > 0, "The streaming chunk size may not be equal to zero.");
+
+  auto for_each = [&](size_t begin, size_t end, const std::function<void(size_t)> &function)
+  {
+    if (pool != nullptr)
+      pool->parallel_for(begin, end, function);
+    else
+      for (size_t i = begin; i < end; ++i)
+        function(i);
+  };
+
+  auto report = [&](const std::string &message)
+  {
+    if (pool != nullptr)
+      {
+        std::cout << message << "                              \r";
+        std::cout.flush();
+      }
+  };
+
+  // The points are numbered in layers, so the points of a range of cells are
+  // a range of points as well.
+  size_t first_point = 0;
+  size_t last_point = grid.n_points;
+  if (first_cell != 0 || last_cell != grid.n_cells)
+    {
+      std::vector<std::int64_t> vertices(grid.n_vertices_per_cell);
+      first_point = grid.n_points;
+      last_point = 0;
+      for (size_t i = first_cell; i < last_cell; ++i)
+        {
+          grid.cell(i, vertices.data());
+          for (const std::int64_t vertex : vertices)
+            {
+              first_point = std::min(first_point, static_cast<size_t>(vertex));
+              last_point = std::max(last_point, static_cast<size_t>(vertex) + 1);
+            }
+        }
+    }
+
+  Visualization::StreamingVtuWriter writer(filename, vtu_output_format, last_point - first_point, last_cell - first_cell);
+  std::vector<double> values;
+
+  auto write_point_data = [&](const std::string &name, const std::function<double(const std::array<double,3> &, double)> &evaluate)
+  {
+    report("[5/6] Streaming the paraview file: " + name);
+    writer.begin_array<double>(Visualization::StreamingVtuWriter::Section::point_data, name, 1);
+    for (size_t begin = first_point; begin < last_point; begin += chunk_size)
+      {
+        const size_t end = std::min(begin + chunk_size, last_point);
+        values.resize(end - begin);
+        for_each(begin, end, [&] (size_t i)
+        {
+          std::array<double,3> position;
+          double depth;
+          grid.point(i, position, depth);
+          values[i - begin] = evaluate(position, depth);
+        });
+        writer.append(values);
+      }
+    writer.end_array();
+  };
+
+  write_point_data("Depth", [](const std::array<double,3> &, double depth)
+  {
+    return depth;
+  });
+
+  write_point_data("Temperature", [&](const std::array<double,3> &position, double depth)
+  {
+    if (dim == 2)
+      return world.temperature(std::array<double,2> {{position[0], position[1]}}, depth, gravity);
+    return world.temperature(position, depth, gravity);
+  });
+
+  for (size_t c = 0; c < compositions; ++c)
+    {
+      write_point_data("Composition "+std::to_string(c), [&](const std::array<double,3> &position, double depth)
+      {
+        if (dim == 2)
+          return world.composition(std::array<double,2> {{position[0], position[1]}}, depth, static_cast<unsigned int>(c));
+        return world.composition(position, depth, static_cast<unsigned int>(c));
+      });
+    }
+
+  report("[6/6] Streaming the paraview file: points");
+  writer.begin_array<double>(Visualization::StreamingVtuWriter::Section::points, "", 3);
+  for (size_t begin = first_point; begin < last_point; begin += chunk_size)
+    {
+      const size_t end = std::min(begin + chunk_size, last_point);
+      values.resize((end - begin) * 3);
+      for_each(begin, end, [&] (size_t i)
+      {
+        std::array<double,3> position;
+        double depth;
+        grid.point(i, position, depth);
+        std::copy(position.begin(), position.end(), values.begin() + static_cast<std::ptrdiff_t>((i - begin) * 3));
+      });
+      writer.append(values);
+    }
+  writer.end_array();
+  values = std::vector<double>();
+
+  report("[6/6] Streaming the paraview file: cells");
+  std::vector<vtu11::VtkIndexType> indices;
+  writer.begin_array<vtu11::VtkIndexType>(Visualization::StreamingVtuWriter::Section::cells, "connectivity", 1);
+  for (size_t begin = first_cell; begin < last_cell; begin += chunk_size)
+    {
+      const size_t end = std::min(begin + chunk_size, last_cell);
+      indices.resize((end - begin) * grid.n_vertices_per_cell);
+      for_each(begin, end, [&] (size_t i)
+      {
+        vtu11::VtkIndexType *vertices = &indices[(i - begin) * grid.n_vertices_per_cell];
+        grid.cell(i, vertices);
+        for (size_t v = 0; v < grid.n_vertices_per_cell; ++v)
+          vertices[v] -= static_cast<vtu11::VtkIndexType>(first_point);
+      });
+      writer.append(indices);
+    }
+  writer.end_array();
+
+  writer.begin_array<vtu11::VtkIndexType>(Visualization::StreamingVtuWriter::Section::cells, "offsets", 1);
+  for (size_t begin = 0; begin < last_cell - first_cell; begin += chunk_size)
+    {
+      const size_t end = std::min(begin + chunk_size, last_cell - first_cell);
+      indices.resize(end - begin);
+      for (size_t i = begin; i < end; ++i)
+        indices[i - begin] = static_cast<vtu11::VtkIndexType>((i + 1) * grid.n_vertices_per_cell);
+      writer.append(indices);
+    }
+  writer.end_array();
+
+  writer.begin_array<vtu11::VtkCellType>(Visualization::StreamingVtuWriter::Section::cells, "types", 1);
+  const std::vector<vtu11::VtkCellType> types(std::min(chunk_size, last_cell - first_cell), grid.cell_type);
+  for (size_t begin = 0; begin < last_cell - first_cell; begin += chunk_size)
+    writer.append(types.data(), std::min(chunk_size, last_cell - first_cell - begin));
+  writer.end_array();
+
+  writer.finish();
+}
+
+
+/**
+ * Computes the points [first_point, last_point) and cells [first_cell,
+ * last_cell) of the grid, together with the depth, temperature and
+ * compositions of the points, and writes them into the raw binary files of
+ * the writer. The ranges are divided in chunks of chunk_size points or cells,
+ * and every chunk is computed and written at its own place in the files by
+ * one thread of the pool.
+ */
+void write_raw_binary_range(const GridGenerator &grid,
+                            const WorldBuilder::World &world,
+                            const size_t dim,
+                            const double gravity,
+                            const size_t compositions,
+                            const Visualization::RawBinaryXdmfWriter &writer,
+                            const size_t first_point,
+                            const size_t last_point,
+                            const size_t first_cell,
+                            const size_t last_cell,
+                            const size_t chunk_size,
+                            ThreadPool &pool)
+{
+  WBAssertThrow(chunk_size > 0, "The streaming chunk size may not be equal to zero.");
+
+  const size_t n_point_chunks = (last_point - first_point + chunk_size - 1) / chunk_size;
+  const size_t n_cell_chunks = (last_cell - first_cell + chunk_size - 1) / chunk_size;
+
+  pool.parallel_for(0, n_point_chunks + n_cell_chunks, [&] (size_t chunk)
+  {
+    if (chunk >= n_point_chunks)
+      {
+        const size_t begin = first_cell + (chunk - n_point_chunks) * chunk_size;
+        const size_t end = std::min(begin + chunk_size, last_cell);
+        std::vector<std::int64_t> vertices((end - begin) * grid.n_vertices_per_cell);
+        for (size_t i = begin; i < end; ++i)
+          grid.cell(i, &vertices[(i - begin) * grid.n_vertices_per_cell]);
+        writer.write_cells(begin, vertices);
+        return;
+      }
+
+    const size_t begin = first_point + chunk * chunk_size;
+    const size_t end = std::min(begin + chunk_size, last_point);
+    const size_t n = end - begin;
+
+    // The fields are the depth, the temperature and the compositions.
+    std::vector<double> coordinates(n * 3);
+    std::vector<std::vector<double> > fields(2 + compositions, std::vector<double>(n));
+    for (size_t i = 0; i < n; ++i)
+      {
+        std::array<double,3> position;
+        double depth;
+        grid.point(begin + i, position, depth);
+        std::copy(position.begin(), position.end(), coordinates.begin() + static_cast<std::ptrdiff_t>(i * 3));
+
+        fields[0][i] = depth;
+        if (dim == 2)
+          {
+            const std::array<double,2> position_2d = {{position[0], position[1]}};
+            fields[1][i] = world.temperature(position_2d, depth, gravity);
+            for (size_t c = 0; c < compositions; ++c)
+              fields[2 + c][i] = world.composition(position_2d, depth, static_cast<unsigned int>(c));
+          }
+        else
+          {
+            fields[1][i] = world.temperature(position, depth, gravity);
+            for (size_t c = 0; c < compositions; ++c)
+              fields[2 + c][i] = world.composition(position, depth, static_cast<unsigned int>(c));
+          }
+      }
+
+    writer.write_points(begin, coordinates);
+    for (size_t field = 0; field < fields.size(); ++field)
+      writer.write_field(field, begin, fields[field]);
+  }, 1);
+}
+
+
+/**
+ * Runs the function on the first process only, for example to create the
+ * files which all processes write into, and waits on all processes until it
+ * is done. When the function throws on the first process, its error is sent
+ * to all processes, which all throw it, so no process waits forever for the
+ * first one.
+ */
+void run_on_first_process(const std::function<void()> &function, const int mpi_rank)
+{
+  std::string error;
+  if (mpi_rank == 0)
+    {
+      try
+        {
+          function();
+        }
+      catch (std::exception &e)
+        {
+          error = e.what();
+          if (error.empty())
+            error = "Exception without a message.";
+        }
+      catch (...)
+        {
+          error = "Exception of unknown type.";
+        }
+    }
+
+#ifdef WB_WITH_MPI
+  // The length of the error is zero if the function succeeded.
+  int error_length = static_cast<int>(error.size());
+  MPI_Bcast(&error_length, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (error_length > 0)
+    {
+      error.resize(static_cast<size_t>(error_length));
+      MPI_Bcast(&error[0], error_length, MPI_CHAR, 0, MPI_COMM_WORLD);
+    }
+#endif
+
+  WBAssertThrow(error.empty(), "The first process failed with the error: " << error);
+}
+
+
 std::vector<std::string> get_command_line_options_vector(int argc, char **argv)
 {
   std::vector<std::string> vector;
@@ -295,12 +1343,19 @@ int main(int argc, char **argv)
 
 
   int MPI_RANK = 0;
+  int MPI_SIZE = 1;
 #ifdef WB_WITH_MPI
   MPI_Init(&argc,&argv);
   MPI_Comm_rank(MPI_COMM_WORLD, &MPI_RANK);
+  MPI_Comm_size(MPI_COMM_WORLD, &MPI_SIZE);
 #endif
 
-  if (MPI_RANK ==  0)
+  // When run with multiple processes, every process computes and writes its
+  // own pieces of the grid. Only the first process reports the progress.
+  if (MPI_RANK != 0)
+    std::cout.setstate(std::ios::failbit);
+
+  if (MPI_RANK ==  0 || MPI_SIZE > 1)
     {
       /**
        * Try to start the world builder
@@ -308,10 +1363,17 @@ int main(int argc, char **argv)
       std::cout << "[2/6] Starting the world builder with " << number_of_threads << " threads...                         \r";
       std::cout.flush();
 
+      // All processes create the world together, so only the first process
+      // reads the world builder file.
+      int mpi_communicator = WorldBuilder::Utilities::no_mpi_communicator;
+#ifdef WB_WITH_MPI
+      if (MPI_SIZE > 1)
+        mpi_communicator = MPI_Comm_c2f(MPI_COMM_WORLD);
+#endif
       std::unique_ptr<WorldBuilder::World> world;
       try
         {
-          world = std::make_unique<WorldBuilder::World>(wb_file);
+          world = std::make_unique<WorldBuilder::World>(wb_file, false, "", 1, mpi_communicator, number_of_threads);
         }
       catch (std::exception &e)
         {
@@ -356,1061 +1418,483 @@ int main(int argc, char **argv)
       std::string temp;
 
       while (std::getline(data_stream, temp))
-        {
-          std::istringstream buffer(temp);
-          std::vector<std::string> line((std::istream_iterator<std::string>(buffer)),
-                                        std::istream_iterator<std::string>());
-
-          // remove the comma's in case it is a comma separated file.
-          // TODO: make it split for comma's and/or spaces
-          for (auto &line_i : line)
-            line_i.erase(std::remove(line_i.begin(), line_i.end(), ','), line_i.end());
-
-          data.push_back(line);
-        }
+        data.push_back(split_data_line(temp));
 
       std::string vtu_output_format = "RawBinaryCompressed";
+      std::string output_format = "vtu";
+      bool streaming = false;
+      size_t streaming_chunk_size = 1048576;
+      size_t n_pieces = 1;
+      // When compress_size is false, the cells at the boundaries of the
+      // features get their own points in the output, so that they can be
+      // handled separately from their neighbours in paraview. The boundaries
+      // are found from the compositions only, because the temperature also
+      // changes inside of the features. This is only supported by the
+      // default vtu output which is held in memory.
+      bool compress_size = true;
+      size_t adaptive_refinement_levels = 0;
+      double refinement_temperature_difference = 50;
+      double refinement_composition_difference = 0.5;
+      // parameters of the slices and the isosurface
+      std::array<double,3> plane_origin = {{NaN::DSNAN, NaN::DSNAN, NaN::DSNAN}};
+      std::array<double,3> plane_direction_1 = {{NaN::DSNAN, NaN::DSNAN, NaN::DSNAN}};
+      std::array<double,3> plane_direction_2 = {{NaN::DSNAN, NaN::DSNAN, NaN::DSNAN}};
+      std::array<double,2> great_circle_start = {{NaN::DSNAN, NaN::DSNAN}};
+      std::array<double,2> great_circle_end = {{NaN::DSNAN, NaN::DSNAN}};
+      double shell_depth = NaN::DSNAN;
+      double isosurface_temperature = NaN::DSNAN;
+      std::string isosurface_grid = "cartesian";
       // Read config from data if pressent
       for (auto &line_i : data)
         {
           if (line_i.empty())
-            continue;
-
-          if (line_i[0] == "#")
-            continue;
-
-          if (line_i[0] == "grid_type" && line_i[1] == "=")
-            {
-              grid_type = line_i[2];
-            }
-
-          if (line_i[0] == "dim" && line_i[1] == "=")
-            {
-              dim = string_to_unsigned_int(line_i[2]);
-            }
-
-          if (line_i[0] == "vtu_output_format" && line_i[1] == "=")
-            {
-              vtu_output_format = line_i[2];
-            }
-
-          if (line_i[0] == "compositions" && line_i[1] == "=")
-            compositions = string_to_unsigned_int(line_i[2]);
-
-          if (line_i[0] == "x_min" && line_i[1] == "=")
-            x_min = string_to_double(line_i[2]);
-          if (line_i[0] == "x_max" && line_i[1] == "=")
-            x_max = string_to_double(line_i[2]);
-          if (line_i[0] == "y_min" && line_i[1] == "=")
-            y_min = string_to_double(line_i[2]);
-          if (line_i[0] == "y_max" && line_i[1] == "=")
-            y_max = string_to_double(line_i[2]);
-          if (line_i[0] == "z_min" && line_i[1] == "=")
-            z_min = string_to_double(line_i[2]);
-          if (line_i[0] == "z_max" && line_i[1] == "=")
-            z_max = string_to_double(line_i[2]);
-
-          if (line_i[0] == "n_cell_x" && line_i[1] == "=")
-            n_cell_x = string_to_unsigned_int(line_i[2]);
-          if (line_i[0] == "n_cell_y" && line_i[1] == "=")
-            n_cell_y = string_to_unsigned_int(line_i[2]);
-          if (line_i[0] == "n_cell_z" && line_i[1] == "=")
-            n_cell_z = string_to_unsigned_int(line_i[2]);
-
-        }
-
-      WBAssertThrow(dim == 2 || dim == 3, "dim should be set in the grid file and can only be 2 or 3.");
-
-      WBAssertThrow(!std::isnan(x_min), "x_min is not a number:" << x_min << ". This value has probably not been provided in the grid file.");
-      WBAssertThrow(!std::isnan(x_max), "x_max is not a number:" << x_max << ". This value has probably not been provided in the grid file.");
-      WBAssertThrow(dim == 2 || !std::isnan(y_min), "y_min is not a number:" << y_min << ". This value has probably not been provided in the grid file.");
-      WBAssertThrow(dim == 2 || !std::isnan(y_max), "y_max is not a number:" << y_max << ". This value has probably not been provided in the grid file.");
-      WBAssertThrow(!std::isnan(z_min), "z_min is not a number:" << z_min << ". This value has probably not been provided in the grid file.");
-      WBAssertThrow(!std::isnan(z_max), "z_max is not a number:" << z_max << ". This value has probably not been provided in the grid file.");
-
-
-      WBAssertThrow(n_cell_x != 0, "n_cell_z may not be equal to zero: " << n_cell_x << ".");
-      // int's cannot generally be nan's (see https://stackoverflow.com/questions/3949457/can-an-integer-be-nan-in-c),
-      // but visual studio is giving problems over this, so it is taken out for now.
-      //WBAssertThrow(!std::isnan(n_cell_x), "n_cell_z is not a number:" << n_cell_x << ".");
-
-      WBAssertThrow(dim == 3 || n_cell_z != 0, "In 3d n_cell_z may not be equal to zero: " << n_cell_y << ".");
-      // int's cannot generally be nan's (see https://stackoverflow.com/questions/3949457/can-an-integer-be-nan-in-c),
-      // but visual studio is giving problems over this, so it is taken out for now.
-      //WBAssertThrow(!std::isnan(n_cell_z), "n_cell_z is not a number:" << n_cell_y << ".");
-
-      WBAssertThrow(n_cell_z != 0, "n_cell_z may not be equal to zero: " << n_cell_z << ".");
-      // int's cannot generally be nan's (see https://stackoverflow.com/questions/3949457/can-an-integer-be-nan-in-c),
-      // but visual studio is giving problems over this, so it is taken out for now.
-      //WBAssertThrow(!std::isnan(n_cell_z), "n_cell_z is not a number:" << n_cell_z << ".");
-
-
-
-
-
-      /**
-       * All variables set by the user
-       */
-
-      if (grid_type == "sphere")
-        WBAssert(n_cell_x == n_cell_y, "For the sphere grid the amount of cells in the x (long) and y (lat) direction have to be the same.");
-
-      if (grid_type == "spherical" ||
-          grid_type == "chunk" ||
-          grid_type == "anullus")
-        {
-          x_min *= (const_pi/180);
-          x_max *= (const_pi/180);
-          y_min *= (const_pi/180);
-          y_max *= (const_pi/180);
-        }
-
-
-
-      /**
-       * All variables needed for the visualization
-       */
-      size_t n_cell = NaN::ISNAN;
-      size_t n_p = NaN::ISNAN;
-
-      std::vector<double> grid_x(0);
-      std::vector<double> grid_y(0);
-      std::vector<double> grid_z(0);
-      std::vector<double> grid_depth(0);
-
-      std::vector<std::vector<size_t> > grid_connectivity(0);
-
-
-      bool compress_size = true;
-
-
-
-
-      /**
-       * Begin making the grid
-       */
-      std::cout << "[4/6] Building the grid...                        \r";
-      std::cout.flush();
-      WBAssertThrow(dim == 2 || dim == 3, "Dimension should be 2d or 3d.");
-      if (grid_type == "cartesian")
-        {
-          n_cell = n_cell_x * n_cell_z * (dim == 3 ? n_cell_y : 1);
-          if (!compress_size && dim == 3)
-            n_p = n_cell * 8 ; // it shouldn't matter for 2d in the output, so just do 3d.
-          else
-            n_p = (n_cell_x + 1) * (n_cell_z + 1) * (dim == 3 ? (n_cell_y + 1) : 1);
-
-
-          double dx = (x_max - x_min) / static_cast<double>(n_cell_x);
-          double dy = (y_max - y_min) / static_cast<double>(n_cell_y);
-          double dz = (z_max - z_min) / static_cast<double>(n_cell_z);
-
-
-          WBAssertThrow(!std::isnan(dx), "dz is not a number:" << dz << ".");
-          WBAssertThrow(dim == 2 || !std::isnan(dy), "dz is not a number:" << dz << ".");
-          WBAssertThrow(!std::isnan(dz), "dz is not a number:" << dz << ".");
-
-          // todo: determine wheter a input variable is desirable for this.
-          double surface = z_max;
-
-          grid_x.resize(n_p);
-          grid_z.resize(n_p);
-
-          if (dim == 3)
-            grid_y.resize(n_p);
-
-          grid_depth.resize(n_p);
-
-          // compute positions
-          size_t counter = 0;
-          if (dim == 2)
-            {
-              for (size_t j = 0; j <= n_cell_z; ++j)
-                {
-                  for (size_t i = 0; i <= n_cell_x; ++i)
-                    {
-                      grid_x[counter] = x_min + static_cast<double>(i) * dx;
-                      grid_z[counter] = z_min + static_cast<double>(j) * dz;
-                      grid_depth[counter] = (surface - z_min) - static_cast<double>(j) * dz;
-                      counter++;
-                    }
-                }
-            }
-          else
-            {
-              if (compress_size)
-                {
-                  for (size_t i = 0; i <= n_cell_x; ++i)
-                    {
-                      for (size_t j = 0; j <= n_cell_y; ++j)
-                        {
-                          for (size_t k = 0; k <= n_cell_z; ++k)
-                            {
-                              grid_x[counter] = x_min + static_cast<double>(i) * dx;
-                              grid_y[counter] = y_min + static_cast<double>(j) * dy;
-                              grid_z[counter] = z_min + static_cast<double>(k) * dz;
-                              grid_depth[counter] = (surface - z_min) - static_cast<double>(k) * dz;
-                              counter++;
-                            }
-                        }
-                    }
-                }
-              else
-                {
-                  for (size_t i = 0; i < n_cell_x; ++i)
-                    {
-                      for (size_t j = 0; j < n_cell_y; ++j)
-                        {
-                          for (size_t k = 0; k < n_cell_z; ++k)
-                            {
-                              // position is defined by the vtk file format
-                              // position 0 of this cell
-                              grid_x[counter] = x_min + static_cast<double>(i) * dx;
-                              grid_y[counter] = y_min + static_cast<double>(j) * dy;
-                              grid_z[counter] = z_min + static_cast<double>(k) * dz;
-                              grid_depth[counter] = (surface - z_min) - static_cast<double>(k) * dz;
-                              counter++;
-                              // position 1 of this cell
-                              grid_x[counter] = x_min + (static_cast<double>(i) + 1.0) * dx;
-                              grid_y[counter] = y_min + static_cast<double>(j) * dy;
-                              grid_z[counter] = z_min + static_cast<double>(k) * dz;
-                              grid_depth[counter] = (surface - z_min) - static_cast<double>(k) * dz;
-                              counter++;
-                              // position 2 of this cell
-                              grid_x[counter] = x_min + (static_cast<double>(i) + 1.0) * dx;
-                              grid_y[counter] = y_min + (static_cast<double>(j) + 1.0) * dy;
-                              grid_z[counter] = z_min + static_cast<double>(k) * dz;
-                              grid_depth[counter] = (surface - z_min) - static_cast<double>(k) * dz;
-                              counter++;
-                              // position 3 of this cell
-                              grid_x[counter] = x_min + static_cast<double>(i) * dx;
-                              grid_y[counter] = y_min + (static_cast<double>(j) + 1.0) * dy;
-                              grid_z[counter] = z_min + static_cast<double>(k) * dz;
-                              grid_depth[counter] = (surface - z_min) - static_cast<double>(k) * dz;
-                              counter++;
-                              // position 0 of this cell
-                              grid_x[counter] = x_min + static_cast<double>(i) * dx;
-                              grid_y[counter] = y_min + static_cast<double>(j) * dy;
-                              grid_z[counter] = z_min + (static_cast<double>(k) + 1.0) * dz;
-                              grid_depth[counter] = (surface - z_min) - (static_cast<double>(k) + 1.0) * dz;
-                              counter++;
-                              // position 1 of this cell
-                              grid_x[counter] = x_min + (static_cast<double>(i) + 1.0) * dx;
-                              grid_y[counter] = y_min + static_cast<double>(j) * dy;
-                              grid_z[counter] = z_min + (static_cast<double>(k) + 1.0) * dz;
-                              grid_depth[counter] = (surface - z_min) - (static_cast<double>(k) + 1.0) * dz;
-                              counter++;
-                              // position 2 of this cell
-                              grid_x[counter] = x_min + (static_cast<double>(i) + 1.0) * dx;
-                              grid_y[counter] = y_min + (static_cast<double>(j) + 1.0) * dy;
-                              grid_z[counter] = z_min + (static_cast<double>(k) + 1.0) * dz;
-                              grid_depth[counter] = (surface - z_min) - (static_cast<double>(k) + 1.0) * dz;
-                              counter++;
-                              // position 3 of this cell
-                              grid_x[counter] = x_min + static_cast<double>(i) * dx;
-                              grid_y[counter] = y_min + (static_cast<double>(j) + 1.0) * dy;
-                              grid_z[counter] = z_min + (static_cast<double>(k) + 1.0) * dz;
-                              grid_depth[counter] = (surface - z_min) - (static_cast<double>(k) + 1.0) * dz;
-                              WBAssert(counter < n_p, "Assert counter smaller then n_P: counter = " << counter << ", n_p = " << n_p);
-                              counter++;
-                            }
-                        }
-                    }
-                }
-            }
-
-          // compute connectivity. Local to global mapping.
-          grid_connectivity.resize(n_cell,std::vector<size_t>((dim-1)*4));
-
-          counter = 0;
-          if (dim == 2)
-            {
-              for (size_t j = 1; j <= n_cell_z; ++j)
-                {
-                  for (size_t i = 1; i <= n_cell_x; ++i)
-                    {
-                      grid_connectivity[counter][0] = i + (j - 1) * (n_cell_x + 1) - 1;
-                      grid_connectivity[counter][1] = i + 1 + (j - 1) * (n_cell_x + 1) - 1;
-                      grid_connectivity[counter][2] = i + 1  + j * (n_cell_x + 1) - 1;
-                      grid_connectivity[counter][3] = i + j * (n_cell_x + 1) - 1;
-                      counter++;
-                    }
-                }
-            }
-          else
-            {
-              if (compress_size)
-                {
-                  for (size_t i = 1; i <= n_cell_x; ++i)
-                    {
-                      for (size_t j = 1; j <= n_cell_y; ++j)
-                        {
-                          for (size_t k = 1; k <= n_cell_z; ++k)
-                            {
-                              grid_connectivity[counter][0] = (n_cell_y + 1) * (n_cell_z + 1) * (i - 1) + (n_cell_z + 1) * (j - 1) + k - 1;
-                              grid_connectivity[counter][1] = (n_cell_y + 1) * (n_cell_z + 1) * (i    ) + (n_cell_z + 1) * (j - 1) + k - 1;
-                              grid_connectivity[counter][2] = (n_cell_y + 1) * (n_cell_z + 1) * (i    ) + (n_cell_z + 1) * (j    ) + k - 1;
-                              grid_connectivity[counter][3] = (n_cell_y + 1) * (n_cell_z + 1) * (i - 1) + (n_cell_z + 1) * (j    ) + k - 1;
-                              grid_connectivity[counter][4] = (n_cell_y + 1) * (n_cell_z + 1) * (i - 1) + (n_cell_z + 1) * (j - 1) + k;
-                              grid_connectivity[counter][5] = (n_cell_y + 1) * (n_cell_z + 1) * (i    ) + (n_cell_z + 1) * (j - 1) + k;
-                              grid_connectivity[counter][6] = (n_cell_y + 1) * (n_cell_z + 1) * (i    ) + (n_cell_z + 1) * (j    ) + k;
-                              grid_connectivity[counter][7] = (n_cell_y + 1) * (n_cell_z + 1) * (i - 1) + (n_cell_z + 1) * (j    ) + k;
-                              counter++;
-                            }
-                        }
-                    }
-                }
-              else
-                {
-                  for (size_t i = 0; i < n_cell; ++i)
-                    {
-                      grid_connectivity[i][0] = counter;
-                      grid_connectivity[i][1] = counter + 1;
-                      grid_connectivity[i][2] = counter + 2;
-                      grid_connectivity[i][3] = counter + 3;
-                      grid_connectivity[i][4] = counter + 4;
-                      grid_connectivity[i][5] = counter + 5;
-                      grid_connectivity[i][6] = counter + 6;
-                      grid_connectivity[i][7] = counter + 7;
-                      counter = counter + 8;
-                    }
-                }
-            }
-        }
-      else if (grid_type == "annulus")
-        {
-          /**
-           * An annulus which is a 2d hollow sphere.
-           * TODO: make it so you can determine your own cross section.
-           */
-          WBAssertThrow(dim == 2, "The annulus only works in 2d.");
-
-
-          double inner_radius = z_min;
-          double outer_radius = z_max;
-
-          double l_outer = 2.0 * const_pi * outer_radius;
-
-          double lr = outer_radius - inner_radius;
-          double dr = lr / static_cast<double>(n_cell_z);
-
-          size_t n_cell_t = static_cast<size_t>((2.0 * const_pi * outer_radius)/dr);
-
-          // compute the ammount of cells
-          n_cell = n_cell_t *n_cell_z;
-          n_p = n_cell_t *(n_cell_z + 1);  // one less then cartesian because two cells overlap.
-
-          double sx = l_outer / static_cast<double>(n_cell_t);
-          double sz = dr;
-
-          grid_x.resize(n_p);
-          grid_z.resize(n_p);
-          grid_depth.resize(n_p);
-
-          size_t counter = 0;
-          for (size_t j = 0; j <= n_cell_z; ++j)
-            {
-              for (size_t i = 1; i <= n_cell_t; ++i)
-                {
-                  grid_x[counter] = (static_cast<double>(i) - 1.0) * sx;
-                  grid_z[counter] = static_cast<double>(j) * sz;
-                  counter++;
-                }
-            }
-
-          counter = 0;
-          for (size_t j = 1; j <= n_cell_z+1; ++j)
-            {
-              for (size_t i = 1; i <= n_cell_t; ++i)
-                {
-                  double xi = grid_x[counter];
-                  double zi = grid_z[counter];
-                  double theta = xi / l_outer * 2.0 * const_pi;
-                  grid_x[counter] = std::cos(theta) * (inner_radius + zi);
-                  grid_z[counter] = std::sin(theta) * (inner_radius + zi);
-                  grid_depth[counter] = outer_radius - std::sqrt(grid_x[counter] * grid_x[counter] + grid_z[counter] * grid_z [counter]);
-                  counter++;
-                }
-            }
-
-          grid_connectivity.resize(n_cell,std::vector<size_t>(4));
-          counter = 0;
-          for (size_t j = 1; j <= n_cell_z; ++j)
-            {
-              for (size_t i = 1; i <= n_cell_t; ++i)
-                {
-                  std::vector<size_t> cell_connectivity(4);
-                  cell_connectivity[0] = counter + 1;
-                  cell_connectivity[1] = counter + 1 + 1;
-                  cell_connectivity[2] = i + j * n_cell_t + 1;
-                  cell_connectivity[3] = i + j * n_cell_t;
-                  if (i == n_cell_t)
-                    {
-                      cell_connectivity[1] = cell_connectivity[1] - n_cell_t;
-                      cell_connectivity[2] = cell_connectivity[2] - n_cell_t;
-                    }
-                  grid_connectivity[counter][0] = cell_connectivity[1] - 1;
-                  grid_connectivity[counter][1] = cell_connectivity[0] - 1;
-                  grid_connectivity[counter][2] = cell_connectivity[3] - 1;
-                  grid_connectivity[counter][3] = cell_connectivity[2] - 1;
-                  counter++;
-                }
-            }
-        }
-      else if (grid_type == "chunk")
-        {
-          double inner_radius = z_min;
-          double outer_radius = z_max;
-
-          WBAssertThrow(x_min <= x_max, "The minimum longitude must be less than the maximum longitude.");
-          WBAssertThrow(y_min <= y_max, "The minimum latitude must be less than the maximum latitude.");
-          WBAssertThrow(inner_radius < outer_radius, "The inner radius must be less than the outer radius.");
-
-          WBAssertThrow(x_min - x_max <= 2.0 * const_pi, "The difference between the minimum and maximum longitude "
-                        " must be less than or equal to 360 degree.");
-
-          WBAssertThrow(y_min >= - 0.5 * const_pi, "The minimum latitude must be larger then or equal to -90 degree.");
-          WBAssertThrow(y_min <= 0.5 * const_pi, "The maximum latitude must be smaller then or equal to 90 degree.");
-
-          double opening_angle_long_rad = (x_max - x_min);
-          double opening_angle_lat_rad =  (y_max - y_min);
-
-          n_cell = n_cell_x * n_cell_z * (dim == 3 ? n_cell_y : 1);
-          if (!compress_size && dim == 3)
-            n_p = n_cell * 8 ; // it shouldn't matter for 2d in the output, so just do 3d.
-          else
-            n_p = (n_cell_x + 1) * (n_cell_z + 1) * (dim == 3 ? (n_cell_y + 1) : 1);
-
-          double dlong = opening_angle_long_rad / static_cast<double>(n_cell_x);
-          double dlat = opening_angle_lat_rad / static_cast<double>(n_cell_y);
-          double lr = outer_radius - inner_radius;
-          double dr = lr / static_cast<double>(n_cell_z);
-
-          grid_x.resize(n_p);
-          grid_y.resize(dim == 3 ? n_p : 0);
-          grid_z.resize(n_p);
-          grid_depth.resize(n_p);
-
-          std::cout << "[4/6] Building the grid: stage 1 of 3                        \r";
-          std::cout.flush();
-          size_t counter = 0;
-          if (dim == 2)
-            {
-              for (size_t i = 1; i <= n_cell_x + 1; ++i)
-                for (size_t j = 1; j <= n_cell_z + 1; ++j)
-                  {
-                    grid_x[counter] = x_min + (static_cast<double>(i) - 1.0) * dlong;
-                    grid_z[counter] = inner_radius + (static_cast<double>(j) - 1.0) * dr;
-                    grid_depth[counter] = lr - (static_cast<double>(j) - 1.0) * dr;
-                    counter++;
-                  }
-            }
-          else
-            {
-              if (compress_size)
-                {
-                  for (size_t i = 1; i <= n_cell_x + 1; ++i)
-                    for (size_t j = 1; j <= n_cell_y + 1; ++j)
-                      for (size_t k = 1; k <= n_cell_z + 1; ++k)
-                        {
-                          grid_x[counter] = x_min + (static_cast<double>(i) - 1.0) * dlong;
-                          grid_y[counter] = y_min + (static_cast<double>(j) - 1.0) * dlat;
-                          grid_z[counter] = inner_radius + (static_cast<double>(k) - 1.0) * dr;
-                          grid_depth[counter] = lr - (static_cast<double>(k) - 1.0) * dr;
-                          counter++;
-                        }
-                }
-              else
-                {
-                  for (size_t i = 0; i < n_cell_x; ++i)
-                    {
-                      for (size_t j = 0; j < n_cell_y; ++j)
-                        {
-                          for (size_t k = 0; k < n_cell_z; ++k)
-                            {
-                              // position is defined by the vtk file format
-                              // position 0 of this cell
-                              grid_x[counter] = x_min + static_cast<double>(i) * dlong;
-                              grid_y[counter] = y_min + static_cast<double>(j) * dlat;
-                              grid_z[counter] = inner_radius + static_cast<double>(k) * dr;
-                              grid_depth[counter] = lr - static_cast<double>(k) * dr;
-                              counter++;
-                              // position 1 of this cell
-                              grid_x[counter] = x_min + (static_cast<double>(i) + 1.0) * dlong;
-                              grid_y[counter] = y_min + static_cast<double>(j) * dlat;
-                              grid_z[counter] = inner_radius + static_cast<double>(k) * dr;
-                              grid_depth[counter] = lr - static_cast<double>(k) * dr;
-                              counter++;
-                              // position 2 of this cell
-                              grid_x[counter] = x_min + (static_cast<double>(i) + 1.0) * dlong;
-                              grid_y[counter] = y_min + (static_cast<double>(j) + 1.0) * dlat;
-                              grid_z[counter] = inner_radius + static_cast<double>(k) * dr;
-                              grid_depth[counter] = lr - static_cast<double>(k) * dr;
-                              counter++;
-                              // position 3 of this cell
-                              grid_x[counter] = x_min + static_cast<double>(i) * dlong;
-                              grid_y[counter] = y_min + (static_cast<double>(j) + 1.0) * dlat;
-                              grid_z[counter] = inner_radius + static_cast<double>(k) * dr;
-                              grid_depth[counter] = lr - static_cast<double>(k) * dr;
-                              counter++;
-                              // position 0 of this cell
-                              grid_x[counter] = x_min + static_cast<double>(i) * dlong;
-                              grid_y[counter] = y_min + static_cast<double>(j) * dlat;
-                              grid_z[counter] = inner_radius + (static_cast<double>(k) + 1.0) * dr;
-                              grid_depth[counter] = lr - (static_cast<double>(k) + 1.0) * dr;
-                              counter++;
-                              // position 1 of this cell
-                              grid_x[counter] = x_min + (static_cast<double>(i) + 1.0) * dlong;
-                              grid_y[counter] = y_min + static_cast<double>(j) * dlat;
-                              grid_z[counter] = inner_radius + (static_cast<double>(k) + 1.0) * dr;
-                              grid_depth[counter] = lr - (static_cast<double>(k) + 1.0) * dr;
-                              counter++;
-                              // position 2 of this cell
-                              grid_x[counter] = x_min + (static_cast<double>(i) + 1.0) * dlong;
-                              grid_y[counter] = y_min + (static_cast<double>(j) + 1.0) * dlat;
-                              grid_z[counter] = inner_radius + (static_cast<double>(k) + 1.0) * dr;
-                              grid_depth[counter] = lr - (static_cast<double>(k) + 1.0) * dr;
-                              counter++;
-                              // position 3 of this cell
-                              grid_x[counter] = x_min + static_cast<double>(i) * dlong;
-                              grid_y[counter] = y_min + (static_cast<double>(j) + 1.0) * dlat;
-                              grid_z[counter] = inner_radius + (static_cast<double>(k) + 1.0) * dr;
-                              grid_depth[counter] = lr - (static_cast<double>(k) + 1.0) * dr;
-                              WBAssert(counter < n_p, "Assert counter smaller then n_P: counter = " << counter << ", n_p = " << n_p);
-                              counter++;
-                            }
-                        }
-                    }
-                }
-            }
-
-          std::cout << "[4/6] Building the grid: stage 2 of 3                        \r";
-          std::cout.flush();
-          if (dim == 2)
-            {
-              for (size_t i = 0; i < n_p; ++i)
-                {
+            continue;
 
-                  double longitude = grid_x[i];
-                  double radius = grid_z[i];
+          if (line_i[0] == "#")
+            continue;
 
-                  grid_x[i] = radius * std::cos(longitude);
-                  grid_z[i] = radius * std::sin(longitude);
-                }
-            }
-          else
+          if (line_i[0] == "grid_type" && line_i[1] == "=")
             {
-              for (size_t i = 0; i < n_p; ++i)
-                {
-
-                  double longitude = grid_x[i];
-                  double latitutde = grid_y[i];
-                  double radius = grid_z[i];
-
-                  grid_x[i] = radius * std::cos(latitutde) * std::cos(longitude);
-                  grid_y[i] = radius * std::cos(latitutde) * std::sin(longitude);
-                  grid_z[i] = radius * std::sin(latitutde);
-                }
+              grid_type = line_i[2];
             }
-          std::cout << "[4/6] Building the grid: stage 3 of 3                        \r";
-          std::cout.flush();
-          // compute connectivity. Local to global mapping.
-          grid_connectivity.resize(n_cell,std::vector<size_t>((dim-1)*4));
 
-          counter = 0;
-          if (dim == 2)
+          if (line_i[0] == "dim" && line_i[1] == "=")
             {
-              for (size_t i = 1; i <= n_cell_x; ++i)
-                {
-                  for (size_t j = 1; j <= n_cell_z; ++j)
-                    {
-                      grid_connectivity[counter][0] = (n_cell_z + 1) * (i - 1) + j - 1;
-                      grid_connectivity[counter][1] = (n_cell_z + 1) * (i - 1) + j;
-                      grid_connectivity[counter][2] = (n_cell_z + 1) * (i    ) + j;
-                      grid_connectivity[counter][3] = (n_cell_z + 1) * (i    ) + j - 1;
-
-                      counter = counter+1;
-                      std::cout << "[4/6] Building the grid: stage 3 of 3 [" << (static_cast<double>(i)/static_cast<double>(n_cell))*100.0 << "%]                       \r";
-                      std::cout.flush();
-                    }
-                }
+              dim = string_to_unsigned_int(line_i[2]);
             }
-          else
+
+          if (line_i[0] == "vtu_output_format" && line_i[1] == "=")
             {
-              if (compress_size)
-                {
-                  for (size_t i = 1; i <= n_cell_x; ++i)
-                    {
-                      for (size_t j = 1; j <= n_cell_y; ++j)
-                        {
-                          for (size_t k = 1; k <= n_cell_z; ++k)
-                            {
-                              grid_connectivity[counter][0] = (n_cell_y + 1) * (n_cell_z + 1) * (i - 1) + (n_cell_z + 1) * (j - 1) + k - 1;
-                              grid_connectivity[counter][1] = (n_cell_y + 1) * (n_cell_z + 1) * (i    ) + (n_cell_z + 1) * (j - 1) + k - 1;
-                              grid_connectivity[counter][2] = (n_cell_y + 1) * (n_cell_z + 1) * (i    ) + (n_cell_z + 1) * (j    ) + k - 1;
-                              grid_connectivity[counter][3] = (n_cell_y + 1) * (n_cell_z + 1) * (i - 1) + (n_cell_z + 1) * (j    ) + k - 1;
-                              grid_connectivity[counter][4] = (n_cell_y + 1) * (n_cell_z + 1) * (i - 1) + (n_cell_z + 1) * (j - 1) + k;
-                              grid_connectivity[counter][5] = (n_cell_y + 1) * (n_cell_z + 1) * (i    ) + (n_cell_z + 1) * (j - 1) + k;
-                              grid_connectivity[counter][6] = (n_cell_y + 1) * (n_cell_z + 1) * (i    ) + (n_cell_z + 1) * (j    ) + k;
-                              grid_connectivity[counter][7] = (n_cell_y + 1) * (n_cell_z + 1) * (i - 1) + (n_cell_z + 1) * (j    ) + k;
-                              counter++;
-                            }
-                        }
-                    }
-                }
-              else
-                {
-                  for (size_t i = 0; i < n_cell; ++i)
-                    {
-                      grid_connectivity[i][0] = counter;
-                      grid_connectivity[i][1] = counter + 1;
-                      grid_connectivity[i][2] = counter + 2;
-                      grid_connectivity[i][3] = counter + 3;
-                      grid_connectivity[i][4] = counter + 4;
-                      grid_connectivity[i][5] = counter + 5;
-                      grid_connectivity[i][6] = counter + 6;
-                      grid_connectivity[i][7] = counter + 7;
-                      counter = counter + 8;
-                      std::cout << "[4/6] Building the grid: stage 3 of 3 [" << (static_cast<double>(i)/static_cast<double>(n_cell))*100.0 << "%]                       \r";
-                      std::cout.flush();
-                    }
-                }
+              vtu_output_format = line_i[2];
             }
-        }
-      else if (grid_type == "sphere")
-        {
 
-          WBAssertThrow(dim == 3, "The sphere only works in 3d.");
+          if (line_i[0] == "output_format" && line_i[1] == "=")
+            output_format = line_i[2];
 
+          if (line_i[0] == "streaming" && line_i[1] == "=")
+            streaming = line_i[2] == "true";
 
-          double inner_radius = z_min;
-          double outer_radius = z_max;
+          if (line_i[0] == "streaming_chunk_size" && line_i[1] == "=")
+            streaming_chunk_size = string_to_unsigned_int(line_i[2]);
 
-          size_t n_block = 12;
+          if (line_i[0] == "n_pieces" && line_i[1] == "=")
+            n_pieces = string_to_unsigned_int(line_i[2]);
 
-          size_t block_n_cell = n_cell_x*n_cell_x;
-          size_t block_n_p = (n_cell_x + 1) * (n_cell_x + 1);
-          size_t block_n_v = 4;
+          if (line_i[0] == "compress_size" && line_i[1] == "=")
+            compress_size = line_i[2] != "false";
 
+          if (line_i[0] == "adaptive_refinement_levels" && line_i[1] == "=")
+            adaptive_refinement_levels = string_to_unsigned_int(line_i[2]);
 
-          std::vector<std::vector<double> > block_grid_x(n_block,std::vector<double>(block_n_p));
-          std::vector<std::vector<double> > block_grid_y(n_block,std::vector<double>(block_n_p));
-          std::vector<std::vector<double> > block_grid_z(n_block,std::vector<double>(block_n_p));
-          std::vector<std::vector<std::vector<size_t> > > block_grid_connectivity(n_block,std::vector<std::vector<size_t> >(block_n_cell,std::vector<size_t>(block_n_v)));
-          std::vector<std::vector<bool> > block_grid_hull(n_block,std::vector<bool>(block_n_p));
+          if (line_i[0] == "refinement_temperature_difference" && line_i[1] == "=")
+            refinement_temperature_difference = string_to_double(line_i[2]);
 
-          /**
-           * block node layout
-           */
-          for (size_t i_block = 0; i_block < n_block; ++i_block)
-            {
-              size_t block_n_cell_x = n_cell_x;
-              size_t block_n_cell_y = n_cell_x;
-              double Lx = 1.0;
-              double Ly = 1.0;
+          if (line_i[0] == "refinement_composition_difference" && line_i[1] == "=")
+            refinement_composition_difference = string_to_double(line_i[2]);
 
-              size_t counter = 0;
-              for (size_t j = 0; j <= block_n_cell_y; ++j)
-                {
-                  for (size_t i = 0; i <= block_n_cell_y; ++i)
-                    {
-                      block_grid_x[i_block][counter] = static_cast<double>(i) * Lx / static_cast<double>(block_n_cell_x);
-                      block_grid_y[i_block][counter] = static_cast<double>(j) * Ly / static_cast<double>(block_n_cell_y);
-                      block_grid_z[i_block][counter] = 0.0;
-                      counter++;
-                    }
-                }
+          if (line_i[0] == "plane_origin" && line_i[1] == "=" && line_i.size() >= 5)
+            plane_origin = {{string_to_double(line_i[2]), string_to_double(line_i[3]), string_to_double(line_i[4])}};
+          if (line_i[0] == "plane_direction_1" && line_i[1] == "=" && line_i.size() >= 5)
+            plane_direction_1 = {{string_to_double(line_i[2]), string_to_double(line_i[3]), string_to_double(line_i[4])}};
+          if (line_i[0] == "plane_direction_2" && line_i[1] == "=" && line_i.size() >= 5)
+            plane_direction_2 = {{string_to_double(line_i[2]), string_to_double(line_i[3]), string_to_double(line_i[4])}};
+          if (line_i[0] == "great_circle_start" && line_i[1] == "=" && line_i.size() >= 4)
+            great_circle_start = {{string_to_double(line_i[2]) * (const_pi/180), string_to_double(line_i[3]) * (const_pi/180)}};
+          if (line_i[0] == "great_circle_end" && line_i[1] == "=" && line_i.size() >= 4)
+            great_circle_end = {{string_to_double(line_i[2]) * (const_pi/180), string_to_double(line_i[3]) * (const_pi/180)}};
+          if (line_i[0] == "shell_depth" && line_i[1] == "=")
+            shell_depth = string_to_double(line_i[2]);
+          if (line_i[0] == "isosurface_temperature" && line_i[1] == "=")
+            isosurface_temperature = string_to_double(line_i[2]);
+          if (line_i[0] == "isosurface_grid" && line_i[1] == "=")
+            isosurface_grid = line_i[2];
 
-              counter = 0;
-              // using i=1 and j=1 here because i an j are not used in lookup and storage
-              // so the code can remain very similar to ghost and the cartesian code.
-              for (size_t j = 1; j <= block_n_cell_y; ++j)
-                {
-                  for (size_t i = 1; i <= block_n_cell_x; ++i)
-                    {
-                      block_grid_connectivity[i_block][counter][0] = i + (j - 1) * (block_n_cell_x + 1) - 1;
-                      block_grid_connectivity[i_block][counter][1] = i + 1 + (j - 1) * (block_n_cell_x + 1) - 1;
-                      block_grid_connectivity[i_block][counter][2] = i + 1  + j * (block_n_cell_x + 1) - 1;
-                      block_grid_connectivity[i_block][counter][3] = i + j * (block_n_cell_x + 1) - 1;
-                      counter++;
-                    }
-                }
-            }
+          if (line_i[0] == "compositions" && line_i[1] == "=")
+            compositions = string_to_unsigned_int(line_i[2]);
 
-          /**
-           * map blocks
-           */
-          double radius = 1;
-
-          // four corners
-          double xA = -1.0;
-          double yA = 0.0;
-          double zA = -1.0 / std::sqrt(2.0);
-
-          double xB = 1.0;
-          double yB = 0.0;
-          double zB = -1.0 / std::sqrt(2.0);
-
-          double xC = 0.0;
-          double yC = -1.0;
-          double zC = 1.0 / std::sqrt(2.0);
-
-          double xD = 0.0;
-          double yD = 1.0;
-          double zD = 1.0 / std::sqrt(2.0);
-
-          // middles of faces
-          double xM = (xA+xB+xC)/3.0;
-          double yM = (yA+yB+yC)/3.0;
-          double zM = (zA+zB+zC)/3.0;
-
-          double xN = (xA+xD+xC)/3.0;
-          double yN = (yA+yD+yC)/3.0;
-          double zN = (zA+zD+zC)/3.0;
-
-          double xP = (xA+xD+xB)/3.0;
-          double yP = (yA+yD+yB)/3.0;
-          double zP = (zA+zD+zB)/3.0;
-
-          double xQ = (xC+xD+xB)/3.0;
-          double yQ = (yC+yD+yB)/3.0;
-          double zQ = (zC+zD+zB)/3.0;
-
-          // middle of edges
-          double xF = (xB+xC)/2.0;
-          double yF = (yB+yC)/2.0;
-          double zF = (zB+zC)/2.0;
-
-          double xG = (xA+xC)/2.0;
-          double yG = (yA+yC)/2.0;
-          double zG = (zA+zC)/2.0;
-
-          double xE = (xB+xA)/2.0;
-          double yE = (yB+yA)/2.0;
-          double zE = (zB+zA)/2.0;
-
-          double xH = (xD+xC)/2.0;
-          double yH = (yD+yC)/2.0;
-          double zH = (zD+zC)/2.0;
-
-          double xJ = (xD+xA)/2.0;
-          double yJ = (yD+yA)/2.0;
-          double zJ = (zD+zA)/2.0;
-
-          double xK = (xD+xB)/2.0;
-          double yK = (yD+yB)/2.0;
-          double zK = (zD+zB)/2.0;
-
-          // Making sure points A..Q are on a sphere
-          project_on_sphere(radius,xA,yA,zA);
-          project_on_sphere(radius,xB,yB,zB);
-          project_on_sphere(radius,xC,yC,zC);
-          project_on_sphere(radius,xD,yD,zD);
-          project_on_sphere(radius,xE,yE,zE);
-          project_on_sphere(radius,xF,yF,zF);
-          project_on_sphere(radius,xG,yG,zG);
-          project_on_sphere(radius,xH,yH,zH);
-          project_on_sphere(radius,xJ,yJ,zJ);
-          project_on_sphere(radius,xK,yK,zK);
-          project_on_sphere(radius,xM,yM,zM);
-          project_on_sphere(radius,xN,yN,zN);
-          project_on_sphere(radius,xP,yP,zP);
-          project_on_sphere(radius,xQ,yQ,zQ);
-
-          lay_points(xM,yM,zM,xG,yG,zG,xA,yA,zA,xE,yE,zE,block_grid_x[0], block_grid_y[0], block_grid_z[0],block_grid_hull[0], n_cell_x);
-          lay_points(xF,yF,zF,xM,yM,zM,xE,yE,zE,xB,yB,zB,block_grid_x[1], block_grid_y[1], block_grid_z[1],block_grid_hull[1], n_cell_x);
-          lay_points(xC,yC,zC,xG,yG,zG,xM,yM,zM,xF,yF,zF,block_grid_x[2], block_grid_y[2], block_grid_z[2],block_grid_hull[2], n_cell_x);
-          lay_points(xG,yG,zG,xN,yN,zN,xJ,yJ,zJ,xA,yA,zA,block_grid_x[3], block_grid_y[3], block_grid_z[3],block_grid_hull[3], n_cell_x);
-          lay_points(xC,yC,zC,xH,yH,zH,xN,yN,zN,xG,yG,zG,block_grid_x[4], block_grid_y[4], block_grid_z[4],block_grid_hull[4], n_cell_x);
-          lay_points(xH,yH,zH,xD,yD,zD,xJ,yJ,zJ,xN,yN,zN,block_grid_x[5], block_grid_y[5], block_grid_z[5],block_grid_hull[5], n_cell_x);
-          lay_points(xA,yA,zA,xJ,yJ,zJ,xP,yP,zP,xE,yE,zE,block_grid_x[6], block_grid_y[6], block_grid_z[6],block_grid_hull[6], n_cell_x);
-          lay_points(xJ,yJ,zJ,xD,yD,zD,xK,yK,zK,xP,yP,zP,block_grid_x[7], block_grid_y[7], block_grid_z[7],block_grid_hull[7], n_cell_x);
-          lay_points(xP,yP,zP,xK,yK,zK,xB,yB,zB,xE,yE,zE,block_grid_x[8], block_grid_y[8], block_grid_z[8],block_grid_hull[8], n_cell_x);
-          lay_points(xQ,yQ,zQ,xK,yK,zK,xD,yD,zD,xH,yH,zH,block_grid_x[9], block_grid_y[9], block_grid_z[9],block_grid_hull[9], n_cell_x);
-          lay_points(xQ,yQ,zQ,xH,yH,zH,xC,yC,zC,xF,yF,zF,block_grid_x[10], block_grid_y[10], block_grid_z[10],block_grid_hull[10], n_cell_x);
-          lay_points(xQ,yQ,zQ,xF,yF,zF,xB,yB,zB,xK,yK,zK,block_grid_x[11], block_grid_y[11], block_grid_z[11],block_grid_hull[11], n_cell_x);
-
-          // make sure all points end up on a sphere
-          for (size_t i_block = 0; i_block < n_block; ++i_block)
-            {
-              for (size_t i_point = 0; i_point < block_n_p; ++i_point)
-                {
-                  project_on_sphere(radius,block_grid_x[i_block][i_point],block_grid_y[i_block][i_point],block_grid_z[i_block][i_point]);
-                }
-            }
+          if (line_i[0] == "x_min" && line_i[1] == "=")
+            x_min = string_to_double(line_i[2]);
+          if (line_i[0] == "x_max" && line_i[1] == "=")
+            x_max = string_to_double(line_i[2]);
+          if (line_i[0] == "y_min" && line_i[1] == "=")
+            y_min = string_to_double(line_i[2]);
+          if (line_i[0] == "y_max" && line_i[1] == "=")
+            y_max = string_to_double(line_i[2]);
+          if (line_i[0] == "z_min" && line_i[1] == "=")
+            z_min = string_to_double(line_i[2]);
+          if (line_i[0] == "z_max" && line_i[1] == "=")
+            z_max = string_to_double(line_i[2]);
 
-          /**
-           * merge blocks
-           */
-          std::vector<double> temp_x(n_block * block_n_p);
-          std::vector<double> temp_y(n_block * block_n_p);
-          std::vector<double> temp_z(n_block * block_n_p);
-          std::vector<bool> sides(n_block * block_n_p);
+          if (line_i[0] == "n_cell_x" && line_i[1] == "=")
+            n_cell_x = string_to_unsigned_int(line_i[2]);
+          if (line_i[0] == "n_cell_y" && line_i[1] == "=")
+            n_cell_y = string_to_unsigned_int(line_i[2]);
+          if (line_i[0] == "n_cell_z" && line_i[1] == "=")
+            n_cell_z = string_to_unsigned_int(line_i[2]);
 
-          for (size_t i = 0; i < n_block; ++i)
-            {
-              size_t counter = 0;
-              for (size_t j = i * block_n_p; j < i * block_n_p + block_n_p; ++j)
-                {
-                  WBAssert(j < temp_x.size(), "j should be smaller then the size of the array temp_x.");
-                  WBAssert(j < temp_y.size(), "j should be smaller then the size of the array temp_y.");
-                  WBAssert(j < temp_z.size(), "j should be smaller then the size of the array temp_z.");
-                  temp_x[j] = block_grid_x[i][counter];
-                  temp_y[j] = block_grid_y[i][counter];
-                  temp_z[j] = block_grid_z[i][counter];
-                  sides[j] = block_grid_hull[i][counter];
-                  counter++;
-                }
-            }
+        }
 
+      // Every process needs at least one piece of the grid.
+      n_pieces = std::max(n_pieces, static_cast<size_t>(MPI_SIZE));
 
-          std::vector<bool> double_points(n_block * block_n_p,false);
-          std::vector<size_t> point_to(n_block * block_n_p);
+      WBAssertThrow(output_format == "vtu" || output_format == "xdmf",
+                    "The output format can only be vtu or xdmf, not " << output_format << ".");
 
-          for (size_t i = 0; i < n_block * block_n_p; ++i)
-            point_to[i] = i;
+      WBAssertThrow(dim == 2 || dim == 3, "dim should be set in the grid file and can only be 2 or 3.");
 
-          // TODO: This becomes problematic with too large values of outer radius. Find a better way, maybe through an epsilon.
-          double distance = 1e-12*outer_radius;
+      // The slices through the world are not defined by a box, but by their own parameters.
+      const bool slice = grid_type == "plane" || grid_type == "great_circle" || grid_type == "depth_shell";
+      WBAssertThrow(dim == 3 || !(slice || grid_type == "temperature_isosurface"),
+                    "The grid type " << grid_type << " is a surface in a 3d world and can only be used with dim = 3.");
 
-          size_t counter = 0;
-          size_t amount_of_double_points = 0;
-          for (size_t i = 1; i < n_block * block_n_p; ++i)
-            {
-              if (sides[i])
-                {
-                  double gxip = temp_x[i];
-                  double gyip = temp_y[i];
-                  double gzip = temp_z[i];
-                  for (size_t j = 0; j < i-1; ++j)
-                    {
-                      if (sides[j])
-                        {
-                          if (std::fabs(gxip-temp_x[j]) < distance &&
-                              std::fabs(gyip-temp_y[j]) < distance &&
-                              std::fabs(gzip-temp_z[j]) < distance)
-                            {
-                              double_points[i] = true;
-                              point_to[i] = j;
-                              amount_of_double_points++;
-                              break;
-                            }
-                        }
-                    }
-                }
-            }
+      if (!slice)
+        {
+          WBAssertThrow(!std::isnan(x_min), "x_min is not a number:" << x_min << ". This value has probably not been provided in the grid file.");
+          WBAssertThrow(!std::isnan(x_max), "x_max is not a number:" << x_max << ". This value has probably not been provided in the grid file.");
+          WBAssertThrow(dim == 2 || !std::isnan(y_min), "y_min is not a number:" << y_min << ". This value has probably not been provided in the grid file.");
+          WBAssertThrow(dim == 2 || !std::isnan(y_max), "y_max is not a number:" << y_max << ". This value has probably not been provided in the grid file.");
+          WBAssertThrow(!std::isnan(z_min), "z_min is not a number:" << z_min << ". This value has probably not been provided in the grid file.");
+          WBAssertThrow(!std::isnan(z_max), "z_max is not a number:" << z_max << ". This value has probably not been provided in the grid file.");
+
+
+          WBAssertThrow(n_cell_x != 0, "n_cell_z may not be equal to zero: " << n_cell_x << ".");
+          // int's cannot generally be nan's (see https://stackoverflow.com/questions/3949457/can-an-integer-be-nan-in-c),
+          // but visual studio is giving problems over this, so it is taken out for now.
+          //WBAssertThrow(!std::isnan(n_cell_x), "n_cell_z is not a number:" << n_cell_x << ".");
+
+          WBAssertThrow(dim == 3 || n_cell_z != 0, "In 3d n_cell_z may not be equal to zero: " << n_cell_y << ".");
+          // int's cannot generally be nan's (see https://stackoverflow.com/questions/3949457/can-an-integer-be-nan-in-c),
+          // but visual studio is giving problems over this, so it is taken out for now.
+          //WBAssertThrow(!std::isnan(n_cell_z), "n_cell_z is not a number:" << n_cell_y << ".");
+
+          WBAssertThrow(n_cell_z != 0, "n_cell_z may not be equal to zero: " << n_cell_z << ".");
+          // int's cannot generally be nan's (see https://stackoverflow.com/questions/3949457/can-an-integer-be-nan-in-c),
+          // but visual studio is giving problems over this, so it is taken out for now.
+          //WBAssertThrow(!std::isnan(n_cell_z), "n_cell_z is not a number:" << n_cell_z << ".");
+        }
 
 
-          size_t shell_n_p = n_block * block_n_p - amount_of_double_points;
-          size_t shell_n_cell = n_block * block_n_cell;
-          size_t shell_n_v = block_n_v;
 
-          std::vector<double> shell_grid_x(shell_n_p);
-          std::vector<double> shell_grid_y(shell_n_p);
-          std::vector<double> shell_grid_z(shell_n_p);
-          std::vector<std::vector<size_t> > shell_grid_connectivity(shell_n_cell,std::vector<size_t>(shell_n_v));
 
-          counter = 0;
-          for (size_t i = 0; i < n_block * block_n_p; ++i)
-            {
-              if (!double_points[i])
-                {
-                  shell_grid_x[counter] = temp_x[i];
-                  shell_grid_y[counter] = temp_y[i];
-                  shell_grid_z[counter] = temp_z[i];
 
-                  counter++;
-                }
-            }
+      /**
+       * All variables set by the user
+       */
+
+      if (grid_type == "sphere")
+        WBAssert(n_cell_x == n_cell_y, "For the sphere grid the amount of cells in the x (long) and y (lat) direction have to be the same.");
+
+      if (grid_type == "spherical" ||
+          grid_type == "chunk" ||
+          grid_type == "anullus" ||
+          grid_type == "depth_shell" ||
+          (grid_type == "temperature_isosurface" && isosurface_grid == "chunk"))
+        {
+          x_min *= (const_pi/180);
+          x_max *= (const_pi/180);
+          y_min *= (const_pi/180);
+          y_max *= (const_pi/180);
+        }
+
+
+      std::string base_filename = wb_file.substr(wb_file.find_last_of("/\\") + 1);
+      std::string::size_type const p(base_filename.find_last_of('.'));
+      std::string file_without_extension = base_filename.substr(0, p);
+
+      /**
+       * Creates the generator of the grid, which is either a volume, a
+       * slice through the world, or an isosurface of the temperature.
+       */
+      auto create_generator = [&]()
+      {
+        if (grid_type == "plane")
+          {
+            WBAssertThrow(!std::isnan(plane_origin[0]) && !std::isnan(plane_direction_1[0]) && !std::isnan(plane_direction_2[0]),
+                          "The plane needs plane_origin, plane_direction_1 and plane_direction_2, with three values each.");
+            WBAssertThrow(!std::isnan(z_max), "The plane needs z_max, the height of the surface, to compute the depth.");
+            return create_plane_generator(plane_origin, plane_direction_1, plane_direction_2, z_max, n_cell_x, n_cell_y);
+          }
+        if (grid_type == "great_circle")
+          {
+            WBAssertThrow(!std::isnan(great_circle_start[0]) && !std::isnan(great_circle_end[0]),
+                          "The great circle needs great_circle_start and great_circle_end, with a longitude and latitude each.");
+            WBAssertThrow(!std::isnan(z_min) && !std::isnan(z_max), "The great circle needs the inner and outer radius as z_min and z_max.");
+            return create_great_circle_generator(great_circle_start[0], great_circle_start[1],
+                                                 great_circle_end[0], great_circle_end[1],
+                                                 z_min, z_max, n_cell_x, n_cell_z);
+          }
+        if (grid_type == "depth_shell")
+          {
+            WBAssertThrow(!std::isnan(x_min) && !std::isnan(x_max) && !std::isnan(y_min) && !std::isnan(y_max),
+                          "The depth shell needs the longitude and latitude range as x_min, x_max, y_min and y_max.");
+            WBAssertThrow(!std::isnan(z_max) && !std::isnan(shell_depth), "The depth shell needs the outer radius as z_max and shell_depth.");
+            return create_depth_shell_generator(x_min, x_max, y_min, y_max, z_max, shell_depth, n_cell_x, n_cell_y);
+          }
+        if (grid_type == "temperature_isosurface")
+          {
+            WBAssertThrow(!std::isnan(isosurface_temperature), "The isosurface needs isosurface_temperature.");
+            std::cout << "[4/6] Computing the isosurface on the " << isosurface_grid << " grid...                        \r";
+            std::cout.flush();
+            return create_isosurface_generator(create_grid_generator(isosurface_grid, dim, x_min, x_max, y_min, y_max, z_min, z_max,
+                                                                     n_cell_x, n_cell_y, n_cell_z, pool),
+                                               *world, gravity, isosurface_temperature, pool);
+          }
+        return create_grid_generator(grid_type, dim, x_min, x_max, y_min, y_max, z_min, z_max,
+                                     n_cell_x, n_cell_y, n_cell_z, pool);
+      };
+
+      if (adaptive_refinement_levels > 0)
+        {
+          /**
+           * Refine the grid only where the temperature or the compositions
+           * change. The refined grid is held in memory and written as vtu
+           * file. When the output is split into pieces, which is always the
+           * case with multiple processes, every piece is refined from its
+           * own range of the coarse cells, and every process refines and
+           * writes a contiguous range of the pieces.
+           */
+          WBAssertThrow(output_format == "vtu",
+                        "Adaptive refinement can only be written in the vtu output format, not in " << output_format << ".");
+          WBAssertThrow(!streaming, "Adaptive refinement can not be combined with streaming, because the refined grid is held in memory.");
+          WBAssertThrow(compress_size, "Adaptive refinement can not be combined with compress_size = false.");
 
-          for (size_t i = 0; i < n_block; ++i)
+          const size_t n_coarse_cells = n_cell_x * (dim == 3 ? n_cell_y : 1) * n_cell_z;
+          n_pieces = std::min(n_pieces, n_coarse_cells);
+
+          std::vector<vtu11::DataSetInfo> dataSetInfo
+          {
+            { "Depth", vtu11::DataSetType::PointData, 1 },
+            { "Temperature", vtu11::DataSetType::PointData, 1 },
+          };
+          for (size_t c = 0; c < compositions; ++c)
             {
-              counter = 0;
-              for (size_t j = i * block_n_cell; j < i * block_n_cell + block_n_cell; ++j)
-                {
-                  for (size_t k = 0; k < shell_n_v; ++k)
-                    {
-                      shell_grid_connectivity[j][k] = block_grid_connectivity[i][counter][k] + i * block_n_p;
-                    }
-                  counter++;
-                }
+              dataSetInfo.emplace_back(vtu11::DataSetInfo( "Composition "+std::to_string(c), vtu11::DataSetType::PointData, 1 ));
             }
 
-          for (size_t i = 0; i < shell_n_cell; ++i)
+          std::vector<unsigned long long> n_cells_per_level(adaptive_refinement_levels + 1, 0);
+          auto write_piece = [&](const size_t first_coarse_cell, const size_t last_coarse_cell, const std::string &filename)
+          {
+            Visualization::AdaptiveGrid grid(*world, grid_type, dim, gravity, compositions,
+                                             x_min, x_max, y_min, y_max, z_min, z_max,
+                                             n_cell_x, n_cell_y, n_cell_z, adaptive_refinement_levels,
+                                             refinement_temperature_difference, refinement_composition_difference,
+                                             first_coarse_cell, last_coarse_cell, pool);
+
+            const size_t n_v = dim == 2 ? 4 : 8;
+            const size_t n_cells = grid.connectivity.size() / n_v;
+            std::vector<vtu11::VtkIndexType> offsets(n_cells);
+            for (size_t i = 0; i < n_cells; ++i)
+              offsets[i] = static_cast<vtu11::VtkIndexType>((i+1) * n_v);
+            std::vector<vtu11::VtkCellType> types(n_cells, dim == 2 ? 9 : 12);
+
+            vtu11::Vtu11UnstructuredMesh mesh { grid.points, grid.connectivity, offsets, types };
+            vtu11::writeVtu( filename, mesh, dataSetInfo, grid.values, vtu_output_format );
+
+            for (size_t level = 0; level < n_cells_per_level.size(); ++level)
+              n_cells_per_level[level] += grid.n_cells_per_level[level];
+          };
+
+          if (n_pieces <= 1)
             {
-              for (size_t j = 0; j < shell_n_v; ++j)
-                {
-                  shell_grid_connectivity[i][j] = point_to[shell_grid_connectivity[i][j]];
-                }
+              std::cout << "[4/6] Building and refining the grid...                        \r";
+              std::cout.flush();
+              write_piece(0, n_coarse_cells, file_without_extension + ".vtu");
             }
+          else
+            {
+              // This also creates the directory for the pieces.
+              run_on_first_process([&]()
+              {
+                vtu11::writePVtu(".", file_without_extension, dataSetInfo, n_pieces);
+              }, MPI_RANK);
 
-          std::vector<size_t> compact(n_block * block_n_p);
+              const size_t first_piece = n_pieces * static_cast<size_t>(MPI_RANK) / static_cast<size_t>(MPI_SIZE);
+              const size_t last_piece = n_pieces * static_cast<size_t>(MPI_RANK + 1) / static_cast<size_t>(MPI_SIZE);
 
-          counter = 0;
-          for (size_t i = 0; i < n_block * block_n_p; ++i)
-            {
-              if (!double_points[i])
-                {
-                  compact[i] = counter;
-                  counter++;
-                }
+              std::cout << "[4/6] Building, refining and writing " << n_pieces << " pieces of the grid with " << MPI_SIZE << " processes...                        \r";
+              std::cout.flush();
+              for (size_t piece = first_piece; piece < last_piece; ++piece)
+                write_piece(n_coarse_cells * piece / n_pieces, n_coarse_cells * (piece + 1) / n_pieces,
+                            file_without_extension + "/" + file_without_extension + "_" + std::to_string(piece) + ".vtu");
             }
 
+#ifdef WB_WITH_MPI
+          MPI_Allreduce(MPI_IN_PLACE, n_cells_per_level.data(), static_cast<int>(n_cells_per_level.size()),
+                        MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+#endif
 
-          for (size_t i = 0; i < shell_n_cell; ++i)
-            {
-              for (size_t j = 0; j < shell_n_v; ++j)
-                {
-                  shell_grid_connectivity[i][j] = compact[shell_grid_connectivity[i][j]];
-                }
-            }
+          std::cout << "                                                                                                               \r";
+          std::cout << "Number of cells on every refinement level:";
+          for (const unsigned long long n : n_cells_per_level)
+            std::cout << " " << n;
+          std::cout << std::endl;
 
+#ifdef WB_WITH_MPI
+          MPI_Finalize();
+#endif
+          return 0;
+        }
 
+      if (output_format == "xdmf")
+        {
           /**
-           * build hollow sphere
+           * Write the grid as raw binary files with an XDMF file which
+           * describes them. The first process creates the files, after
+           * which every process writes its own range of points and cells.
            */
+          WBAssertThrow(compress_size, "The xdmf output format can not be combined with compress_size = false.");
 
-          std::vector<double> temp_shell_grid_x(shell_n_p);
-          std::vector<double> temp_shell_grid_y(shell_n_p);
-          std::vector<double> temp_shell_grid_z(shell_n_p);
+          std::cout << "[4/6] Building the grid generator...                        \r";
+          std::cout.flush();
+          const GridGenerator grid = create_generator();
 
-          size_t n_v = shell_n_v * 2;
-          n_p = (n_cell_z + 1) * shell_n_p;
-          n_cell = (n_cell_z) * shell_n_cell;
+          std::vector<std::string> field_names = {"Depth", "Temperature"};
+          for (size_t c = 0; c < compositions; ++c)
+            field_names.emplace_back("Composition " + std::to_string(c));
 
-          grid_x.resize(n_p);
-          grid_y.resize(n_p);
-          grid_z.resize(n_p);
-          grid_depth.resize(n_p);
-          grid_connectivity.resize(n_cell,std::vector<size_t>(n_v));
+          const Visualization::RawBinaryXdmfWriter writer(file_without_extension, grid.n_points, grid.n_cells,
+                                                          grid.n_vertices_per_cell, field_names);
+          run_on_first_process([&]()
+          {
+            writer.create();
+          }, MPI_RANK);
 
+          const size_t rank = static_cast<size_t>(MPI_RANK);
+          const size_t size = static_cast<size_t>(MPI_SIZE);
 
-          for (size_t i = 0; i < n_cell_z + 1; ++i)
-            {
-              temp_shell_grid_x = shell_grid_x;
-              temp_shell_grid_y = shell_grid_y;
-              temp_shell_grid_z = shell_grid_z;
+          std::cout << "[5/6] Writing the raw binary files with " << MPI_SIZE << " processes...                              \r";
+          std::cout.flush();
+          write_raw_binary_range(grid, *world, dim, gravity, compositions, writer,
+                                 grid.n_points * rank / size, grid.n_points * (rank + 1) / size,
+                                 grid.n_cells * rank / size, grid.n_cells * (rank + 1) / size,
+                                 streaming_chunk_size, pool);
 
-              // We do not need to copy the shell_grid_connectivity into a
-              // temperorary variable, because we do not change it. We can
-              // directly use it.
+          std::cout << "                                                                                                               \r";
+          std::cout.flush();
 
-              radius = inner_radius + ((outer_radius - inner_radius) / static_cast<double>(n_cell_z)) * static_cast<double>(i);
-              for (size_t j = 0; j < shell_n_p; ++j)
-                {
-                  WBAssert(j < temp_shell_grid_x.size(), "ERROR: j = " << j << ", temp_shell_grid_x.size() = " << temp_shell_grid_x.size());
-                  WBAssert(j < temp_shell_grid_y.size(), "ERROR: j = " << j << ", temp_shell_grid_y.size() = " << temp_shell_grid_y.size());
-                  WBAssert(j < temp_shell_grid_z.size(), "ERROR: j = " << j << ", temp_shell_grid_z.size() = " << temp_shell_grid_z.size());
-                  project_on_sphere(radius, temp_shell_grid_x[j], temp_shell_grid_y[j], temp_shell_grid_z[j]);
-                }
+#ifdef WB_WITH_MPI
+          MPI_Finalize();
+#endif
+          return 0;
+        }
 
-              size_t i_beg =  i * shell_n_p;
-              size_t i_end = (i+1) * shell_n_p;
-              counter = 0;
-              for (size_t j = i_beg; j < i_end; ++j)
-                {
-                  WBAssert(j < grid_x.size(), "ERROR: j = " << j << ", grid_x.size() = " << grid_x.size());
-                  WBAssert(j < grid_y.size(), "ERROR: j = " << j << ", grid_y.size() = " << grid_y.size());
-                  WBAssert(j < grid_z.size(), "ERROR: j = " << j << ", grid_z.size() = " << grid_z.size());
-                  grid_x[j] = temp_shell_grid_x[counter];
-                  grid_y[j] = temp_shell_grid_y[counter];
-                  grid_z[j] = temp_shell_grid_z[counter];
-                  grid_depth[j] = outer_radius - std::sqrt(grid_x[j] * grid_x[j] + grid_y[j] * grid_y[j] + grid_z[j] * grid_z[j]);
-
-                  counter++;
-                }
-            }
+      if (streaming || n_pieces > 1 || slice || grid_type == "temperature_isosurface")
+        {
+          /**
+           * Generate the grid, evaluate the world and write the paraview file
+           * chunk by chunk, so that the memory use does not depend on the size
+           * of the grid. When the output is split into pieces, the pieces are
+           * generated, evaluated and written by their own threads, or one
+           * after another by all threads if there are fewer pieces than
+           * threads. With multiple processes, every process takes a
+           * contiguous range of the pieces, which is a slab of the grid in the
+           * slowest varying direction of the cell numbering: depth in 2d, x or
+           * longitude for the 3d boxes and chunks, and radial layers for the
+           * sphere. The slices and isosurfaces are always written in this way.
+           */
+          WBAssertThrow(compress_size, "Streaming, pieces, slices and isosurfaces can not be combined with compress_size = false.");
+
+          std::cout << "[4/6] Building the grid generator...                        \r";
+          std::cout.flush();
+          const GridGenerator grid = create_generator();
 
-          for (size_t i = 0; i < n_cell_z; ++i)
+          if (n_pieces <= 1)
+            {
+              write_vtu_piece(grid, *world, dim, gravity, compositions, 0, grid.n_cells,
+                              file_without_extension + ".vtu", vtu_output_format, streaming_chunk_size, &pool);
+            }
+          else
             {
-              size_t i_beg = i * shell_n_cell;
-              size_t i_end = (i+1) * shell_n_cell;
-              counter = 0;
-              for (size_t j = i_beg; j < i_end; ++j)
+              n_pieces = std::min(n_pieces, grid.n_cells);
+
+              std::vector<vtu11::DataSetInfo> dataSetInfo
+              {
+                { "Depth", vtu11::DataSetType::PointData, 1 },
+                { "Temperature", vtu11::DataSetType::PointData, 1 },
+              };
+              for (size_t c = 0; c < compositions; ++c)
                 {
-                  for (size_t k = 0; k < shell_n_v; ++k)
-                    {
-                      grid_connectivity[j][k] = shell_grid_connectivity[counter][k] + i * shell_n_p;
-                    }
-                  counter++;
+                  dataSetInfo.emplace_back(vtu11::DataSetInfo( "Composition "+std::to_string(c), vtu11::DataSetType::PointData, 1 ));
                 }
 
+              // This also creates the directory for the pieces.
+              run_on_first_process([&]()
+              {
+                vtu11::writePVtu(".", file_without_extension, dataSetInfo, n_pieces);
+              }, MPI_RANK);
+
+              const size_t first_piece = n_pieces * static_cast<size_t>(MPI_RANK) / static_cast<size_t>(MPI_SIZE);
+              const size_t last_piece = n_pieces * static_cast<size_t>(MPI_RANK + 1) / static_cast<size_t>(MPI_SIZE);
 
-              counter = 0;
-              for (size_t j = i_beg; j < i_end; ++j)
+              auto write_piece = [&](const size_t piece, ThreadPool *piece_pool)
+              {
+                write_vtu_piece(grid, *world, dim, gravity, compositions,
+                                grid.n_cells * piece / n_pieces, grid.n_cells * (piece + 1) / n_pieces,
+                                file_without_extension + "/" + file_without_extension + "_" + std::to_string(piece) + ".vtu",
+                                vtu_output_format, streaming_chunk_size, piece_pool);
+              };
+
+              // When this process has at least as many pieces as threads,
+              // every piece is written by its own thread. Otherwise the
+              // pieces are written one after another, and all threads
+              // evaluate the points of every piece.
+              std::cout << "[5/6] Writing " << n_pieces << " pieces of the paraview file with " << MPI_SIZE << " processes...                              \r";
+              std::cout.flush();
+              if (last_piece - first_piece >= pool.n_threads())
                 {
-                  for (size_t k = shell_n_v ; k < 2 * shell_n_v; ++k)
-                    {
-                      WBAssert(k-shell_n_v < shell_grid_connectivity[counter].size(), "k - shell_n_v is larger then shell_grid_connectivity[counter]: k= " << k << ", shell_grid_connectivity[counter].size() = " << shell_grid_connectivity[counter].size());
-                      grid_connectivity[j][k] = shell_grid_connectivity[counter][k-shell_n_v] + (i+1) * shell_n_p;
-                    }
-                  counter++;
+                  pool.parallel_for(first_piece, last_piece, [&] (size_t piece)
+                  {
+                    write_piece(piece, nullptr);
+                  }, 1);
+                }
+              else
+                {
+                  for (size_t piece = first_piece; piece < last_piece; ++piece)
+                    write_piece(piece, &pool);
                 }
             }
-        }
-      else
-        {
-          WBAssertThrow(false, "Geometry type '" << grid_type << "' is not a valid geometry type. Valid geometry types are: "
-                        << "'cartesian', 'annulus', 'chunk' and 'sphere'. "
-                        << "Please note that the annulus can only be used in 2d and the sphere can only be used in 3d.");
+
+          std::cout << "                                                                                                               \r";
+          std::cout.flush();
+
+#ifdef WB_WITH_MPI
+          MPI_Finalize();
+#endif
+          return 0;
         }
 
-      // create paraview file.
-      std::cout << "[5/6] Preparing to write the paraview file...                                                   \r";
+      /**
+       * Build the grid from its generator, with the points and cells stored
+       * in memory. The connectivity is directly the connectivity in the vtu
+       * file.
+       */
+      std::cout << "[4/6] Building the grid...                        \r";
       std::cout.flush();
+      const GridGenerator grid = create_generator();
+      const size_t n_cell = grid.n_cells;
+      const size_t n_p = grid.n_points;
+      const size_t n_v = grid.n_vertices_per_cell;
+
+      std::vector<double> points(n_p * 3);
+      std::vector<double> grid_depth(n_p);
+      pool.parallel_for(0, n_p, [&] (size_t i)
+      {
+        std::array<double,3> position;
+        grid.point(i, position, grid_depth[i]);
+        std::copy(position.begin(), position.end(), points.begin() + static_cast<std::ptrdiff_t>(i * 3));
+      });
 
-      std::string base_filename = wb_file.substr(wb_file.find_last_of("/\\") + 1);
-      std::string::size_type const p(base_filename.find_last_of('.'));
-      std::string file_without_extension = base_filename.substr(0, p);
-
-      std::stringstream buffer;
-      std::ofstream myfile;
+      std::vector<vtu11::VtkIndexType> connectivity(n_cell * n_v);
+      pool.parallel_for(0, n_cell, [&] (size_t i)
+      {
+        grid.cell(i, &connectivity[i * n_v]);
+      });
 
-      std::cout << "[5/6] Preparing to write the paraview file: stage 1 of 6, converting the points                              \r";
-      std::cout.flush();
-      std::vector<double> points(grid_x.size()*3, 0.0);
-      if (dim == 2)
-        for (size_t i = 0; i < n_p; ++i)
-          {
-            points[i*3] = grid_x[i];
-            points[i*3+1] = grid_z[i];
-            // third one is zero
-          }
-      else
-        {
-          for (size_t i = 0; i < n_p; ++i)
-            {
-              points[i*3] = grid_x[i];
-              points[i*3+1] = grid_y[i];
-              points[i*3+2] = grid_z[i];
-            }
-        }
-      std::cout << "[5/6] Preparing to write the paraview file: stage 2 of 6, converting the connectivity                              \r";
+      // create paraview file.
+      std::cout << "[5/6] Preparing to write the paraview file...                                                   \r";
       std::cout.flush();
-      const size_t pow_2_dim = dim == 2 ? 4 : 8;
-      std::vector<vtu11::VtkIndexType> connectivity(n_cell*pow_2_dim);
-      if (dim == 2)
-        for (size_t i = 0; i < n_cell; ++i)
-          {
-            connectivity[i*pow_2_dim] = static_cast<int>(grid_connectivity[i][0]);
-            connectivity[i*pow_2_dim+1] = static_cast<int>(grid_connectivity[i][1]);
-            connectivity[i*pow_2_dim+2] = static_cast<int>(grid_connectivity[i][2]);
-            connectivity[i*pow_2_dim+3] = static_cast<int>(grid_connectivity[i][3]);
-          }
-      else
-        for (size_t i = 0; i < n_cell; ++i)
-          {
 
-            connectivity[i*pow_2_dim] = static_cast<int>(grid_connectivity[i][0]);
-            connectivity[i*pow_2_dim+1] = static_cast<int>(grid_connectivity[i][1]);
-            connectivity[i*pow_2_dim+2] = static_cast<int>(grid_connectivity[i][2]);
-            connectivity[i*pow_2_dim+3] = static_cast<int>(grid_connectivity[i][3]);
-            connectivity[i*pow_2_dim+4] = static_cast<int>(grid_connectivity[i][4]);
-            connectivity[i*pow_2_dim+5] = static_cast<int>(grid_connectivity[i][5]);
-            connectivity[i*pow_2_dim+6] = static_cast<int>(grid_connectivity[i][6]);
-            connectivity[i*pow_2_dim+7] = static_cast<int>(grid_connectivity[i][7]);
-          }
-      std::cout << "[5/6] Preparing to write the paraview file: stage 3 of 6, creating the offsets                              \r";
+      std::cout << "[5/6] Preparing to write the paraview file: stage 1 of 4, creating the offsets                              \r";
       std::cout.flush();
       std::vector<vtu11::VtkIndexType> offsets(n_cell);
       if (dim == 2)
@@ -1420,7 +1904,7 @@ int main(int argc, char **argv)
         for (size_t i = 0; i < n_cell; ++i)
           offsets[i] = static_cast<int>((i+1) * 8);
 
-      std::cout << "[5/6] Preparing to write the paraview file: stage 4 of 6, creating the Data set info                              \r";
+      std::cout << "[5/6] Preparing to write the paraview file: stage 2 of 4, creating the Data set info                              \r";
       std::cout.flush();
       std::vector<vtu11::VtkCellType> types(n_cell, dim == 2 ? 9 : 12);
 
@@ -1435,7 +1919,7 @@ int main(int argc, char **argv)
           dataSetInfo.emplace_back(vtu11::DataSetInfo( "Composition "+std::to_string(c), vtu11::DataSetType::PointData, 1 ));
         }
 
-      std::cout << "[5/6] Preparing to write the paraview file: stage 5 of 6, computing the temperatures                              \r";
+      std::cout << "[5/6] Preparing to write the paraview file: stage 3 of 4, computing the temperatures                              \r";
       std::cout.flush();
       // compute temperature
       std::vector<double> temperature_vector(n_p);
@@ -1443,7 +1927,7 @@ int main(int argc, char **argv)
         {
           pool.parallel_for(0, n_p, [&] (size_t i)
           {
-            std::array<double,2> coords = {{grid_x[i], grid_z[i]}};
+            std::array<double,2> coords = {{points[i*3], points[i*3+1]}};
             temperature_vector[i] = world->temperature(coords, grid_depth[i], gravity);
           });
         }
@@ -1451,19 +1935,19 @@ int main(int argc, char **argv)
         {
           pool.parallel_for(0, n_p, [&] (size_t i)
           {
-            std::array<double,3> coords = {{grid_x[i], grid_y[i], grid_z[i]}};
+            std::array<double,3> coords = {{points[i*3], points[i*3+1], points[i*3+2]}};
             temperature_vector[i] = world->temperature(coords, grid_depth[i], gravity);
           });
         }
 
       std::vector<vtu11::DataSetData> data_set = { grid_depth, temperature_vector};
-      std::cout << "[5/6] Preparing to write the paraview file: stage 6 of 6, computing the compositions                              \r";
+      std::cout << "[5/6] Preparing to write the paraview file: stage 4 of 4, computing the compositions                              \r";
       std::cout.flush();
       // compute compositions
       std::vector<double> temp_vector(n_p);
       for (size_t c = 0; c < compositions; ++c)
         {
-          std::cout << "[5/6] Preparing to write the paraview file: stage 6 of 6, computing composition "
+          std::cout << "[5/6] Preparing to write the paraview file: stage 4 of 4, computing composition "
                     << c << " of " << compositions << "            \r";
           std::cout.flush();
 
@@ -1471,7 +1955,7 @@ int main(int argc, char **argv)
             {
               pool.parallel_for(0, n_p, [&] (size_t i)
               {
-                std::array<double,2> coords = {{grid_x[i], grid_z[i]}};
+                std::array<double,2> coords = {{points[i*3], points[i*3+1]}};
                 temp_vector[i] =  world->composition(coords, grid_depth[i], static_cast<unsigned int>(c));
               });
             }
@@ -1479,12 +1963,104 @@ int main(int argc, char **argv)
             {
               pool.parallel_for(0, n_p, [&] (size_t i)
               {
-                std::array<double,3> coords = {{grid_x[i], grid_y[i], grid_z[i]}};
+                std::array<double,3> coords = {{points[i*3], points[i*3+1], points[i*3+2]}};
                 temp_vector[i] =  world->composition(coords, grid_depth[i], static_cast<unsigned int>(c));
               });
             }
           data_set.emplace_back(temp_vector);
         }
+
+      if (!compress_size)
+        {
+          // Only the cells at the boundary of a feature get their own points,
+          // so that they can be handled separately from their neighbours in
+          // paraview. These are the cells in which the compositions are not
+          // the same at all corners. All other cells keep sharing their
+          // points, so that the file only grows with the number of cells at
+          // the boundaries. The world has been evaluated only once for every
+          // unique point, and the points and their values are copied to the
+          // cells which get their own points.
+          if (compositions == 0)
+            std::cerr << "Warning: compress_size = false only gives the cells at the boundaries of the compositions "
+                      << "their own points, but no compositions are written, so all cells keep sharing their points." << std::endl;
+          std::cout << "[5/6] Preparing to write the paraview file: giving the cells at feature boundaries their own points                              \r";
+          std::cout.flush();
+          std::vector<char> own_points(n_cell, 0);
+          pool.parallel_for(0, n_cell, [&] (size_t cell)
+          {
+            const vtu11::VtkIndexType *vertices = &connectivity[cell * n_v];
+            for (size_t c = 2; c < data_set.size(); ++c)
+              for (size_t v = 1; v < n_v; ++v)
+                if (std::fabs(data_set[c][static_cast<size_t>(vertices[v])] - data_set[c][static_cast<size_t>(vertices[0])]) > 0)
+                  {
+                    own_points[cell] = 1;
+                    return;
+                  }
+          });
+
+          // The points which are still shared by other cells keep their
+          // order at the front, and the points of the cells with their own
+          // points follow cell by cell. Points which are no longer used by
+          // any cell are removed.
+          std::vector<size_t> new_point(n_p, 0);
+          for (size_t cell = 0; cell < n_cell; ++cell)
+            if (own_points[cell] == 0)
+              for (size_t v = 0; v < n_v; ++v)
+                new_point[static_cast<size_t>(connectivity[cell * n_v + v])] = 1;
+
+          size_t n_shared_points = 0;
+          for (size_t i = 0; i < n_p; ++i)
+            new_point[i] = new_point[i] == 1 ? n_shared_points++ : n_p;
+
+          std::vector<size_t> first_own_point(n_cell, 0);
+          size_t n_new_points = n_shared_points;
+          for (size_t cell = 0; cell < n_cell; ++cell)
+            if (own_points[cell] != 0)
+              {
+                first_own_point[cell] = n_new_points;
+                n_new_points += n_v;
+              }
+
+          auto copy_to_new_points = [&](std::vector<double> &values, const size_t n_components)
+          {
+            auto copy_point = [&](const size_t from, std::vector<double> &to_values, const size_t to)
+            {
+              std::copy(values.begin() + static_cast<std::ptrdiff_t>(from * n_components),
+                        values.begin() + static_cast<std::ptrdiff_t>((from + 1) * n_components),
+                        to_values.begin() + static_cast<std::ptrdiff_t>(to * n_components));
+            };
+
+            std::vector<double> new_values(n_new_points * n_components);
+            pool.parallel_for(0, n_p, [&] (size_t i)
+            {
+              if (new_point[i] != n_p)
+                copy_point(i, new_values, new_point[i]);
+            });
+            pool.parallel_for(0, n_cell, [&] (size_t cell)
+            {
+              if (own_points[cell] != 0)
+                for (size_t v = 0; v < n_v; ++v)
+                  copy_point(static_cast<size_t>(connectivity[cell * n_v + v]), new_values, first_own_point[cell] + v);
+            });
+            values.swap(new_values);
+          };
+
+          copy_to_new_points(points, 3);
+          for (vtu11::DataSetData &values : data_set)
+            copy_to_new_points(values, 1);
+
+          pool.parallel_for(0, n_cell, [&] (size_t cell)
+          {
+            for (size_t v = 0; v < n_v; ++v)
+              {
+                vtu11::VtkIndexType &vertex = connectivity[cell * n_v + v];
+                vertex = static_cast<vtu11::VtkIndexType>(own_points[cell] != 0
+                                                          ? first_own_point[cell] + v
+                                                          : new_point[static_cast<size_t>(vertex)]);
+              }
+          });
+        }
+
       std::cout << "[6/6] Writing the paraview file                                                                                \r";
       std::cout.flush();
 
@@ -0,0 +1,264 @@
+/*
+  Copyright (C) 2018 - 2021 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "visualization/streaming_vtu_writer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+namespace WorldBuilder
+{
+  namespace Visualization
+  {
+    const size_t StreamingVtuWriter::block_size;
+
+
+    StreamingVtuWriter::StreamingVtuWriter(const std::string &filename_,
+                                           const std::string &output_format,
+                                           const size_t n_points_,
+                                           const size_t n_cells_)
+      :
+      filename(filename_),
+      temporary_filename(filename_ + ".tmp"),
+      format(output_format),
+      n_points(n_points_),
+      n_cells(n_cells_),
+      temporary_file_size(0),
+      array_open(false),
+      n_bytes_in_array(0)
+    {
+      std::transform(format.begin(), format.end(), format.begin(), [](unsigned char c)
+      {
+        return static_cast<char>(std::tolower(c));
+      });
+
+#ifndef VTU11_ENABLE_ZLIB
+      // vtu11 also falls back to uncompressed data without zlib.
+      if (format == "rawbinarycompressed")
+        format = "rawbinary";
+#endif
+
+      WBAssertThrow(format == "ascii" || format == "rawbinary" || format == "rawbinarycompressed",
+                    "The vtu output format " << output_format << " can not be used for streaming output. "
+                    << "Valid formats are ASCII, RawBinary and RawBinaryCompressed.");
+
+      temporary_file.open(temporary_filename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+      WBAssertThrow(temporary_file.is_open(), "Could not open the temporary file " << temporary_filename << ".");
+
+      block.reserve(block_size);
+    }
+
+
+    StreamingVtuWriter::~StreamingVtuWriter()
+    {
+      if (temporary_file.is_open())
+        temporary_file.close();
+      std::remove(temporary_filename.c_str());
+    }
+
+
+    void
+    StreamingVtuWriter::end_array()
+    {
+      WBAssertThrow(array_open, "No array has been started which can be ended.");
+      ArrayInfo &array = arrays.back();
+
+      if (format == "ascii")
+        {
+          temporary_file << "\n";
+        }
+      else if (format == "rawbinary")
+        {
+          array.header.push_back(n_bytes_in_array);
+        }
+      else
+        {
+          // The header of compressed data consists of the number of blocks,
+          // the block size, the size of the last block and the compressed
+          // size of every block.
+          const size_t last_block_size = block.size();
+          if (!block.empty())
+            compress_block();
+
+          array.header.insert(array.header.begin(), {array.header.size(), n_bytes_in_array == 0 ? 0 : block_size, last_block_size});
+        }
+
+      WBAssertThrow(temporary_file.good(), "Could not write to the temporary file " << temporary_filename << ".");
+      temporary_file_size = temporary_file.tellp();
+      array.data_end = temporary_file_size;
+      array_open = false;
+    }
+
+
+    void
+    StreamingVtuWriter::write_binary(const char *data, size_t n_bytes)
+    {
+      n_bytes_in_array += n_bytes;
+      if (format == "rawbinary")
+        {
+          temporary_file.write(data, static_cast<std::streamsize>(n_bytes));
+          return;
+        }
+
+      while (n_bytes > 0)
+        {
+          // A full block is only compressed when more data arrives, because
+          // the size of the last block is stored separately in the header.
+          if (block.size() == block_size)
+            compress_block();
+
+          const size_t n_copy = std::min(n_bytes, block_size - block.size());
+          block.insert(block.end(), data, data + n_copy);
+          data += n_copy;
+          n_bytes -= n_copy;
+        }
+    }
+
+
+    void
+    StreamingVtuWriter::compress_block()
+    {
+#ifdef VTU11_ENABLE_ZLIB
+      uLongf compressed_size = compressBound(block_size);
+      compressed_block.resize(compressed_size);
+      const int error_code = compress(compressed_block.data(), &compressed_size,
+                                      reinterpret_cast<const Bytef *>(block.data()), block.size());
+      WBAssertThrow(error_code == Z_OK, "Error in zlib compression (code " << error_code << ").");
+
+      temporary_file.write(reinterpret_cast<const char *>(compressed_block.data()), static_cast<std::streamsize>(compressed_size));
+      arrays.back().header.push_back(compressed_size);
+#endif
+      block.clear();
+    }
+
+
+    void
+    StreamingVtuWriter::copy_data(const ArrayInfo &array, std::ostream &output)
+    {
+      std::vector<char> buffer(1 << 20);
+      temporary_file.seekg(array.data_begin);
+      std::streamoff remaining = array.data_end - array.data_begin;
+      while (remaining > 0)
+        {
+          const std::streamsize n_read = static_cast<std::streamsize>(std::min(remaining, static_cast<std::streamoff>(buffer.size())));
+          temporary_file.read(buffer.data(), n_read);
+          WBAssertThrow(temporary_file.good(), "Could not read from the temporary file " << temporary_filename << ".");
+          output.write(buffer.data(), n_read);
+          remaining -= n_read;
+        }
+    }
+
+
+    void
+    StreamingVtuWriter::finish()
+    {
+      WBAssertThrow(!array_open, "The array " << arrays.back().name << " has not been ended before finishing the file.");
+      temporary_file.flush();
+
+      std::ofstream output(filename, std::ios::binary);
+      WBAssertThrow(output.is_open(), "Could not open the file " << filename << ".");
+
+      const bool appended = format != "ascii";
+
+      // The order of the arrays in the file, which is also the order of the
+      // appended data.
+      std::vector<const ArrayInfo *> ordered_arrays;
+      for (const Section section : {Section::point_data, Section::cell_data, Section::points, Section::cells})
+        for (const ArrayInfo &array : arrays)
+          if (array.section == section)
+            ordered_arrays.emplace_back(&array);
+
+      output << "<?xml version=\"1.0\"?>\n";
+
+      vtu11::StringStringMap header_attributes { { "byte_order", vtu11::endianness() },
+        { "type", "UnstructuredGrid" },
+        { "version", "0.1" }
+      };
+      if (appended)
+        header_attributes["header_type"] = vtu11::dataTypeString<vtu11::HeaderType>();
+      if (format == "rawbinarycompressed")
+        header_attributes["compressor"] = "vtkZLibDataCompressor";
+
+      {
+        vtu11::ScopedXmlTag vtk_file_tag(output, "VTKFile", header_attributes);
+        {
+          vtu11::ScopedXmlTag unstructured_grid_tag(output, "UnstructuredGrid", {});
+          vtu11::ScopedXmlTag piece_tag(output, "Piece",
+          {
+            { "NumberOfPoints", std::to_string(n_points) },
+            { "NumberOfCells", std::to_string(n_cells) }
+          });
+
+          size_t offset = 0;
+          auto write_section = [&](const Section section, const std::string &section_name)
+          {
+            vtu11::ScopedXmlTag section_tag(output, section_name, {});
+            for (const ArrayInfo *array : ordered_arrays)
+              {
+                if (array->section != section)
+                  continue;
+
+                vtu11::StringStringMap attributes = { { "type", array->type } };
+                if (!array->name.empty())
+                  attributes["Name"] = array->name;
+                if (array->n_components > 1)
+                  attributes["NumberOfComponents"] = std::to_string(array->n_components);
+
+                if (appended)
+                  {
+                    attributes["format"] = "appended";
+                    attributes["offset"] = std::to_string(offset);
+                    vtu11::writeEmptyTag(output, "DataArray", attributes);
+                    offset += array->header.size() * sizeof(vtu11::HeaderType)
+                              + static_cast<size_t>(array->data_end - array->data_begin);
+                  }
+                else
+                  {
+                    attributes["format"] = "ascii";
+                    vtu11::ScopedXmlTag data_array_tag(output, "DataArray", attributes);
+                    copy_data(*array, output);
+                  }
+              }
+          };
+
+          write_section(Section::point_data, "PointData");
+          write_section(Section::cell_data, "CellData");
+          write_section(Section::points, "Points");
+          write_section(Section::cells, "Cells");
+        }
+
+        if (appended)
+          {
+            vtu11::ScopedXmlTag appended_data_tag(output, "AppendedData", { { "encoding", "raw" } });
+            output << "_";
+            for (const ArrayInfo *array : ordered_arrays)
+              {
+                output.write(reinterpret_cast<const char *>(array->header.data()),
+                             static_cast<std::streamsize>(array->header.size() * sizeof(vtu11::HeaderType)));
+                copy_data(*array, output);
+              }
+            output << "\n";
+          }
+      }
+
+      WBAssertThrow(output.good(), "Could not write to the file " << filename << ".");
+    }
+  }
+}
@@ -0,0 +1,177 @@
+/*
+  Copyright (C) 2018 - 2021 by the authors of the World Builder code.
+
+  This file is part of the World Builder.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published
+   by the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "visualization/xdmf_writer.h"
+
+#include "world_builder/assert.h"
+
+#include <fstream>
+
+namespace WorldBuilder
+{
+  namespace Visualization
+  {
+    namespace
+    {
+      /**
+       * Returns the name of the file without the directories.
+       */
+      std::string strip_directories(const std::string &filename)
+      {
+        return filename.substr(filename.find_last_of("/\\") + 1);
+      }
+
+
+      /**
+       * Returns the byte order of the machine in the notation of XDMF.
+       */
+      std::string endianness()
+      {
+        const std::uint16_t value = 1;
+        return *reinterpret_cast<const unsigned char *>(&value) == 1 ? "Little" : "Big";
+      }
+    }
+
+
+    RawBinaryXdmfWriter::RawBinaryXdmfWriter(const std::string &base_filename_,
+                                             const size_t n_points_,
+                                             const size_t n_cells_,
+                                             const size_t n_vertices_per_cell_,
+                                             const std::vector<std::string> &field_names_)
+      :
+      base_filename(base_filename_),
+      n_points(n_points_),
+      n_cells(n_cells_),
+      n_vertices_per_cell(n_vertices_per_cell_),
+      field_names(field_names_)
+    {
+      WBAssertThrow(n_vertices_per_cell == 3 || n_vertices_per_cell == 4 || n_vertices_per_cell == 8,
+                    "The XDMF writer only supports triangles, quadrilaterals and hexahedra, not cells with "
+                    << n_vertices_per_cell << " vertices.");
+    }
+
+
+    std::string
+    RawBinaryXdmfWriter::field_filename(const size_t field) const
+    {
+      std::string name = field_names[field];
+      for (char &c : name)
+        if (c == ' ')
+          c = '_';
+      return base_filename + "_" + name + ".bin";
+    }
+
+
+    void
+    RawBinaryXdmfWriter::create() const
+    {
+      auto create_file = [](const std::string &filename, const size_t n_bytes)
+      {
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        WBAssertThrow(file.is_open(), "Could not create the file " << filename << ".");
+        if (n_bytes > 0)
+          {
+            file.seekp(static_cast<std::streamoff>(n_bytes - 1));
+            file.put('\0');
+          }
+        WBAssertThrow(file.good(), "Could not write to the file " << filename << ".");
+      };
+
+      create_file(base_filename + "_points.bin", n_points * 3 * sizeof(double));
+      create_file(base_filename + "_connectivity.bin", n_cells * n_vertices_per_cell * sizeof(std::int64_t));
+      for (size_t field = 0; field < field_names.size(); ++field)
+        create_file(field_filename(field), n_points * sizeof(double));
+
+      const std::string endian = endianness();
+      auto data_item = [&](const std::string &dimensions, const std::string &number_type, const std::string &filename)
+      {
+        return "<DataItem Dimensions=\"" + dimensions + "\" NumberType=\"" + number_type
+               + "\" Precision=\"8\" Format=\"Binary\" Endian=\"" + endian + "\">"
+               + strip_directories(filename) + "</DataItem>\n";
+      };
+
+      std::ofstream file(base_filename + ".xdmf");
+      WBAssertThrow(file.is_open(), "Could not create the file " << base_filename << ".xdmf.");
+
+      file << "<?xml version=\"1.0\" ?>\n"
+           << "<Xdmf Version=\"3.0\">\n"
+           << "<Domain>\n"
+           << "<Grid Name=\"" << strip_directories(base_filename) << "\" GridType=\"Uniform\">\n"
+           << "<Topology TopologyType=\"" << (n_vertices_per_cell == 3 ? "Triangle" : (n_vertices_per_cell == 4 ? "Quadrilateral" : "Hexahedron"))
+           << "\" NumberOfElements=\"" << n_cells << "\">\n"
+           << data_item(std::to_string(n_cells) + " " + std::to_string(n_vertices_per_cell), "Int", base_filename + "_connectivity.bin")
+           << "</Topology>\n"
+           << "<Geometry GeometryType=\"XYZ\">\n"
+           << data_item(std::to_string(n_points) + " 3", "Float", base_filename + "_points.bin")
+           << "</Geometry>\n";
+      for (size_t field = 0; field < field_names.size(); ++field)
+        {
+          file << "<Attribute Name=\"" << field_names[field] << "\" AttributeType=\"Scalar\" Center=\"Node\">\n"
+               << data_item(std::to_string(n_points), "Float", field_filename(field))
+               << "</Attribute>\n";
+        }
+      file << "</Grid>\n"
+           << "</Domain>\n"
+           << "</Xdmf>\n";
+
+      WBAssertThrow(file.good(), "Could not write to the file " << base_filename << ".xdmf.");
+    }
+
+
+    void
+    RawBinaryXdmfWriter::write_points(const size_t first_point, const std::vector<double> &coordinates) const
+    {
+      WBAssertThrow(first_point * 3 + coordinates.size() <= n_points * 3, "The points do not fit into the grid.");
+      write_at(base_filename + "_points.bin", first_point * 3 * sizeof(double),
+               reinterpret_cast<const char *>(coordinates.data()), coordinates.size() * sizeof(double));
+    }
+
+
+    void
+    RawBinaryXdmfWriter::write_cells(const size_t first_cell, const std::vector<std::int64_t> &vertices) const
+    {
+      WBAssertThrow(first_cell * n_vertices_per_cell + vertices.size() <= n_cells * n_vertices_per_cell,
+                    "The cells do not fit into the grid.");
+      write_at(base_filename + "_connectivity.bin", first_cell * n_vertices_per_cell * sizeof(std::int64_t),
+               reinterpret_cast<const char *>(vertices.data()), vertices.size() * sizeof(std::int64_t));
+    }
+
+
+    void
+    RawBinaryXdmfWriter::write_field(const size_t field, const size_t first_point, const std::vector<double> &values) const
+    {
+      WBAssertThrow(field < field_names.size(), "There is no field with index " << field << ".");
+      WBAssertThrow(first_point + values.size() <= n_points, "The values of field " << field_names[field] << " do not fit into the grid.");
+      write_at(field_filename(field), first_point * sizeof(double),
+               reinterpret_cast<const char *>(values.data()), values.size() * sizeof(double));
+    }
+
+
+    void
+    RawBinaryXdmfWriter::write_at(const std::string &filename, const size_t offset, const char *data, const size_t n_bytes) const
+    {
+      std::fstream file(filename, std::ios::in | std::ios::out | std::ios::binary);
+      WBAssertThrow(file.is_open(), "Could not open the file " << filename << ". It has to be created before writing to it.");
+      file.seekp(static_cast<std::streamoff>(offset));
+      file.write(data, static_cast<std::streamsize>(n_bytes));
+      file.close();
+      WBAssertThrow(!file.fail(), "Could not write to the file " << filename << ".");
+    }
+  }
+}